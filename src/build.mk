@@ -0,0 +1,46 @@
+# What every htsim build shares: included by the Makefiles of the clos, expander and opera
+# libraries and of the simulators in their datacenter/ directories, after those set CFLAGS.
+#
+# common/ holds the sources that are the same for all three simulators. Each library
+# compiles them into its own libhtsim.a against its own headers (config.h, network.h,
+# queue.h...), so they are written once but built three times.
+#
+# There is no single core library: eventlist, queue, pipe, tcp, ndp and loggers have
+# diverged between the trees and each tree keeps its own copy.
+#
+#   CC=...           compiler for the libraries and the simulators, g++ by default
+#   OPT=...          optimisation, -O3 by default; OPT="-O0 -g" to debug
+#   LTO=1            link time optimisation: -flto on every compile and link, and the
+#                    archives written with gcc-ar so the linker can see into them
+#   PGO=gen          instrumented build, every run adds to the profiles in PGO_DIR
+#   PGO=use          build with those profiles; "make pgo" in test/bench does both steps
+#   EVENT_PROFILE=1  per EventSource event counts and timings, the mains' -profile
+#
+# A library and the simulators linked against it have to be built with the same
+# settings. make doesn't notice a changed setting: make clean (or -B) first.
+
+HTSIM_SRC:=$(realpath $(dir $(lastword $(MAKEFILE_LIST))))
+HTSIM_COMMON=$(HTSIM_SRC)/common
+vpath %.cpp $(HTSIM_COMMON)
+vpath %.h $(HTSIM_COMMON)
+
+ifeq ($(origin CC), default)
+	CC=g++
+endif
+OPT?=-O3
+PGO_DIR?=$(HTSIM_SRC)/../pgo
+
+CFLAGS+= -I$(HTSIM_COMMON) $(OPT)
+ifeq ($(LTO), 1)
+	CFLAGS+= -flto=auto
+	AR=gcc-ar
+endif
+ifeq ($(PGO), gen)
+	CFLAGS+= -fprofile-generate=$(PGO_DIR) -fprofile-update=atomic
+endif
+ifeq ($(PGO), use)
+	CFLAGS+= -fprofile-use=$(PGO_DIR) -fprofile-correction -Wno-missing-profile
+endif
+ifeq ($(EVENT_PROFILE), 1)
+	CFLAGS+= -DEVENT_PROFILE
+endif
@@ -2,12 +2,10 @@
 #include <math.h>
 #include "config.h"
 #include "tcppacket.h"
+#include "sim_context.h"
 
 double drand() {
-    int r=rand();
-    int m=RAND_MAX;
-    double d = (double)r/(double)m;
-    return d;
+    return SimContext::current().rng.uniform();
 }
 
 int pareto(int xm, int mean){
@@ -0,0 +1,99 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+// Per-hop forwarding cost. Packets are sent back to back down a chain of switch ports, each an
+// ECNQueue and a Pipe (a Link with -links fused), to a sink that frees them, and the run reports
+// events and wall-clock nanoseconds per packet per port.
+#include "config.h"
+#include <iostream>
+#include <string.h>
+#include <chrono>
+#include "network.h"
+#include "eventlist.h"
+#include "pipe.h"
+#include "ecnqueue.h"
+#include "link.h"
+#include "cbrpacket.h"
+
+// the library's topologies and apps read these
+uint32_t RTT = 1000; // ns
+uint32_t SPEED = 100000; // Mbps
+
+EventList eventlist;
+
+class FreeSink : public PacketSink
+{
+  public:
+    FreeSink() : received(0), _name("sink") {}
+    void receivePacket(Packet &pkt)
+    {
+        received++;
+        pkt.free();
+    }
+    const string &nodename() { return _name; }
+    uint64_t received;
+
+  private:
+    string _name;
+};
+
+void exit_error(char *progr, char *param)
+{
+    cerr << "Bad parameter: " << param << endl;
+    cerr << "Usage " << progr << " [-hops N] [-pkts N] [-links split|fused]" << endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    int hops = 8;
+    int pkts = 200000;
+    bool fused = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            exit_error(argv[0], argv[i]);
+        if (!strcmp(argv[i], "-hops"))
+            hops = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-pkts"))
+            pkts = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-links"))
+            fused = !strcmp(argv[i + 1], "fused");
+        else
+            exit_error(argv[0], argv[i]);
+        i++;
+    }
+
+    int pktsize = 9000;
+    mem_b maxsize = (mem_b)pktsize * (pkts + 1); // the first port queues everything, never drop
+    Route route;
+    for (int h = 0; h < hops; h++)
+    {
+        PacketSink *port;
+        if (fused)
+            port = new Link(speedFromMbps((uint64_t)SPEED), maxsize, timeFromNs(RTT), eventlist, NULL, memFromPkt(50));
+        else
+        {
+            port = new ECNQueue(speedFromMbps((uint64_t)SPEED), maxsize, eventlist, NULL, memFromPkt(50));
+            route.push_back(port);
+            port = new Pipe(timeFromNs(RTT), eventlist);
+        }
+        route.push_back(port);
+    }
+    FreeSink sink;
+    route.push_back(&sink);
+
+    PacketFlow flow(NULL);
+    for (int p = 0; p < pkts; p++)
+        CbrPacket::newpkt(flow, route, p, pktsize)->sendOn();
+
+    uint64_t nevents = 0;
+    auto wall_start = std::chrono::steady_clock::now();
+    while (eventlist.doNextEvent())
+        nevents++;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    assert(sink.received == (uint64_t)pkts);
+
+    double pkthops = (double)pkts * hops;
+    cout << "hops " << hops << " pkts " << pkts << " links " << (fused ? "fused" : "split")
+         << " events " << nevents << " events/hop " << nevents / pkthops << " ns/hop " << wall * 1e9 / pkthops << endl;
+}
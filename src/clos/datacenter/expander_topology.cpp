@@ -15,18 +15,21 @@
 #include "queue_lossless_input.h"
 #include "queue_lossless_output.h"
 #include "ecnqueue.h"
+#include "link.h"
 
 extern uint32_t RTT;
 
 string ntoa(double n);
 string itoa(uint64_t n);
 
-ExpanderTopology::ExpanderTopology(int no_of_nodes, mem_b queuesize, Logfile* lg, EventList* ev,FirstFit * fit,queue_type q){
+ExpanderTopology::ExpanderTopology(int no_of_nodes, mem_b queuesize, Logfile* lg, EventList* ev,FirstFit * fit,queue_type q,
+                                   bool fused){
     _queuesize = queuesize;
     logfile = lg;
     eventlist = ev;
     ff = fit;
     qt = q;
+    fused_links = fused;
 
     read_params();
  
@@ -135,6 +138,12 @@ Queue* ExpanderTopology::alloc_queue(QueueLogger* queueLogger, uint64_t speed, m
     assert(0);
 }
 
+// the ECN queue alloc_queue would make, with the pipe behind it folded in
+Queue* ExpanderTopology::alloc_link(QueueLogger* queueLogger) {
+    assert(qt==ECN); // only drop-tail FIFOs can be fused
+    return new Link(speedFromMbps((uint64_t)HOST_NIC), memFromPkt(2*SWITCH_BUFFER), timeFromUs(RTT), *eventlist, queueLogger, memFromPkt(15));
+}
+
 // initializes all the pipes and queues in the Topology
 void ExpanderTopology::init_network() {
   QueueLoggerSampling* queueLogger;
@@ -156,12 +165,14 @@ void ExpanderTopology::init_network() {
       // Downlink: ToR to server
       queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
       logfile->addLogger(*queueLogger);
-      queues_tor_serv[j][k] = alloc_queue(queueLogger, _queuesize);
+      queues_tor_serv[j][k] = fused_links ? alloc_link(queueLogger) : alloc_queue(queueLogger, _queuesize);
       queues_tor_serv[j][k]->setName("TOR" + ntoa(j) + "->DST" +ntoa(k));
       logfile->writeName(*(queues_tor_serv[j][k]));
-      pipes_tor_serv[j][k] = new Pipe(timeFromUs(RTT), *eventlist);
-      pipes_tor_serv[j][k]->setName("Pipe-TOR" + ntoa(j)  + "->DST" + ntoa(k));
-      logfile->writeName(*(pipes_tor_serv[j][k]));
+      if (!fused_links) {
+        pipes_tor_serv[j][k] = new Pipe(timeFromUs(RTT), *eventlist);
+        pipes_tor_serv[j][k]->setName("Pipe-TOR" + ntoa(j)  + "->DST" + ntoa(k));
+        logfile->writeName(*(pipes_tor_serv[j][k]));
+      }
 	  
       // Uplink: server to ToR
       queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
@@ -196,12 +207,14 @@ void ExpanderTopology::init_network() {
         // add pipe and queue
         queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
         logfile->addLogger(*queueLogger);
-        queues_tor_tor[j][k] = alloc_queue(queueLogger, _queuesize);
+        queues_tor_tor[j][k] = fused_links ? alloc_link(queueLogger) : alloc_queue(queueLogger, _queuesize);
         queues_tor_tor[j][k]->setName("TOR" + ntoa(j) + "->TOR" +ntoa(k));
         logfile->writeName(*(queues_tor_tor[j][k]));
-        pipes_tor_tor[j][k] = new Pipe(timeFromUs(RTT), *eventlist);
-        pipes_tor_tor[j][k]->setName("Pipe-TOR" + ntoa(j)  + "->ToR" + ntoa(k));
-        logfile->writeName(*(pipes_tor_tor[j][k]));
+        if (!fused_links) {
+          pipes_tor_tor[j][k] = new Pipe(timeFromUs(RTT), *eventlist);
+          pipes_tor_tor[j][k]->setName("Pipe-TOR" + ntoa(j)  + "->ToR" + ntoa(k));
+          logfile->writeName(*(pipes_tor_tor[j][k]));
+        }
     
         if (ff){
           ff->add_queue(queues_tor_tor[j][k]);
@@ -38,8 +38,10 @@ class ExpanderTopology: public Topology{
   EventList* eventlist;
   int failed_links;
   queue_type qt;
+  bool fused_links; // ToR ports are Links and their pipes stay NULL
 
-  ExpanderTopology(int no_of_nodes, mem_b queuesize, Logfile* log, EventList* ev, FirstFit* f, queue_type q);
+  ExpanderTopology(int no_of_nodes, mem_b queuesize, Logfile* log, EventList* ev, FirstFit* f, queue_type q,
+                   bool fused = false);
 
   void init_network();
   virtual vector<const Route*>* get_paths(int src, int dest);
@@ -47,6 +49,7 @@ class ExpanderTopology: public Topology{
   Queue* alloc_src_queue(QueueLogger* q);
   Queue* alloc_queue(QueueLogger* q, mem_b queuesize);
   Queue* alloc_queue(QueueLogger* q, uint64_t speed, mem_b queuesize);
+  Queue* alloc_link(QueueLogger* q);
 
   void count_queue(Queue*);
   vector<int>* get_neighbours(int src) {return NULL;};
@@ -15,6 +15,7 @@
 #include "queue_lossless_input.h"
 #include "queue_lossless_output.h"
 #include "ecnqueue.h"
+#include "link.h"
 
 extern uint32_t RTT_rack;
 extern uint32_t RTT_net;
@@ -27,13 +28,14 @@ string itoa(uint64_t n);
 //extern int N;
 
 FatTreeTopology::FatTreeTopology(int no_of_nodes, mem_b queuesize, Logfile *lg,
-                                 EventList *ev, FirstFit *fit, queue_type q)
+                                 EventList *ev, FirstFit *fit, queue_type q, bool fused)
 {
   _queuesize = queuesize;
   logfile = lg;
   eventlist = ev;
   ff = fit;
   qt = q;
+  fused_links = fused;
   failed_links = 0;
 
   set_params(no_of_nodes);
@@ -42,11 +44,12 @@ FatTreeTopology::FatTreeTopology(int no_of_nodes, mem_b queuesize, Logfile *lg,
 }
 
 FatTreeTopology::FatTreeTopology(int no_of_nodes, mem_b queuesize, Logfile *lg,
-                                 EventList *ev, FirstFit *fit, queue_type q, int fail)
+                                 EventList *ev, FirstFit *fit, queue_type q, int fail, bool fused)
 {
   _queuesize = queuesize;
   logfile = lg;
   qt = q;
+  fused_links = fused;
 
   eventlist = ev;
   ff = fit;
@@ -132,6 +135,13 @@ Queue *FatTreeTopology::alloc_queue(QueueLogger *queueLogger, uint64_t speed, me
   assert(0);
 }
 
+// the ECN queue alloc_queue would make, with the pipe behind it folded in
+Queue *FatTreeTopology::alloc_link(QueueLogger *queueLogger, uint64_t speed, uint32_t delay_ns)
+{
+  assert(qt == ECN); // only drop-tail FIFOs can be fused
+  return new Link(speedFromMbps(speed), _queuesize, timeFromNs(delay_ns), *eventlist, queueLogger, memFromPkt(50));
+}
+
 void FatTreeTopology::init_network()
 {
   QueueLoggerSampling *queueLogger = nullptr;
@@ -184,15 +194,18 @@ void FatTreeTopology::init_network()
       // queueLogger = NULL;
       // logfile->addLogger(*queueLogger);
 
-      queues_nlp_ns[j][k] = alloc_queue(queueLogger, _queuesize);
+      queues_nlp_ns[j][k] = fused_links ? alloc_link(queueLogger, SPEED, RTT_rack) : alloc_queue(queueLogger, _queuesize);
       queues_nlp_ns[j][k]->setName("LS" + ntoa(j) + "->DST" + ntoa(k));
       // logfile->writeName(*(queues_nlp_ns[j][k]));
 
-      pipes_nlp_ns[j][k] = new Pipe(timeFromNs(RTT_rack), *eventlist);
-      pipes_nlp_ns[j][k]->setName("Pipe-LS" + ntoa(j) + "->DST" + ntoa(k));
-      // logfile->writeName(*(pipes_nlp_ns[j][k]));
+      if (!fused_links)
+      {
+        pipes_nlp_ns[j][k] = new Pipe(timeFromNs(RTT_rack), *eventlist);
+        pipes_nlp_ns[j][k]->setName("Pipe-LS" + ntoa(j) + "->DST" + ntoa(k));
+        // logfile->writeName(*(pipes_nlp_ns[j][k]));
 
-      pipes_nlp_ns[j][k]->set_pipe_downlink(); // modification - set this for the UtilMonitor
+        pipes_nlp_ns[j][k]->set_pipe_downlink(); // modification - set this for the UtilMonitor
+      }
 
       // Uplink
       // queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
@@ -241,18 +254,21 @@ void FatTreeTopology::init_network()
       // Downlink
       // queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
       // logfile->addLogger(*queueLogger);
-      queues_nup_nlp[k][j] = alloc_queue(queueLogger, _queuesize);
+      queues_nup_nlp[k][j] = fused_links ? alloc_link(queueLogger, SPEED, RTT_net) : alloc_queue(queueLogger, _queuesize);
       queues_nup_nlp[k][j]->setName("US" + ntoa(k) + "->LS_" + ntoa(j));
       // logfile->writeName(*(queues_nup_nlp[k][j]));
 
-      pipes_nup_nlp[k][j] = new Pipe(timeFromNs(RTT_net), *eventlist);
-      pipes_nup_nlp[k][j]->setName("Pipe-US" + ntoa(k) + "->LS" + ntoa(j));
+      if (!fused_links)
+      {
+        pipes_nup_nlp[k][j] = new Pipe(timeFromNs(RTT_net), *eventlist);
+        pipes_nup_nlp[k][j]->setName("Pipe-US" + ntoa(k) + "->LS" + ntoa(j));
+      }
       // logfile->writeName(*(pipes_nup_nlp[k][j]));
 
       // Uplink
       // queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
       // logfile->addLogger(*queueLogger);
-      queues_nlp_nup[j][k] = alloc_queue(queueLogger, _queuesize);
+      queues_nlp_nup[j][k] = fused_links ? alloc_link(queueLogger, SPEED, RTT_net) : alloc_queue(queueLogger, _queuesize);
       queues_nlp_nup[j][k]->setName("LS" + ntoa(j) + "->US" + ntoa(k));
       // logfile->writeName(*(queues_nlp_nup[j][k]));
 
@@ -269,8 +285,11 @@ void FatTreeTopology::init_network()
         new LosslessInputQueue(*eventlist, queues_nup_nlp[k][j]);
       }
 
-      pipes_nlp_nup[j][k] = new Pipe(timeFromNs(RTT_net), *eventlist);
-      pipes_nlp_nup[j][k]->setName("Pipe-LS" + ntoa(j) + "->US" + ntoa(k));
+      if (!fused_links)
+      {
+        pipes_nlp_nup[j][k] = new Pipe(timeFromNs(RTT_net), *eventlist);
+        pipes_nlp_nup[j][k]->setName("Pipe-LS" + ntoa(j) + "->US" + ntoa(k));
+      }
       // logfile->writeName(*(pipes_nlp_nup[j][k]));
 
       if (ff)
@@ -299,12 +318,15 @@ void FatTreeTopology::init_network()
       // queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
       // logfile->addLogger(*queueLogger);
 
-      queues_nup_nc[j][k] = alloc_queue(queueLogger, _queuesize);
+      queues_nup_nc[j][k] = fused_links ? alloc_link(queueLogger, SPEED, RTT_net) : alloc_queue(queueLogger, _queuesize);
       queues_nup_nc[j][k]->setName("US" + ntoa(j) + "->CS" + ntoa(k));
       // logfile->writeName(*(queues_nup_nc[j][k]));
 
-      pipes_nup_nc[j][k] = new Pipe(timeFromNs(RTT_net), *eventlist);
-      pipes_nup_nc[j][k]->setName("Pipe-US" + ntoa(j) + "->CS" + ntoa(k));
+      if (!fused_links)
+      {
+        pipes_nup_nc[j][k] = new Pipe(timeFromNs(RTT_net), *eventlist);
+        pipes_nup_nc[j][k]->setName("Pipe-US" + ntoa(j) + "->CS" + ntoa(k));
+      }
       // logfile->writeName(*(pipes_nup_nc[j][k]));
 
       // Uplink
@@ -314,11 +336,11 @@ void FatTreeTopology::init_network()
 
       if ((l + j * K / 2) < failed_links)
       {
-        queues_nc_nup[k][j] = alloc_queue(queueLogger, SPEED / 10, _queuesize);
+        queues_nc_nup[k][j] = fused_links ? alloc_link(queueLogger, SPEED / 10, RTT_net) : alloc_queue(queueLogger, SPEED / 10, _queuesize);
         cout << "Adding link failure for j" << ntoa(j) << " l " << ntoa(l) << endl;
       }
       else
-        queues_nc_nup[k][j] = alloc_queue(queueLogger, _queuesize);
+        queues_nc_nup[k][j] = fused_links ? alloc_link(queueLogger, SPEED, RTT_net) : alloc_queue(queueLogger, _queuesize);
 
       queues_nc_nup[k][j]->setName("CS" + ntoa(k) + "->US" + ntoa(j));
 
@@ -337,8 +359,11 @@ void FatTreeTopology::init_network()
 
       // logfile->writeName(*(queues_nc_nup[k][j]));
 
-      pipes_nc_nup[k][j] = new Pipe(timeFromNs(RTT_net), *eventlist);
-      pipes_nc_nup[k][j]->setName("Pipe-CS" + ntoa(k) + "->US" + ntoa(j));
+      if (!fused_links)
+      {
+        pipes_nc_nup[k][j] = new Pipe(timeFromNs(RTT_net), *eventlist);
+        pipes_nc_nup[k][j]->setName("Pipe-CS" + ntoa(k) + "->US" + ntoa(j));
+      }
       // logfile->writeName(*(pipes_nc_nup[k][j]));
 
       if (ff)
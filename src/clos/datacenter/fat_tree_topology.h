@@ -55,9 +55,12 @@ class FatTreeTopology: public Topology{
   EventList* eventlist;
   int failed_links;
   queue_type qt;
+  bool fused_links; // switch ports are Links and their pipes_* stay NULL; hosts keep their priority queue and pipe
 
-  FatTreeTopology(int no_of_nodes, mem_b queuesize, Logfile* log, EventList* ev, FirstFit* f, queue_type q);
-  FatTreeTopology(int no_of_nodes, mem_b queuesize, Logfile* log, EventList* ev, FirstFit* f, queue_type q, int fail);
+  FatTreeTopology(int no_of_nodes, mem_b queuesize, Logfile* log, EventList* ev, FirstFit* f, queue_type q,
+                  bool fused = false);
+  FatTreeTopology(int no_of_nodes, mem_b queuesize, Logfile* log, EventList* ev, FirstFit* f, queue_type q, int fail,
+                  bool fused = false);
 
   void init_network();
   virtual vector<const Route*>* get_paths(int src, int dest);
@@ -65,6 +68,7 @@ class FatTreeTopology: public Topology{
   Queue* alloc_src_queue(QueueLogger* q);
   Queue* alloc_queue(QueueLogger* q, mem_b queuesize);
   Queue* alloc_queue(QueueLogger* q, uint64_t speed, mem_b queuesize);
+  Queue* alloc_link(QueueLogger* q, uint64_t speed, uint32_t delay_ns);
 
   void count_queue(Queue*);
   void print_path(std::ofstream& paths,int src,const Route* route);
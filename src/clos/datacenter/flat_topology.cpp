@@ -6,6 +6,8 @@
 #include <fstream>
 #include <strstream>
 #include <iostream>
+#include <limits>
+#include <algorithm>
 // #include "taskgraph.pb.h"
 
 #include "main.h"
@@ -17,6 +19,7 @@
 #include "queue_lossless_input.h"
 #include "queue_lossless_output.h"
 #include "ecnqueue.h"
+#include "link.h"
 
 #include "taskgraph_generated.h"
 
@@ -30,29 +33,16 @@ string ntoa(double n);
 string itoa(uint64_t n);
 
 //extern int N;
-static bool LoadFileRaw(const char *name, std::string *buf)
-{
-  std::ifstream ifs(name, std::ifstream::binary);
-  if (!ifs.is_open())
-  {
-    return false;
-  }
-  // The fastest way to read a file into a string.
-  ifs.seekg(0, std::ios::end);
-  auto size = ifs.tellg();
-  (*buf).resize(static_cast<size_t>(size));
-  ifs.seekg(0, std::ios::beg);
-  ifs.read(&(*buf)[0], (*buf).size());
-  return !ifs.bad();
-}
 
-FlatTopology::FlatTopology(int no_of_nodes, const string &tgfile, mem_b queuesize, Logfile *lg, EventList *ev, FirstFit *fit, queue_type q)
+FlatTopology::FlatTopology(int no_of_nodes, const string &tgfile, mem_b queuesize, Logfile *lg, EventList *ev, FirstFit *fit, queue_type q,
+                           bool fused)
 {
   _queuesize = queuesize;
   logfile = lg;
   eventlist = ev;
   ff = fit;
   qt = q;
+  fused_links = fused;
   failed_links = 0;
 
   set_params(no_of_nodes);
@@ -69,22 +59,26 @@ void FlatTopology::set_params(int no_of_nodes)
   _no_of_nodes = no_of_nodes;
 
   switchs.resize(_no_of_nodes, nullptr);
-  pipes.resize(_no_of_nodes, vector<Pipe *>(_no_of_nodes));
-  queues.resize(_no_of_nodes, vector<Queue *>(_no_of_nodes));
 }
 
-FlatTopology::FlatTopology(int no_of_nodes, mem_b queuesize, Logfile *lg, EventList *ev, FirstFit *fit, queue_type q)
+FlatTopology::FlatTopology(int no_of_nodes, mem_b queuesize, Logfile *lg, EventList *ev, FirstFit *fit, queue_type q,
+                           bool fused)
 {
   _queuesize = queuesize;
   logfile = lg;
   eventlist = ev;
   ff = fit;
   qt = q;
+  fused_links = fused;
   failed_links = 0;
 
   set_params(no_of_nodes);
   // load_topology_protobuf(tgfile);
   // load_topology_flatbuf(tgfile);
+  // sized up front, the paths point into it
+  _own_hops.resize(2 * _no_of_nodes * _no_of_nodes);
+  _paths.reserve(_no_of_nodes * (_no_of_nodes - 1));
+  _routes.reserve(_no_of_nodes * (_no_of_nodes - 1));
   for (int i = 0; i < _no_of_nodes; i++)
   {
     for (int j = 0; j < _no_of_nodes; j++)
@@ -93,11 +87,11 @@ FlatTopology::FlatTopology(int no_of_nodes, mem_b queuesize, Logfile *lg, EventL
       {
         _conn_list[EDGE(i, j, _no_of_nodes)] = 1;
         uint64_t route_id = i * _no_of_nodes + j;
-        _routes[route_id] = vector<vector<size_t> *>();
-        vector<size_t> *path_vector = new vector<size_t>();
-        path_vector->push_back(i);
-        path_vector->push_back(j);
-        _routes[route_id].push_back(path_vector);
+        path_t path = {&_own_hops[2 * route_id], 2};
+        _own_hops[2 * route_id] = i;
+        _own_hops[2 * route_id + 1] = j;
+        _routes[route_id] = make_pair((uint32_t)_paths.size(), 1u);
+        _paths.push_back(path);
       }
     }
   }
@@ -106,42 +100,55 @@ FlatTopology::FlatTopology(int no_of_nodes, mem_b queuesize, Logfile *lg, EventL
 
 void FlatTopology::load_topology_flatbuf(const std::string &taskgraph)
 {
-  string buffer;
-  bool success = LoadFileRaw(taskgraph.c_str(), &buffer);
-  if (!success)
+  if (!_tgfile.open(taskgraph.c_str()))
   {
+    cerr << "Failed to read " << taskgraph << endl;
     assert("Failed to read file!" && false);
   }
-  auto fbuf_tg = flatbuffers::GetRoot<FlatBufTaskGraph::TaskGraph>(buffer.c_str());
+  flatbuffers::Verifier verifier(_tgfile.data(), _tgfile.size(), 64, std::numeric_limits<flatbuffers::uoffset_t>::max());
+  if (!verifier.VerifyBuffer<FlatBufTaskGraph::TaskGraph>(nullptr))
+  {
+    cerr << taskgraph << " is not a valid task graph" << endl;
+    assert("Failed to verify file!" && false);
+  }
+  auto fbuf_tg = flatbuffers::GetRoot<FlatBufTaskGraph::TaskGraph>(_tgfile.data());
   for (int i = 0; i < fbuf_tg->conn()->size(); i++)
   {
     auto conn = fbuf_tg->conn()->Get(i);
     _conn_list[EDGE(conn->fromnode(), conn->tonode(), _no_of_nodes)] = conn->nconn();
   }
 
+  // hops are little-endian uint32 in the buffer, which we read as they are
+  // a route's paths are contiguous in _paths: count them per route, lay the routes out, then fill in
+  // (a route may be listed more than once, its paths then follow in file order)
+  size_t npaths = 0;
+  _routes.reserve(fbuf_tg->routes()->size());
   for (int i = 0; i < fbuf_tg->routes()->size(); i++)
   {
     auto route = fbuf_tg->routes()->Get(i);
-    uint64_t route_id = route->fromnode() * _no_of_nodes + route->tonode();
-    cerr << "adding " << route->fromnode() << "->" << route->tonode() << " id " << route_id << endl;
-
+    _routes[route->fromnode() * _no_of_nodes + route->tonode()].second += route->paths()->size();
+    npaths += route->paths()->size();
+  }
+  uint32_t first = 0;
+  for (auto &route : _routes)
+  {
+    route.second.first = first;
+    first += route.second.second;
+    route.second.second = 0;
+  }
+  _paths.resize(npaths);
+  for (int i = 0; i < fbuf_tg->routes()->size(); i++)
+  {
+    auto route = fbuf_tg->routes()->Get(i);
+    pair<uint32_t, uint32_t> &range = _routes[route->fromnode() * _no_of_nodes + route->tonode()];
     for (int j = 0; j < route->paths()->size(); j++)
     {
-      auto path = route->paths()->Get(j);
-      vector<size_t> *path_vector = new vector<size_t>();
-      for (int k = 0; k < path->hopnode()->size(); k++)
-      {
-        path_vector->push_back(path->hopnode()->Get(k));
-        cerr << path->hopnode()->Get(k) << ", ";
-      }
-      if (_routes.find(route_id) == _routes.end())
-      {
-        _routes[route_id] = vector<vector<size_t> *>();
-      }
-      _routes[route_id].push_back(path_vector);
-      cerr << endl;
+      auto hops = route->paths()->Get(j)->hopnode();
+      path_t path = {hops->data(), hops->size()};
+      _paths[range.first + range.second++] = path;
     }
   }
+  cerr << "loaded " << _routes.size() << " routes, " << npaths << " paths" << endl;
 }
 
 #if 0
@@ -208,17 +215,35 @@ Queue *FlatTopology::alloc_queue(QueueLogger *queueLogger, uint64_t speed, mem_b
   assert(0);
 }
 
+// the queue alloc_queue would make, with the link's pipe folded in
+Queue *FlatTopology::alloc_link(QueueLogger *queueLogger, uint64_t speed, mem_b queuesize)
+{
+  assert(qt == ECN); // only drop-tail FIFOs can be fused
+  return new Link(speedFromMbps(speed), memFromPkt(queuesize), timeFromNs(RTT), *eventlist, queueLogger, memFromPkt(50));
+}
+
+void FlatTopology::set_ecn_threshold(mem_b K)
+{
+  assert(qt == ECN);
+  for (link_t &l : _links)
+    if (fused_links)
+      ((Link *)l.queue)->set_ecn_threshold(K);
+    else
+      ((ECNQueue *)l.queue)->_K = K;
+}
+
+void FlatTopology::set_queue_size(mem_b queuesize)
+{
+  assert(qt == ECN);
+  _queuesize = queuesize;
+  for (link_t &l : _links)
+    l.queue->_maxsize = memFromPkt(queuesize); // as alloc_queue and alloc_link size them
+}
+
 void FlatTopology::init_network()
 {
   QueueLoggerSampling *queueLogger = nullptr;
 
-  for (int j = 0; j < _no_of_nodes; j++)
-    for (int k = 0; k < _no_of_nodes; k++)
-    {
-      queues[j][k] = nullptr;
-      pipes[j][k] = nullptr;
-    }
-
   //create switches if we have lossless operation
   if (qt == LOSSLESS)
     for (int j = 0; j < _no_of_nodes; j++)
@@ -226,53 +251,90 @@ void FlatTopology::init_network()
       switchs[j] = new Switch("Switch_LowerPod_" + ntoa(j));
     }
 
+  // connected pairs as EDGE(j, k) = j * n + k with k < j; sorted, they come j ascending, then k
+  vector<uint64_t> edges;
+  edges.reserve(_conn_list.size());
+  for (auto &conn : _conn_list)
+    if (conn.first / _no_of_nodes != conn.first % _no_of_nodes)
+      edges.push_back(conn.first);
+  sort(edges.begin(), edges.end());
+
+  // lay out both directions of every edge, each node's links sorted by destination
+  _link_off.assign(_no_of_nodes + 1, 0);
+  for (uint64_t e : edges)
+  {
+    _link_off[e / _no_of_nodes + 1]++;
+    _link_off[e % _no_of_nodes + 1]++;
+  }
+  for (int j = 0; j < _no_of_nodes; j++)
+    _link_off[j + 1] += _link_off[j];
+  _links.resize(_link_off[_no_of_nodes]);
+  vector<uint32_t> next(_link_off.begin(), _link_off.end() - 1);
+  for (uint64_t e : edges)
+  {
+    uint32_t j = e / _no_of_nodes, k = e % _no_of_nodes;
+    link_t jk = {j, k, nullptr, nullptr}, kj = {k, j, nullptr, nullptr};
+    _links[next[j]++] = jk;
+    _links[next[k]++] = kj;
+  }
   for (int j = 0; j < _no_of_nodes; j++)
+    sort(links_begin(j), links_end(j), [](const link_t &a, const link_t &b) { return a.dst < b.dst; });
+
+  for (uint64_t e : edges)
   {
-    for (int k = 0; k < j; k++)
+    int j = e / _no_of_nodes, k = e % _no_of_nodes;
+    link_t *jk = get_link(j, k), *kj = get_link(k, j);
+    // QueueLoggerSampling* queueLoggerd = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
+    // QueueLoggerSampling* queueLoggeru = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
+    // queueLogger = NULL;
+    // logfile->addLogger(*queueLoggerd);
+    // logfile->addLogger(*queueLoggeru);
+
+    if (fused_links)
     {
-      if (_conn_list.find(EDGE(j, k, _no_of_nodes)) != _conn_list.end())
-      {
-        // QueueLoggerSampling* queueLoggerd = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
-        // QueueLoggerSampling* queueLoggeru = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
-        // queueLogger = NULL;
-        // logfile->addLogger(*queueLoggerd);
-        // logfile->addLogger(*queueLoggeru);
-
-        queues[j][k] = alloc_queue(queueLogger, SPEED * _conn_list[EDGE(j, k, _no_of_nodes)], _queuesize);
-        cerr << "(" << j << ", " << k << ")" << SPEED * _conn_list[EDGE(j, k, _no_of_nodes)] << endl;
-        queues[k][j] = alloc_queue(queueLogger, SPEED * _conn_list[EDGE(j, k, _no_of_nodes)], _queuesize);
-        queues[j][k]->setName("L" + ntoa(j) + "->DST" + ntoa(k));
-        queues[k][j]->setName("L" + ntoa(k) + "->DST" + ntoa(j));
-        // logfile->writeName(*(queues[j][k]));
-        // logfile->writeName(*(queues[k][j]));
-
-        pipes[j][k] = new Pipe(timeFromNs(RTT), *eventlist);
-        pipes[k][j] = new Pipe(timeFromNs(RTT), *eventlist);
-        pipes[j][k]->setName("Pipe-LS" + ntoa(j) + "->DST" + ntoa(k));
-        pipes[k][j]->setName("Pipe-LS" + ntoa(k) + "->DST" + ntoa(j));
-        // logfile->writeName(*(pipes[j][k]));
-        // logfile->writeName(*(pipes[k][j]));
-
-        if (qt == LOSSLESS)
-        {
-          switchs[j]->addPort(queues[j][k]);
-          ((LosslessQueue *)queues[j][k])->setRemoteEndpoint(queues[k][j]);
-          switchs[k]->addPort(queues[k][j]);
-          ((LosslessQueue *)queues[k][j])->setRemoteEndpoint(queues[j][k]);
-        }
-        else if (qt == LOSSLESS_INPUT || qt == LOSSLESS_INPUT_ECN)
-        {
-          //no virtual queue needed at server
-          new LosslessInputQueue(*eventlist, queues[k][j]);
-          new LosslessInputQueue(*eventlist, queues[j][k]);
-        }
+      jk->queue = alloc_link(queueLogger, SPEED * _conn_list[e], _queuesize);
+      cerr << "(" << j << ", " << k << ")" << SPEED * _conn_list[e] << endl;
+      kj->queue = alloc_link(queueLogger, SPEED * _conn_list[e], _queuesize);
+    }
+    else
+    {
+      jk->queue = alloc_queue(queueLogger, SPEED * _conn_list[e], _queuesize);
+      cerr << "(" << j << ", " << k << ")" << SPEED * _conn_list[e] << endl;
+      kj->queue = alloc_queue(queueLogger, SPEED * _conn_list[e], _queuesize);
+    }
+    jk->queue->setName("L" + ntoa(j) + "->DST" + ntoa(k));
+    kj->queue->setName("L" + ntoa(k) + "->DST" + ntoa(j));
+    // logfile->writeName(*(jk->queue));
+    // logfile->writeName(*(kj->queue));
 
-        if (ff)
-        {
-          ff->add_queue(queues[j][k]);
-          ff->add_queue(queues[k][j]);
-        }
-      }
+    if (!fused_links)
+    {
+      jk->pipe = new Pipe(timeFromNs(RTT), *eventlist);
+      kj->pipe = new Pipe(timeFromNs(RTT), *eventlist);
+      jk->pipe->setName("Pipe-LS" + ntoa(j) + "->DST" + ntoa(k));
+      kj->pipe->setName("Pipe-LS" + ntoa(k) + "->DST" + ntoa(j));
+    }
+    // logfile->writeName(*(jk->pipe));
+    // logfile->writeName(*(kj->pipe));
+
+    if (qt == LOSSLESS)
+    {
+      switchs[j]->addPort(jk->queue);
+      ((LosslessQueue *)jk->queue)->setRemoteEndpoint(kj->queue);
+      switchs[k]->addPort(kj->queue);
+      ((LosslessQueue *)kj->queue)->setRemoteEndpoint(jk->queue);
+    }
+    else if (qt == LOSSLESS_INPUT || qt == LOSSLESS_INPUT_ECN)
+    {
+      //no virtual queue needed at server
+      new LosslessInputQueue(*eventlist, kj->queue);
+      new LosslessInputQueue(*eventlist, jk->queue);
+    }
+
+    if (ff)
+    {
+      ff->add_queue(jk->queue);
+      ff->add_queue(kj->queue);
     }
   }
 
@@ -284,6 +346,14 @@ void FlatTopology::init_network()
     }
 }
 
+vector<int> *FlatTopology::get_neighbours(int src)
+{
+  vector<int> *neighbours = new vector<int>();
+  for (link_t *l = links_begin(src); l != links_end(src); l++)
+    neighbours->push_back(l->dst);
+  return neighbours;
+}
+
 // ???
 void check_non_null(Route *rt)
 {
@@ -316,45 +386,47 @@ vector<const Route *> *FlatTopology::get_paths(int src, int dest)
 
   // NOTE: HARD CODED `0` BECAUSE THERE'S ONLY ONE SWITCH
   // cerr << "id: " << src * _no_of_nodes + dest << endl;
-  assert(_routes.find(src * _no_of_nodes + dest) != _routes.end());
+  unordered_map<uint64_t, pair<uint32_t, uint32_t> >::const_iterator range = _routes.find(src * _no_of_nodes + dest);
+  assert(range != _routes.end());
 
-  for (const vector<size_t> *r : _routes[src * _no_of_nodes + dest])
+  for (uint32_t p = range->second.first; p < range->second.first + range->second.second; p++)
   {
+    const path_t &route = _paths[p];
     // forward path
     routeout = new Route();
     //routeout->push_back(pqueue);
 
-    const vector<size_t> &route = *r;
-
-    for (size_t i = 0; i < route.size() - 1; i++)
+    for (size_t i = 0; i < route.nhops - 1; i++)
     {
-      assert(queues[route[i]][route[i + 1]] != nullptr);
-      routeout->push_back(queues[route[i]][route[i + 1]]);
-      routeout->push_back(pipes[route[i]][route[i + 1]]);
+      link_t *l = get_link(route.hops[i], route.hops[i + 1]);
+      assert(l != nullptr);
+      routeout->push_back(l->queue);
+      routeout->push_back(l->pipe);
     }
     // routeout->push_back(queues[src][dest]);
     // routeout->push_back(pipes[src][dest]);
 
     if (qt == LOSSLESS_INPUT || qt == LOSSLESS_INPUT_ECN)
-      routeout->push_back(queues[src][dest]->getRemoteEndpoint());
+      routeout->push_back(get_queue(src, dest)->getRemoteEndpoint());
 
     routeback = new Route();
     // reverse path for RTS packets
     // assert(_routes.find(dest * _no_of_nodes + src) != _routes.end());
     // route = *(_routes[dest * _no_of_nodes + src]);
 
-    for (size_t i = route.size() - 1; i > 1; i--)
+    for (size_t i = route.nhops - 1; i > 1; i--)
     {
-      assert(queues[route[i]][route[i - 1]] != nullptr);
-      routeback->push_back(queues[route[i]][route[i - 1]]);
-      routeback->push_back(pipes[route[i]][route[i - 1]]);
+      link_t *l = get_link(route.hops[i], route.hops[i - 1]);
+      assert(l != nullptr);
+      routeback->push_back(l->queue);
+      routeback->push_back(l->pipe);
     }
 
     // routeback->push_back(queues[dest][src]);
     // routeback->push_back(pipes[dest][src]);
 
     if (qt == LOSSLESS_INPUT || qt == LOSSLESS_INPUT_ECN)
-      routeback->push_back(queues[dest][src]->getRemoteEndpoint());
+      routeback->push_back(get_queue(dest, src)->getRemoteEndpoint());
 
     routeout->set_reverse(routeback);
     routeback->set_reverse(routeout);
@@ -381,10 +453,9 @@ void FlatTopology::count_queue(Queue *queue)
 int FlatTopology::find_lp_switch(Queue *queue)
 {
   //first check ns_nlp
-  for (int i = 0; i < _no_of_nodes; i++)
-    for (int j = 0; j < _no_of_nodes; j++)
-      if (queues[i][j] == queue)
-        return j;
+  for (const link_t &l : _links)
+    if (l.queue == queue)
+      return l.dst;
 
   //only count nup to nlp
   count_queue(queue);
@@ -395,10 +466,9 @@ int FlatTopology::find_lp_switch(Queue *queue)
 int FlatTopology::find_destination(Queue *queue)
 {
   //first check nlp_ns
-  for (int i = 0; i < _no_of_nodes; i++)
-    for (int j = 0; j < _no_of_nodes; j++)
-      if (queues[i][j] == queue)
-        return j;
+  for (const link_t &l : _links)
+    if (l.queue == queue)
+      return l.dst;
 
   return -1;
 }
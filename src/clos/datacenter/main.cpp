@@ -122,6 +122,7 @@ int main(int argc, char **argv) {
 	i++;
     }
     srand(time(NULL));
+    SimContext::current().reseed(time(NULL));
       
     cout << "Using subflow count " << subflow_count <<endl;
     cout << "conns " << no_of_conns << endl;
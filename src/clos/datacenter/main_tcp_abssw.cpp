@@ -24,6 +24,7 @@
 // #include "test_topology.h"
 #include "test_topology.h"
 #include "ffapp.h"
+#include "run_stats.h"
 
 #include <list>
 
@@ -92,6 +93,7 @@ int main(int argc, char **argv)
 
     string flowfile;       // so we can read the flows from a specified file
     double simtime;        // seconds
+    double progress_secs = 0; // -progress: a Progress line on stderr this often, wall seconds
     double utiltime = .01; // seconds
 
     // stringstream filename(ios_base::out);
@@ -165,6 +167,11 @@ int main(int argc, char **argv)
       flowfile = argv[i + 1];
       i++;
     }
+    else if (!strcmp(argv[i], "-progress"))
+    {
+      progress_secs = atof(argv[i + 1]);
+      i++;
+    }
     else if (!strcmp(argv[i], "-simtime"))
     {
       simtime = atof(argv[i + 1]);
@@ -180,6 +187,7 @@ int main(int argc, char **argv)
     i++;
   }
     srand(13);
+    SimContext::current().reseed(13);
 
     eventlist.setEndtime(timeFromSec(simtime));
     Clock c(timeFromSec(5 / 100.), eventlist);
@@ -234,8 +242,13 @@ int main(int argc, char **argv)
     //logfile.write("# rtt =" + ntoa(rtt));
 
     // GO!
+    Progress progress;
+    std::vector<FFApplication *> apps(1, &app);
+    progress.start(progress_secs, eventlist.now(), timeFromSec(simtime), ffapps_done, &apps);
+    uint64_t nevents = 0;
     while (eventlist.doNextEvent())
     {
+        progress.poll(++nevents, eventlist.now());
     }
 
     fct_util_out << "FinalFinish " << app.final_finish_time << std::endl;
@@ -26,6 +26,9 @@
 // #include "test_topology.h"
 #include "flat_topology.h"
 #include "ffapp.h"
+#include "event_profile.h"
+#include "run_stats.h"
+#include "fork_sweep.h"
 
 #include <list>
 
@@ -41,6 +44,7 @@ int DEFAULT_NODES = 16;
 
 uint32_t SPEED;
 std::ofstream fct_util_out;
+string fct_util_file;
 
 FirstFit *ff = NULL;
 //unsigned int subflow_count = 8; // probably not necessary ???
@@ -89,13 +93,19 @@ int main(int argc, char **argv)
   int ssthresh = 15;
   int degree = DEFAULT_DEGREE;
   uint32_t reconf_delay = DEFAULT_RECONF_DELAY;
+  vector<uint32_t> reconf_delays; // -rdelay a,b,c: one forked run each from -fork_at on
+  double fork_at = 0;             // seconds
   string opt_method = "sipring";
 
   int no_of_nodes = DEFAULT_NODES;
 
   string flowfile;       // so we can read the flows from a specified file
   double simtime;        // seconds
+  double progress_secs = 0; // -progress: a Progress line on stderr this often, wall seconds
   double utiltime = .01; // seconds
+#ifdef EVENT_PROFILE
+  double profile_bucket = 0; // us, -profile: events per EventSource class, and per bucket this long
+#endif
 
   // stringstream filename(ios_base::out);
   int i = 1;
@@ -129,6 +139,7 @@ int main(int argc, char **argv)
     else if (!strcmp(argv[i], "-ofile"))
     {
       fct_util_out = std::ofstream(argv[i + 1]);
+      fct_util_file = argv[i + 1];
       cout << "ofile " << argv[i + 1] << endl;
       i++;
     }
@@ -146,8 +157,20 @@ int main(int argc, char **argv)
     }
     else if (!strcmp(argv[i], "-rdelay"))
     {
-      reconf_delay = atoi(argv[i + 1]);
-      cout << "reconf_delay " << reconf_delay << endl;
+      stringstream list(argv[i + 1]);
+      string item;
+      while (getline(list, item, ','))
+        reconf_delays.push_back(atoi(item.c_str()));
+      if (reconf_delays.empty())
+        exit_error(argv[0], argv[i + 1]);
+      reconf_delay = reconf_delays[0];
+      cout << "reconf_delay " << argv[i + 1] << endl;
+      i++;
+    }
+    else if (!strcmp(argv[i], "-fork_at"))
+    {
+      fork_at = atof(argv[i + 1]);
+      cout << "fork_at " << fork_at << endl;
       i++;
     }
     else if (!strcmp(argv[i], "-deg"))
@@ -197,11 +220,38 @@ int main(int argc, char **argv)
       utiltime = atof(argv[i + 1]);
       i++;
     }
+    else if (!strcmp(argv[i], "-profile"))
+    {
+#ifdef EVENT_PROFILE
+      profile_bucket = atof(argv[i + 1]);
+      cout << "event profile, " << profile_bucket << " us buckets" << endl;
+#else
+      cerr << "-profile needs a build with EVENT_PROFILE=1" << endl;
+      exit(1);
+#endif
+      i++;
+    }
+    else if (!strcmp(argv[i], "-progress"))
+    {
+      progress_secs = atof(argv[i + 1]);
+      i++;
+    }
     else
       exit_error(argv[0], argv[i]);
     i++;
   }
+  if (reconf_delays.size() > 1 && fork_at <= 0)
+  {
+    cerr << "several -rdelay values need -fork_at: the runs share the simulation up to there" << endl;
+    exit(1);
+  }
+  if (fork_at > 0 && fct_util_file.empty())
+  {
+    cerr << "-fork_at needs -ofile, each run writes its own ofile.<n>" << endl;
+    exit(1);
+  }
   srand(13);
+  SimContext::current().reseed(13);
 
   eventlist.setEndtime(timeFromSec(simtime));
   Clock c(timeFromSec(5 / 100.), eventlist);
@@ -232,7 +282,7 @@ int main(int argc, char **argv)
 
   FlatTopology *top = new FlatTopology(no_of_nodes, queuesize, nullptr /* &logfile */, &eventlist, ff, ECN);
   DynFlatScheduler sch = DynFlatScheduler(no_of_nodes, degree, top, optstrategy, &demandrecorder, 10000000ULL * reconf_delay, eventlist);
-  // TcpSrc::demand_recorder = &sch.demandrecorder;
+  // SimContext::current().demand_recorder = &sch.demandrecorder;
 
       // FFApplication app = FFApplication(top, ssthresh, sinkLogger, traffic_logger, tcpRtxScanner, eventlist);
   FFApplication app = FFApplication(top, ssthresh, &fct_util_out, tcpRtxScanner, eventlist);
@@ -253,9 +303,56 @@ int main(int argc, char **argv)
   //logfile.write("# rtt =" + ntoa(rtt));
 
   // GO!
+#ifdef EVENT_PROFILE
+  EventProfiler *profiler = NULL;
+  if (profile_bucket > 0)
+  {
+    profiler = new EventProfiler(timeFromUs(profile_bucket));
+    eventlist.setProfiler(profiler);
+  }
+#endif
+  RunStats runstats;
+  runstats.started();
+  uint64_t nevents = 0;
+  Progress progress;
+  std::vector<FFApplication *> apps(1, &app);
+  progress.start(progress_secs, eventlist.now(), timeFromSec(simtime), ffapps_done, &apps);
+  if (fork_at > 0)
+  {
+    // the shared prefix, then a process per reconfiguration delay (fork_sweep.h)
+    while (eventlist.now() < timeFromSec(fork_at) && eventlist.doNextEvent())
+      progress.poll(++nevents, eventlist.now());
+    runstats.print(cerr, nevents, eventlist.now());
+    fct_util_out.close();
+    if (reconf_delays.empty())
+      reconf_delays.push_back(reconf_delay);
+    vector<string> results = fork_points(reconf_delays.size(), reconf_delays.size(), [&](size_t n) {
+      fct_util_out.open(fct_util_file + "." + itoa(n));
+      sch.reconf_delay = 10000000ULL * reconf_delays[n];
+      RunStats runstats;
+      runstats.started();
+      progress.start(progress_secs, eventlist.now(), timeFromSec(simtime), ffapps_done, &apps);
+      uint64_t nevents = 0;
+      while (eventlist.doNextEvent())
+        progress.poll(++nevents, eventlist.now());
+      runstats.print(cerr, nevents, eventlist.now());
+      fct_util_out << "FinalFinish " << app.final_finish_time << std::endl;
+      fct_util_out.close();
+      return itoa(app.final_finish_time);
+    });
+    for (size_t n = 0; n < results.size(); n++)
+      cout << "rdelay " << reconf_delays[n] << " FinalFinish " << results[n] << endl;
+    return 0;
+  }
   while (eventlist.doNextEvent())
   {
+    progress.poll(++nevents, eventlist.now());
   }
+  runstats.print(cerr, nevents, eventlist.now());
+#ifdef EVENT_PROFILE
+  if (profiler)
+    profiler->report(cout);
+#endif
 
   fct_util_out << "FinalFinish " << app.final_finish_time << std::endl;
 }
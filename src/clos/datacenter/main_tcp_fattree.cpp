@@ -24,8 +24,11 @@
 // #include "test_topology.h"
 #include "fat_tree_topology.h"
 #include "ffapp.h"
+#include "event_profile.h"
+#include "run_stats.h"
 
 #include <list>
+#include <chrono>
 
 // Simulation params
 
@@ -93,7 +96,20 @@ int main(int argc, char **argv)
 
     string flowfile;       // so we can read the flows from a specified file
     double simtime;        // seconds
+    double progress_secs = 0; // -progress: a Progress line on stderr this often, wall seconds
+    size_t iters = 0;        // iterations per app, 0: one, or until converged with -converge
+    int converge_window = 0; // done once this many iteration times in a row changed by < converge_tol
+    double converge_tol = 0.01;
     double utiltime = .01; // seconds
+    bool fluid = false;    // flow-level network instead of packet-level dctcp
+    uint64_t hybrid_bytes = 0; // hybrid: only flows from this size go fluid
+    double hybrid_epoch = 10;  // us, how often fluid and packet traffic re-balance link shares
+    bool fluid_allreduce = false; // hybrid: allreduce transfers go fluid whatever their size
+    bool persistent_ar = false; // allreduce rounds reuse one dctcp connection per edge
+    bool fused_links = false; // Links instead of a queue and a pipe per switch port
+#ifdef EVENT_PROFILE
+    double profile_bucket = 0; // us, -profile: events per EventSource class, and per bucket this long
+#endif
 
     // stringstream filename(ios_base::out);
     int i = 1;
@@ -173,6 +189,19 @@ int main(int argc, char **argv)
             flowfile = argv[i + 1];
             i++;
         }
+        else if (!strcmp(argv[i], "-iters"))
+        {
+            iters = atoi(argv[i + 1]);
+            cout << "iters " << iters << endl;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-converge"))
+        {
+            converge_window = atoi(argv[i + 1]);
+            converge_tol = atof(argv[i + 2]);
+            cout << "converge window " << converge_window << " tolerance " << converge_tol << endl;
+            i += 2;
+        }
         else if (!strcmp(argv[i], "-simtime"))
         {
             simtime = atof(argv[i + 1]);
@@ -183,11 +212,67 @@ int main(int argc, char **argv)
             utiltime = atof(argv[i + 1]);
             i++;
         }
+        else if (!strcmp(argv[i], "-fluid"))
+        {
+            fluid = true;
+            cout << "fluid network model" << endl;
+        }
+        else if (!strcmp(argv[i], "-hybrid"))
+        {
+            fluid = true;
+            hybrid_bytes = atoll(argv[i + 1]);
+            cout << "hybrid network model, fluid from " << hybrid_bytes << " bytes" << endl;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-hybrid_epoch"))
+        {
+            hybrid_epoch = atof(argv[i + 1]);
+            cout << "hybrid_epoch " << hybrid_epoch << " us" << endl;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-fluid_allreduce"))
+        {
+            fluid_allreduce = true;
+            cout << "fluid allreduce" << endl;
+        }
+        else if (!strcmp(argv[i], "-persistent_ar"))
+        {
+            persistent_ar = true;
+            cout << "persistent allreduce connections" << endl;
+        }
+        else if (!strcmp(argv[i], "-fused_links"))
+        {
+            fused_links = true;
+            cout << "fused links" << endl;
+        }
+        else if (!strcmp(argv[i], "-profile"))
+        {
+#ifdef EVENT_PROFILE
+            profile_bucket = atof(argv[i + 1]);
+            cout << "event profile, " << profile_bucket << " us buckets" << endl;
+#else
+            cerr << "-profile needs a build with EVENT_PROFILE=1" << endl;
+            exit(1);
+#endif
+            i++;
+        }
+        else if (!strcmp(argv[i], "-progress"))
+        {
+            progress_secs = atof(argv[i + 1]);
+            i++;
+        }
         else
             exit_error(argv[0], argv[i]);
         i++;
     }
+    if (fused_links && (hybrid_bytes > 0 || fluid_allreduce))
+    {
+        // the background model re-rates queues mid-flight, a Link has its departures booked already
+        cerr << "-fused_links can't be used with -hybrid or -fluid_allreduce" << endl;
+        exit(1);
+    }
     srand(13);
+    SimContext::current().reseed(13);
 
     eventlist.setEndtime(timeFromSec(simtime));
     Clock c(timeFromSec(5 / 100.), eventlist);
@@ -220,12 +305,27 @@ int main(int argc, char **argv)
 
     TcpRtxTimerScanner tcpRtxScanner(timeFromMs(1), eventlist);
 
-    FatTreeTopology *top = new FatTreeTopology(no_of_nodes, queuesize, nullptr /*&logfile*/, &eventlist, ff, ECN);
+    FatTreeTopology *top = new FatTreeTopology(no_of_nodes, queuesize, nullptr /*&logfile*/, &eventlist, ff, ECN, fused_links);
     // note that 'queuesize' does not pass throuf_nodesgh currently for RANDOM...
 
     // FFApplication app = FFApplication(top, ssthresh, sinkLogger, traffic_logger, tcpRtxScanner, eventlist);
     FFApplication app = FFApplication(top, ssthresh, &fct_util_out, tcpRtxScanner, eventlist);
     app.load_taskgraph_flatbuf(flowfile);
+    if (fluid)
+    {
+        app.fluid = new FluidNetwork(top, eventlist, &fct_util_out);
+        if (hybrid_bytes > 0 || fluid_allreduce)
+        {
+            app.fluid_min_bytes = hybrid_bytes > 0 ? hybrid_bytes : UINT64_MAX;
+            if (fluid_allreduce)
+                app.fluid_task_types |= 1 << FFTask::TASK_ALLREDUCE;
+            app.fluid->set_background(timeFromUs(hybrid_epoch));
+        }
+    }
+    app.persistent_ar = persistent_ar;
+    app.max_iters = iters ? iters : (converge_window > 0 ? SIZE_MAX : 1);
+    app.converge_window = converge_window;
+    app.converge_tol = converge_tol;
     app.start_init_tasks();
 
     // UtilMonitor* UM = new UtilMonitor(top, eventlist);
@@ -242,9 +342,35 @@ int main(int argc, char **argv)
     //logfile.write("# rtt =" + ntoa(rtt));
 
     // GO!
+#ifdef EVENT_PROFILE
+    EventProfiler *profiler = NULL;
+    if (profile_bucket > 0)
+    {
+        profiler = new EventProfiler(timeFromUs(profile_bucket));
+        eventlist.setProfiler(profiler);
+    }
+#endif
+    RunStats runstats;
+    runstats.started();
+    uint64_t nevents = 0;
+    Progress progress;
+    std::vector<FFApplication *> apps(1, &app);
+    progress.start(progress_secs, eventlist.now(), timeFromSec(simtime), ffapps_done, &apps);
+    auto wall_start = std::chrono::steady_clock::now();
     while (eventlist.doNextEvent())
     {
+        progress.poll(++nevents, eventlist.now());
     }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    cout << "Events " << nevents << " wall " << wall << " s " << nevents / wall << " events/s" << endl;
+    runstats.print(cerr, nevents, eventlist.now());
+#ifdef EVENT_PROFILE
+    if (profiler)
+        profiler->report(cout);
+#endif
+    if (app.fluid)
+        app.fluid->print_stats(cout);
+    app.print_iterations(cout);
 
     fct_util_out << "FinalFinish " << app.final_finish_time << std::endl;
 }
@@ -0,0 +1,349 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+// Runs the htsim_tcp_flat simulation (packet-level dctcp on a FlatTopology) once for every
+// combination of the swept queue sizes, ssthresholds, all-reduce strategies, seeds and link models, each in a
+// SimContext of its own, several at a time on a pool of threads. A point comes out the same as
+// htsim_tcp_flat with those parameters and seed, whatever the thread count.
+//
+// With -warm_iters or -warm_time the points start warm instead: one simulation with the first
+// value of every list runs the prefix up to that iteration or time, then forks a process per point
+// that changes its queue size, ECN threshold, ssthresh and all-reduce strategy and runs on from
+// there (see fork_sweep.h). Seeds and link models are fixed by then, so those take one value.
+#include "config.h"
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "network.h"
+#include "eventlist.h"
+#include "tcp.h"
+#include "sim_context.h"
+#include "flat_topology.h"
+#include "ffapp.h"
+#include "fork_sweep.h"
+#include "run_stats.h"
+
+#include "main.h"
+
+// FlatTopology reads these, and all points share them
+uint32_t RTT = 1000; // ns
+uint32_t SPEED;
+
+#define DEFAULT_PACKET_SIZE 9000 // full packet (including header), Bytes
+#define DEFAULT_HEADER_SIZE 64   // header size, Bytes
+
+string ntoa(double n);
+string itoa(uint64_t n);
+
+struct point_t
+{
+    int queue_pkts;
+    int ecn_pkts; // ECN marking threshold
+    int ssthresh;
+    string allreduce_strategy;
+    uint64_t seed;
+    bool fused_links;
+    // results
+    simtime_picosec final_finish;
+    uint64_t nevents;
+    double wall;
+};
+
+struct sweep_t
+{
+    int no_of_nodes;
+    string flowfile;
+    double simtime;
+    size_t iters;
+    size_t warm_iters; // fork the points once this many iterations are done
+    double warm_time;  // or once simulated time gets here, seconds
+    string ofile; // each point writes ofile.<point>, a warm prefix ofile.warm
+    double progress_secs; // -progress, every point reports on its own
+    vector<point_t> points;
+    std::atomic<size_t> next;
+};
+
+void exit_error(char *progr, char *param)
+{
+    cerr << "Bad parameter: " << param << endl;
+    cerr << "Usage " << progr << " -nodes N -speed MBPS -flowfile TASKGRAPH -simtime SEC [-rtt NS] [-iters N]"
+         << " [-ofile PREFIX] [-threads N] [-q PKTS,...] [-K PKTS,...] [-ssthresh PKTS,...] [-ar ring|ps|dps|default,...]"
+         << " [-seed N,...] [-links split|fused,...] [-warm_iters N | -warm_time SEC] [-progress SEC]" << endl;
+    exit(1);
+}
+
+vector<string> split_list(const char *list)
+{
+    vector<string> items;
+    stringstream s(list);
+    string item;
+    while (getline(s, item, ','))
+        items.push_back(item);
+    return items;
+}
+
+FFApplication::FFAllReduceStrategy parse_strategy(const string &name)
+{
+    if (name == "ring")
+        return FFApplication::FF_RING_AR;
+    if (name == "ps")
+        return FFApplication::FF_PS_AR;
+    if (name == "dps")
+        return FFApplication::FF_DPS_AR;
+    if (name != "" && name != "default")
+    {
+        cerr << "Unrecogonized ar strategy " << name << std::endl;
+        exit(1);
+    }
+    return FFApplication::FF_DEFAULT_AR;
+}
+
+void run_point(sweep_t &sweep, size_t n)
+{
+    point_t &p = sweep.points[n];
+
+    // the simulation's objects are never freed, as in the single-run mains
+    SimContext *ctx = new SimContext(p.seed);
+    SimContext::Scope scope(*ctx);
+    EventList &eventlist = ctx->eventlist;
+
+    TcpPacket::set_packet_size(DEFAULT_PACKET_SIZE - DEFAULT_HEADER_SIZE); // MTU
+    eventlist.setEndtime(timeFromSec(sweep.simtime));
+
+    std::ofstream *out = new std::ofstream(sweep.ofile + "." + itoa(n));
+    TcpRtxTimerScanner *rtx = new TcpRtxTimerScanner(timeFromMs(1), eventlist);
+    FlatTopology *top = new FlatTopology(sweep.no_of_nodes, sweep.flowfile, memFromPkt(p.queue_pkts),
+                                         nullptr, &eventlist, NULL, ECN, p.fused_links);
+    top->set_ecn_threshold(memFromPkt(p.ecn_pkts));
+
+    FFApplication *app = new FFApplication(top, p.ssthresh, out, *rtx, eventlist,
+                                           parse_strategy(p.allreduce_strategy));
+    app->load_taskgraph_flatbuf(sweep.flowfile);
+    app->max_iters = sweep.iters ? sweep.iters : 1;
+    app->start_init_tasks();
+
+    p.nevents = 0;
+    Progress progress;
+    std::vector<FFApplication *> apps(1, app);
+    progress.start(sweep.progress_secs, eventlist.now(), timeFromSec(sweep.simtime), ffapps_done, &apps);
+    auto wall_start = std::chrono::steady_clock::now();
+    while (eventlist.doNextEvent())
+        progress.poll(++p.nevents, eventlist.now());
+    p.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    p.final_finish = app->final_finish_time;
+
+    *out << "FinalFinish " << app->final_finish_time << std::endl;
+    out->close();
+}
+
+void worker(sweep_t *sweep)
+{
+    for (size_t n = sweep->next++; n < sweep->points.size(); n = sweep->next++)
+        run_point(*sweep, n);
+}
+
+// the prefix with the first point's parameters, then every point forked from it, procs at a time
+void run_warm(sweep_t &sweep, int procs)
+{
+    point_t &first = sweep.points[0];
+
+    SimContext *ctx = new SimContext(first.seed);
+    SimContext::Scope scope(*ctx);
+    EventList &eventlist = ctx->eventlist;
+
+    TcpPacket::set_packet_size(DEFAULT_PACKET_SIZE - DEFAULT_HEADER_SIZE); // MTU
+    eventlist.setEndtime(timeFromSec(sweep.simtime));
+
+    // flows keep a pointer to the stream: a child reopens this one on its own file
+    std::ofstream *out = new std::ofstream(sweep.ofile + ".warm");
+    TcpRtxTimerScanner *rtx = new TcpRtxTimerScanner(timeFromMs(1), eventlist);
+    FlatTopology *top = new FlatTopology(sweep.no_of_nodes, sweep.flowfile, memFromPkt(first.queue_pkts),
+                                         nullptr, &eventlist, NULL, ECN, first.fused_links);
+    top->set_ecn_threshold(memFromPkt(first.ecn_pkts));
+
+    FFApplication *app = new FFApplication(top, first.ssthresh, out, *rtx, eventlist,
+                                           parse_strategy(first.allreduce_strategy));
+    app->load_taskgraph_flatbuf(sweep.flowfile);
+    app->max_iters = sweep.iters ? sweep.iters : 1;
+    app->start_init_tasks();
+
+    uint64_t nevents = 0;
+    Progress progress;
+    std::vector<FFApplication *> apps(1, app);
+    progress.start(sweep.progress_secs, eventlist.now(), timeFromSec(sweep.simtime), ffapps_done, &apps);
+    auto wall_start = std::chrono::steady_clock::now();
+    if (sweep.warm_iters)
+        while (app->iter_times.size() < sweep.warm_iters && eventlist.doNextEvent())
+            progress.poll(++nevents, eventlist.now());
+    else
+        while (eventlist.now() < timeFromSec(sweep.warm_time) && eventlist.doNextEvent())
+            progress.poll(++nevents, eventlist.now());
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    out->close();
+    cout << "Warm iterations " << app->iter_times.size() << " now " << timeAsMs(eventlist.now()) << " ms events " << nevents
+         << " wall " << wall << endl;
+
+    // FinalFinish, events and wall seconds from the fork on
+    vector<string> results = fork_points(sweep.points.size(), procs, [&](size_t n) {
+        point_t &p = sweep.points[n];
+        out->open(sweep.ofile + "." + itoa(n));
+        top->set_queue_size(memFromPkt(p.queue_pkts));
+        top->set_ecn_threshold(memFromPkt(p.ecn_pkts));
+        app->ssthresh = p.ssthresh;
+        app->set_allreduce_strategy(parse_strategy(p.allreduce_strategy));
+
+        uint64_t nevents = 0;
+        progress.start(sweep.progress_secs, eventlist.now(), timeFromSec(sweep.simtime), ffapps_done, &apps);
+        auto wall_start = std::chrono::steady_clock::now();
+        while (eventlist.doNextEvent())
+            progress.poll(++nevents, eventlist.now());
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+        *out << "FinalFinish " << app->final_finish_time << std::endl;
+        out->close();
+        stringstream result;
+        result << app->final_finish_time << " " << nevents << " " << wall;
+        return result.str();
+    });
+    for (size_t n = 0; n < results.size(); n++)
+    {
+        point_t &p = sweep.points[n];
+        p.final_finish = 0;
+        p.nevents = 0;
+        p.wall = 0;
+        stringstream result(results[n]);
+        result >> p.final_finish >> p.nevents >> p.wall;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    sweep_t sweep;
+    sweep.no_of_nodes = 16;
+    sweep.simtime = 0;
+    sweep.iters = 0;
+    sweep.warm_iters = 0;
+    sweep.warm_time = 0;
+    sweep.progress_secs = 0;
+    sweep.ofile = "sweep";
+    sweep.next = 0;
+    int threads = 1;
+    vector<string> queues(1, "100"), ecn(1, "50"), ssthreshes(1, "15"), strategies(1, "default"), seeds(1, "13"), links(1, "split");
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            exit_error(argv[0], argv[i]);
+        if (!strcmp(argv[i], "-nodes"))
+            sweep.no_of_nodes = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-speed"))
+            SPEED = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-rtt"))
+            RTT = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-flowfile"))
+            sweep.flowfile = argv[i + 1];
+        else if (!strcmp(argv[i], "-simtime"))
+            sweep.simtime = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-iters"))
+            sweep.iters = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-ofile"))
+            sweep.ofile = argv[i + 1];
+        else if (!strcmp(argv[i], "-threads"))
+            threads = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queues = split_list(argv[i + 1]);
+        else if (!strcmp(argv[i], "-K"))
+            ecn = split_list(argv[i + 1]);
+        else if (!strcmp(argv[i], "-ssthresh"))
+            ssthreshes = split_list(argv[i + 1]);
+        else if (!strcmp(argv[i], "-ar"))
+            strategies = split_list(argv[i + 1]);
+        else if (!strcmp(argv[i], "-seed"))
+            seeds = split_list(argv[i + 1]);
+        else if (!strcmp(argv[i], "-links"))
+            links = split_list(argv[i + 1]);
+        else if (!strcmp(argv[i], "-progress"))
+            sweep.progress_secs = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-warm_iters"))
+            sweep.warm_iters = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-warm_time"))
+            sweep.warm_time = atof(argv[i + 1]);
+        else
+            exit_error(argv[0], argv[i]);
+        i++;
+    }
+
+    bool warm = sweep.warm_iters > 0 || sweep.warm_time > 0;
+    if (warm && (seeds.size() > 1 || links.size() > 1))
+    {
+        cerr << "a warm start forks after the network is built and seeded: one -seed and one -links" << endl;
+        exit(1);
+    }
+    if (sweep.warm_iters > 0 && sweep.warm_iters >= max(sweep.iters, (size_t)1))
+    {
+        cerr << "-warm_iters has to be fewer than -iters" << endl;
+        exit(1);
+    }
+
+    for (size_t q = 0; q < queues.size(); q++)
+        for (size_t k = 0; k < ecn.size(); k++)
+            for (size_t s = 0; s < ssthreshes.size(); s++)
+                for (size_t a = 0; a < strategies.size(); a++)
+                    for (size_t r = 0; r < seeds.size(); r++)
+                        for (size_t l = 0; l < links.size(); l++)
+                        {
+                            point_t p;
+                            p.queue_pkts = atoi(queues[q].c_str());
+                            p.ecn_pkts = atoi(ecn[k].c_str());
+                            p.ssthresh = atoi(ssthreshes[s].c_str());
+                            p.allreduce_strategy = strategies[a];
+                            p.seed = strtoull(seeds[r].c_str(), NULL, 10);
+                            if (links[l] != "split" && links[l] != "fused")
+                                exit_error(argv[0], (char *)links[l].c_str());
+                            p.fused_links = links[l] == "fused";
+                            parse_strategy(p.allreduce_strategy); // fail before anything runs
+                            sweep.points.push_back(p);
+                        }
+
+    threads = max(1, min(threads, (int)sweep.points.size()));
+    cout << "points " << sweep.points.size() << (warm ? " processes " : " threads ") << threads << endl;
+
+    auto wall_start = std::chrono::steady_clock::now();
+    if (warm)
+        run_warm(sweep, threads);
+    else
+    {
+        vector<std::thread> pool;
+        for (int t = 0; t < threads; t++)
+            pool.push_back(std::thread(worker, &sweep));
+        for (int t = 0; t < threads; t++)
+            pool[t].join();
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    // point, parameters, FinalFinish, events, wall seconds
+    for (size_t n = 0; n < sweep.points.size(); n++)
+    {
+        point_t &p = sweep.points[n];
+        cout << "Point " << n << " q " << p.queue_pkts << " K " << p.ecn_pkts << " ssthresh " << p.ssthresh << " ar " << p.allreduce_strategy << " seed " << p.seed
+             << " links " << (p.fused_links ? "fused" : "split")
+             << " FinalFinish " << p.final_finish << " events " << p.nevents << " wall " << p.wall << endl;
+    }
+    cout << "Sweep wall " << wall << " s" << endl;
+}
+
+string ntoa(double n)
+{
+    stringstream s;
+    s << n;
+    return s.str();
+}
+
+string itoa(uint64_t n)
+{
+    stringstream s;
+    s << n;
+    return s.str();
+}
@@ -24,6 +24,7 @@
 // #include "test_topology.h"
 #include "agg_os_fattree.h"
 #include "ffapp.h"
+#include "run_stats.h"
 
 #include <list>
 
@@ -97,6 +98,11 @@ int main(int argc, char **argv)
 
   string flowfiles;       // so we can read the flows from a specified file
   double simtime;        // seconds
+  double progress_secs = 0; // -progress: a Progress line on stderr this often, wall seconds
+  size_t iters = 0;        // iterations per app, 0: one, or until converged with -converge
+  int converge_window = 0; // done once this many iteration times in a row changed by < converge_tol
+  double converge_tol = 0.01;
+  FFApplication::FFDoneAction done_action = FFApplication::DONE_KEEP; // what done apps do until all are
   double utiltime = .01; // seconds
 
   // stringstream filename(ios_base::out);
@@ -183,6 +189,37 @@ int main(int argc, char **argv)
       flowfiles = argv[i + 1];
       i++;
     }
+    else if (!strcmp(argv[i], "-iters"))
+    {
+      iters = atoi(argv[i + 1]);
+      cout << "iters " << iters << endl;
+      i++;
+    }
+    else if (!strcmp(argv[i], "-converge"))
+    {
+      converge_window = atoi(argv[i + 1]);
+      converge_tol = atof(argv[i + 2]);
+      cout << "converge window " << converge_window << " tolerance " << converge_tol << endl;
+      i += 2;
+    }
+    else if (!strcmp(argv[i], "-done_action"))
+    {
+      if (!strcmp(argv[i + 1], "keep"))
+        done_action = FFApplication::DONE_KEEP;
+      else if (!strcmp(argv[i + 1], "stop"))
+        done_action = FFApplication::DONE_STOP;
+      else if (!strcmp(argv[i + 1], "fluid"))
+        done_action = FFApplication::DONE_FLUID;
+      else
+        exit_error(argv[0], argv[i + 1]);
+      cout << "done_action " << argv[i + 1] << endl;
+      i++;
+    }
+    else if (!strcmp(argv[i], "-progress"))
+    {
+      progress_secs = atof(argv[i + 1]);
+      i++;
+    }
     else if (!strcmp(argv[i], "-simtime"))
     {
       simtime = atof(argv[i + 1]);
@@ -198,6 +235,7 @@ int main(int argc, char **argv)
     i++;
   }
   srand(13);
+  SimContext::current().reseed(13);
 
   int _no_of_nodes = 0;
   k = 0;
@@ -270,13 +308,26 @@ int main(int argc, char **argv)
   for (int i = 0; i < no_of_nodes; i++) candidates.insert(i);
 
   std::vector<FFApplication*> ffapps;
+  FluidNetwork * fluid = NULL; // done apps' background load with -done_action fluid
+  if (done_action == FFApplication::DONE_FLUID) {
+    fluid = new FluidNetwork(top, eventlist, &fct_util_out);
+    fluid->set_background(timeFromUs(10.0));
+  }
   for (int i = 0; i < flowfile_arr.size(); i++) {
-    std::vector<int> nodes = FFApplication::choose_gpus(candidates, nnodes_for_flowfile[i]);
+    std::vector<int> nodes = FFApplication::choose_gpus(candidates, nnodes_for_flowfile[i], i);
     std::cerr << flowfile_arr[i] << ": ";
     for (int n: nodes) std::cerr << n << ", ";
     std::cerr << endl;
     FFApplication * app = new FFApplication(top, ssthresh, &fct_util_out, nodes, tcpRtxScanner, eventlist);
     app->load_taskgraph_flatbuf(flowfile_arr[i]);
+    app->max_iters = iters ? iters : (converge_window > 0 ? SIZE_MAX : 1);
+    app->converge_window = converge_window;
+    app->converge_tol = converge_tol;
+    app->done_action = done_action;
+    if (fluid) {
+      app->fluid = fluid;
+      app->fluid_min_bytes = UINT64_MAX; // until the app is done
+    }
     app->start_init_tasks();
     ffapps.push_back(app);
   }
@@ -296,13 +347,20 @@ int main(int argc, char **argv)
   //logfile.write("# rtt =" + ntoa(rtt));
 
   // GO!
+  Progress progress;
+  progress.start(progress_secs, eventlist.now(), timeFromSec(simtime), ffapps_done, &ffapps);
+  uint64_t nevents = 0;
   while (eventlist.doNextEvent())
   {
+    progress.poll(++nevents, eventlist.now());
   }
 
   for (int i = 0; i < flowfile_arr.size(); i++) {
     fct_util_out << "FinalFinish_" << flowfile_arr[i] << " " << ffapps[i]->first_iter_time << std::endl;
   }
+  for (FFApplication * app: ffapps) {
+    app->print_iterations(cout);
+  }
 }
 
 string ntoa(double n)
@@ -25,6 +25,7 @@
 // #include "test_topology.h"
 #include "os_fattree.h"
 #include "ffapp.h"
+#include "run_stats.h"
 
 #include <list>
 
@@ -88,6 +89,7 @@ int main(int argc, char **argv) {
 
     string flowfile; // so we can read the flows from a specified file
     double simtime; // seconds
+    double progress_secs = 0; // -progress: a Progress line on stderr this often, wall seconds
     double utiltime=.01; // seconds
 
     // stringstream filename(ios_base::out);
@@ -152,6 +154,9 @@ int main(int argc, char **argv) {
   } else if (!strcmp(argv[i],"-flowfile")) {
     flowfile = argv[i+1];
     i++;
+    } else if (!strcmp(argv[i],"-progress")) {
+        progress_secs = atof(argv[i+1]);
+        i++;
     } else if (!strcmp(argv[i],"-simtime")) {
         simtime = atof(argv[i+1]);
         i++;
@@ -163,6 +168,7 @@ int main(int argc, char **argv) {
     i++;
     }
     srand(13);
+    SimContext::current().reseed(13);
 
     eventlist.setEndtime(timeFromSec(simtime));
     Clock c(timeFromSec(5 / 100.), eventlist);
@@ -225,7 +231,12 @@ int main(int argc, char **argv) {
     //logfile.write("# rtt =" + ntoa(rtt));
 
     // GO!
+    Progress progress;
+    std::vector<FFApplication*> apps(1, &app);
+    progress.start(progress_secs, eventlist.now(), timeFromSec(simtime), ffapps_done, &apps);
+    uint64_t nevents = 0;
     while (eventlist.doNextEvent()) {
+        progress.poll(++nevents, eventlist.now());
     }
 
     fct_util_out << "FinalFinish " << app.final_finish_time << std::endl;
@@ -74,7 +74,7 @@ DCTCPSrcTransfer::doNextEvent() {
 
     //delete _route;
     if (_paths!=NULL){
-	Route* rt = new Route(*(_paths->at(rand()%_paths->size())));
+	Route* rt = new Route(*(_paths->at(SimContext::current().rng.below(_paths->size()))));
 	rt->push_back(_sink);
 	_route = rt;
     }
@@ -16,9 +16,6 @@
   }                                                                         \
 } while (0);                                                                \
 
-static std::random_device rd; 
-static std::mt19937 gen = std::mt19937(rd()); 
-static std::uniform_real_distribution<double> unif(0, 1);
 
 extern uint32_t SPEED;
 
@@ -66,18 +63,23 @@ void DemandRecorder::get_unsatisfied_demand(Matrix2D<double> & tm)
 DynFlatScheduler::DynFlatScheduler(int nnodes, int degree, FlatTopology *topo, 
         OptStrategy method, DemandRecorder* demandrecorder, simtime_picosec reconf_delay, EventList &eventlist)
 : EventSource(eventlist, "DynFlatScheduler"), nnodes(nnodes), degree(degree), demandrecorder(demandrecorder),
-  topo(topo), reconf_delay(reconf_delay), optstrategy(method), eventlist(eventlist)
+  topo(topo), reconf_delay(reconf_delay), optstrategy(method), rng(SimContext::current().seed, RNG_DYN_NET),
+  eventlist(eventlist)
 {
   // demandrecorder.init(nnodes);
   FlatDegConstraintNetworkTopologyGenerator gen{nnodes, degree};
+  queues.reserve(topo->links().size());
+  for (auto & link : topo->links()) {
+    ECNQueue *eq = dynamic_cast<ECNQueue *>(link.queue);
+    assert(eq);
+    queues.push_back(eq);
+  }
   set_all_queues_pause_recved();
-  auto init_conn = gen.generate_topology();
-  for ( int src_port = 0; src_port < nnodes; src_port ++ ) {
-    for ( int dst_port = 0; dst_port < nnodes; dst_port ++ ) {
-      if (src_port == dst_port) continue;
-      topo->queues[src_port][dst_port]->_bitrate = init_conn[src_port * nnodes + dst_port] * speedFromMbps((uint64_t)SPEED);
-      topo->queues[src_port][dst_port]->_ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / topo->queues[src_port][dst_port]->_bitrate);
-    }
+  auto init_conn = gen.generate_topology(rng);
+  for (size_t l = 0; l < queues.size(); l++) {
+    auto & link = topo->links()[l];
+    queues[l]->_bitrate = init_conn[link.src * nnodes + link.dst] * speedFromMbps((uint64_t)SPEED);
+    queues[l]->_ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / queues[l]->_bitrate);
   }
   finish_reconf();
 
@@ -239,22 +241,15 @@ void DynFlatScheduler::finish_reconf()
 {
   // resume_lively_queues();
   // pause_no_bw_queues();
-  for (int i = 0; i < nnodes; i++)
+  for (ECNQueue *eq : queues)
   {
-    for (int j = 0; j < nnodes; j++)
+    // std::cerr << "queue " << eq->str() << " br " << eq->_bitrate << " ps per byte " << eq->_ps_per_byte << " size " << eq->_enqueued.size() << std::endl;
+    if (eq->_bitrate > 0)
     {
-      if (i == j) continue;
-      Queue * q = topo->queues[i][j];
-      ECNQueue *eq = dynamic_cast<ECNQueue *>(q);
-      // std::cerr << "queue " << i << ", " << j << " br " << eq->_bitrate << " ps per byte " << eq->_ps_per_byte << " size " << eq->_enqueued.size() << std::endl;
-      if (eq->_bitrate > 0)
-      {
-        eq->_state_send = LosslessQueue::READY;
-        if (!eq->_enqueued.empty()) {
-          eq->beginService();
-          // std::cerr << "queue " << i << ", " << j << " br " << eq->_bitrate << " ps per byte " << eq->_ps_per_byte << " size " << eq->_enqueued.size() << std::endl;
-          // std::cerr << "\t starting... " << std::endl;
-        }
+      eq->_state_send = LosslessQueue::READY;
+      if (!eq->_enqueued.empty()) {
+        eq->beginService();
+        // std::cerr << "\t starting... " << std::endl;
       }
     }
   }
@@ -262,21 +257,15 @@ void DynFlatScheduler::finish_reconf()
 
 void DynFlatScheduler::set_all_queues_pause_recved()
 {
-  for (int i = 0; i < nnodes; i++)
+  for (ECNQueue *eq : queues)
   {
-    for (int j = 0; j < nnodes; j++)
+    if (eq->queuesize() > 0)
     {
-      if (i == j) continue;
-      Queue * q = topo->queues[i][j];
-      ECNQueue *eq = dynamic_cast<ECNQueue *>(q);
-      if (eq->queuesize() > 0)
-      {
-        eq->_state_send = LosslessQueue::PAUSE_RECEIVED;
-      }
-      else
-      {
-        eq->_state_send = LosslessQueue::PAUSED;
-      }
+      eq->_state_send = LosslessQueue::PAUSE_RECEIVED;
+    }
+    else
+    {
+      eq->_state_send = LosslessQueue::PAUSED;
     }
   }
 }
@@ -348,22 +337,20 @@ void DynFlatScheduler::update_all_queue_bandwidth()
       // assert(/* TODO */ false);
       // episode_bw.fill_zeros( );
       // double delta = double( cnfg.degree ) * double( cnfg.bwxstep_per_wave ) / double( degree );
-      for ( int src_port = 0; src_port < nnodes; src_port ++ ) {
-        for ( int dst_port = 0; dst_port < nnodes; dst_port ++ ) {
-          if (src_port == dst_port) continue;
-          topo->queues[src_port][dst_port]->_bitrate = 0;
-          topo->queues[src_port][dst_port]->_ps_per_byte = std::numeric_limits<simtime_picosec>::max();
-          for ( int ocs_no = 0; ocs_no < degree; ocs_no ++ ) {
-            // uint16_t src_dev = src_port; // port_map.at( ocs_no ).at( src_port )->dev_id;
-            // uint16_t dst_dev = dst_port; // port_map.at( ocs_no ).at( dst_port )->dev_id;
-            bool is_connected = gmodel->getVarByName( "perm_" + to_string( ocs_no ) +
-                "_" + to_string( src_port ) +
-                "_" + to_string( dst_port )).get( GRB_DoubleAttr_X );
-            if ( is_connected ){
-              topo->queues[src_port][dst_port]->_bitrate += speedFromMbps((uint64_t)SPEED);
-              topo->queues[src_port][dst_port]->_ps_per_byte = 
-                (simtime_picosec)((pow(10.0, 12.0) * 8) / topo->queues[src_port][dst_port]->_bitrate);
-            }
+      for ( size_t l = 0; l < queues.size(); l ++ ) {
+        int src_port = topo->links()[l].src, dst_port = topo->links()[l].dst;
+        queues[l]->_bitrate = 0;
+        queues[l]->_ps_per_byte = std::numeric_limits<simtime_picosec>::max();
+        for ( int ocs_no = 0; ocs_no < degree; ocs_no ++ ) {
+          // uint16_t src_dev = src_port; // port_map.at( ocs_no ).at( src_port )->dev_id;
+          // uint16_t dst_dev = dst_port; // port_map.at( ocs_no ).at( dst_port )->dev_id;
+          bool is_connected = gmodel->getVarByName( "perm_" + to_string( ocs_no ) +
+              "_" + to_string( src_port ) +
+              "_" + to_string( dst_port )).get( GRB_DoubleAttr_X );
+          if ( is_connected ){
+            queues[l]->_bitrate += speedFromMbps((uint64_t)SPEED);
+            queues[l]->_ps_per_byte = 
+              (simtime_picosec)((pow(10.0, 12.0) * 8) / queues[l]->_bitrate);
           }
         }
       }
@@ -480,7 +467,7 @@ void DynFlatScheduler::update_all_queue_bandwidth()
                        wave_inv;
         auto rounded_alloc = uint16_t(alloc);
         double diff = alloc - rounded_alloc;
-        double r = ((double)rand() / (RAND_MAX));
+        double r = rng.uniform();
         alloc = (r > diff ? alloc : alloc + 1);
         allocation.set_elem(src, dst, alloc);
       }
@@ -514,12 +501,10 @@ void DynFlatScheduler::update_all_queue_bandwidth()
 
       // TODO episode_bw.mul_by( cnfg.bwxstep_per_wave );
       // assert(/* TODO */ false);
-      for ( int src_port = 0; src_port < nnodes; src_port ++ ) {
-        for ( int dst_port = 0; dst_port < nnodes; dst_port ++ ) {
-          if (src_port == dst_port) continue;
-          topo->queues[src_port][dst_port]->_bitrate = allocation.get_elem(src_port, dst_port) * speedFromMbps((uint64_t)SPEED);
-          topo->queues[src_port][dst_port]->_ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / topo->queues[src_port][dst_port]->_bitrate);
-        }
+      for ( size_t l = 0; l < queues.size(); l ++ ) {
+        auto & link = topo->links()[l];
+        queues[l]->_bitrate = allocation.get_elem(link.src, link.dst) * speedFromMbps((uint64_t)SPEED);
+        queues[l]->_ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / queues[l]->_bitrate);
       }
       delete[] flows;
     }
@@ -600,12 +585,10 @@ void DynFlatScheduler::update_all_queue_bandwidth()
         } 
       }
     }
-    for ( int src_port = 0; src_port < nnodes; src_port ++ ) {
-      for ( int dst_port = 0; dst_port < nnodes; dst_port ++ ) {
-        if (src_port == dst_port) continue;
-        topo->queues[src_port][dst_port]->_bitrate = conn[src_port * nnodes + dst_port] * speedFromMbps((uint64_t)SPEED);
-        topo->queues[src_port][dst_port]->_ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / topo->queues[src_port][dst_port]->_bitrate);
-      }
+    for ( size_t l = 0; l < queues.size(); l ++ ) {
+      auto & link = topo->links()[l];
+      queues[l]->_bitrate = conn[link.src * nnodes + link.dst] * speedFromMbps((uint64_t)SPEED);
+      queues[l]->_ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / queues[l]->_bitrate);
     }
   }
 }
@@ -614,21 +597,18 @@ void DynFlatScheduler::normalize_tm(Matrix2D<double> &normal_tm)
 {
   demandrecorder->get_unsatisfied_demand(normal_tm);
   uint64_t max_entry = 0;
-  for (int i = 0; i < nnodes; i++) {
-    for (int j = 0; j < nnodes; j++) {
-      if (i == j) continue;
-      Queue * q = topo->queues[i][j];
-      ECNQueue *eq = dynamic_cast<ECNQueue *>(q);
-      // std::cerr << "queue " << i << ", " << j << " br " << eq->_bitrate << " size " << eq->_enqueued.size() << std::endl;
-      // if (eq->_bitrate > 0)
-      normal_tm.add_elem_by(i, j, eq->_enqueued.size());
-      if (normal_tm.get_elem(i, j) > max_entry) {
-        max_entry = normal_tm.get_elem(i, j);
-      }
-      //       if (demandrecorder.unsatisfied_demand[i * nnodes + j] > max_entry) {
-      //   max_entry = demandrecorder.unsatisfied_demand[i * nnodes + j];
-      // }
+  for (size_t l = 0; l < queues.size(); l++) {
+    int i = topo->links()[l].src, j = topo->links()[l].dst;
+    ECNQueue *eq = queues[l];
+    // std::cerr << "queue " << i << ", " << j << " br " << eq->_bitrate << " size " << eq->_enqueued.size() << std::endl;
+    // if (eq->_bitrate > 0)
+    normal_tm.add_elem_by(i, j, eq->_enqueued.size());
+    if (normal_tm.get_elem(i, j) > max_entry) {
+      max_entry = normal_tm.get_elem(i, j);
     }
+    //       if (demandrecorder.unsatisfied_demand[i * nnodes + j] > max_entry) {
+    //   max_entry = demandrecorder.unsatisfied_demand[i * nnodes + j];
+    // }
   }
   // if (max_entry == 0) {
   //   max_entry = 1;
@@ -647,7 +627,7 @@ FlatDegConstraintNetworkTopologyGenerator::FlatDegConstraintNetworkTopologyGener
 : num_nodes(num_nodes), degree(degree)
 {}
 
-std::vector<size_t> FlatDegConstraintNetworkTopologyGenerator::generate_topology() const
+std::vector<size_t> FlatDegConstraintNetworkTopologyGenerator::generate_topology(Rng & rng) const
 {
   std::vector<size_t> conn = std::vector<size_t>(num_nodes*num_nodes, 0);
   
@@ -659,8 +639,8 @@ std::vector<size_t> FlatDegConstraintNetworkTopologyGenerator::generate_topology
   std::uniform_int_distribution<> distrib(0, num_nodes - 1);
 
   while ((long)visited_node.size() != num_nodes) {
-    distrib(gen);
-    int next_step = distrib(gen);
+    distrib(rng);
+    int next_step = distrib(rng);
     if (next_step == curr_node) {
       continue;
     } 
@@ -690,8 +670,8 @@ std::vector<size_t> FlatDegConstraintNetworkTopologyGenerator::generate_topology
   int a = 0, b = 0;
 
   while (node_with_avail_if.size() > 1) {
-    a = distrib(gen);
-    while ((b = distrib(gen)) == a);
+    a = distrib(rng);
+    while ((b = distrib(rng)) == a);
 
     assert(conn[get_id(node_with_avail_if[a].first, node_with_avail_if[b].first)] < degree);
     conn[get_id(node_with_avail_if[a].first, node_with_avail_if[b].first)]++;
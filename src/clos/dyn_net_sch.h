@@ -4,6 +4,7 @@
 #include <vector>
 #include "flat_topology.h"
 #include "queue.h"
+#include "rng.h"
 #ifdef USE_GUROBI
 #include "gurobi_c++.h"
 #endif
@@ -19,6 +20,8 @@
 #include <map>
 #include <stack>
 
+class ECNQueue;
+
 template< class T >
 class Matrix2D;
 
@@ -330,9 +333,11 @@ public:
   GRBModel *gmodel;
 #endif
   FlatTopology* topo;
+  std::vector<ECNQueue*> queues; // topo->links() in order, cast once
   simtime_picosec reconf_delay;
   DynNetworkStatus status;
   OptStrategy optstrategy;
+  Rng rng; // the initial topology and allocation rounding, RNG_DYN_NET
   EventList & eventlist;
 
   DemandRecorder * demandrecorder;
@@ -341,7 +346,7 @@ public:
 class FlatDegConstraintNetworkTopologyGenerator {
 public:
     FlatDegConstraintNetworkTopologyGenerator(int num_nodes, int degree);
-    std::vector<size_t> generate_topology() const;
+    std::vector<size_t> generate_topology(Rng & rng) const;
 public:
     inline int get_id(int i, int j) const;
     inline int get_if_in_use(int node, const std::vector<size_t> & conn) const;
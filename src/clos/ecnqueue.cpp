@@ -93,6 +93,7 @@ void ECNQueue::completeService()
 		pkt->set_flags(pkt->flags() | ECN_CE);
 
 	_queuesize -= pkt->size();
+	_bytes_served += pkt->size();
 	// pkt->flow().logTraffic(*pkt, *this, TrafficLogger::PKT_DEPART);
 	if (_logger)
 		_logger->logQueue(*this, QueueLogger::PKT_SERVICE, *pkt);
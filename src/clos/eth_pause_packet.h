@@ -32,7 +32,7 @@ class EthPausePacket : public Packet {
 
  protected:
     unsigned int _sleepTime;
-    static PacketDB<EthPausePacket> _packetdb;
+    static thread_local PacketDB<EthPausePacket> _packetdb;
 };
 
 #endif
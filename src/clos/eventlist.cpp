@@ -1,11 +1,17 @@
 // -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-        
 
 #include "eventlist.h"
+#ifdef EVENT_PROFILE
+#include "event_profile.h"
+#endif
 //#include <iostream>
 
 EventList::EventList()
     : _endtime(0),
       _lasteventtime(0)
+#ifdef EVENT_PROFILE
+      , _profiler(NULL)
+#endif
 {
 }
 
@@ -25,6 +31,12 @@ EventList::doNextEvent()
     _pendingsources.erase(_pendingsources.begin());
     assert(nexteventtime >= _lasteventtime);
     _lasteventtime = nexteventtime; // set this before calling doNextEvent, so that this::now() is accurate
+#ifdef EVENT_PROFILE
+    if (_profiler) {
+	_profiler->run(*nextsource, nexteventtime);
+	return true;
+    }
+#endif
     nextsource->doNextEvent();
     return true;
 }
@@ -59,6 +71,26 @@ EventList::cancelPendingSource(EventSource &src) {
     }
 }
 
+void 
+EventList::cancelPendingSource(EventSource &src, simtime_picosec when) {
+    pair<pendingsources_t::iterator, pendingsources_t::iterator> r = _pendingsources.equal_range(when);
+    for (pendingsources_t::iterator i = r.first; i != r.second; i++) {
+	if (i->second == &src) {
+	    _pendingsources.erase(i);
+	    return;
+	}
+    }
+}
+
+EventSource* 
+EventList::lastPendingSource(simtime_picosec when) {
+    pendingsources_t::iterator i = _pendingsources.upper_bound(when);
+    if (i == _pendingsources.begin())
+	return NULL;
+    i--;
+    return i->first == when ? i->second : NULL;
+}
+
 void 
 EventList::reschedulePendingSource(EventSource &src, simtime_picosec when) {
     cancelPendingSource(src);
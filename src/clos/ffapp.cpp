@@ -1,22 +1,25 @@
 #include <fstream>
 #include <streambuf>
 #include <iostream>
-#include <random>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <assert.h>
+#include <string.h>
 
 #include "ffapp.h"
 #include "ndp.h"
 #include "dctcp.h"
 #include "route.h"
+#include "mapped_file.h"
+#include "rng.h"
 
 #include "json.hpp"
 
 
 using json = nlohmann::json;
 
-int FFApplication::total_apps = 0;
-int FFApplication::finished_apps = 0;
+const uint32_t FFApplication::NO_CHAIN;
 
 // FFApplication::FFApplication(Topology* top, int cwnd, double pull_rate,  
 // 			NdpRtxTimerScanner & nrts, NdpSinkLoggerSampling & sl, EventList & eventlist, std::string taskgraph)
@@ -25,111 +28,277 @@ FFApplication::FFApplication(Topology* top, int ss, ofstream * _fstream_out, //T
     TcpRtxTimerScanner & rtx, EventList & eventlist, FFAllReduceStrategy ars)
 : topology(top), ssthresh(ss), eventlist(eventlist), 
   fstream_out(_fstream_out), tcpRtxScanner(rtx), 
-  final_finish_time(0), n_finished_tasks(0), allreduce_strategy(ars) {
+  final_finish_time(0), n_finished_tasks(0), allreduce_strategy(ars), ctx(SimContext::current()) {
     // std::cerr << "allreduce_strategy: " << allreduce_strategy << std::endl;
-    FFApplication::total_apps++;
+    id = ctx.total_apps++;
     fancy_ring = false;
     finished_once = false;
+    max_iters = 1;
+    converge_window = 0;
+    converge_tol = 0.01;
+    done_action = DONE_KEEP;
+    iter_start = 0;
+    fluid = NULL;
+    fluid_min_bytes = 0;
+    fluid_task_types = 0;
+    persistent_ar = false;
 }
 
 FFApplication::FFApplication(Topology* top, int ss, ofstream * _fstream_out, std::vector<int> gpus,
     TcpRtxTimerScanner & rtx, EventList & eventlist, FFAllReduceStrategy ars)
 : topology(top), ssthresh(ss), eventlist(eventlist), 
   fstream_out(_fstream_out), gpus(gpus), tcpRtxScanner(rtx), 
-  final_finish_time(0), n_finished_tasks(0), allreduce_strategy(ars) {
+  final_finish_time(0), n_finished_tasks(0), allreduce_strategy(ars), ctx(SimContext::current()) {
     // std::cerr << "allreduce_strategy: " << allreduce_strategy << std::endl;
-    FFApplication::total_apps++;
+    id = ctx.total_apps++;
     fancy_ring = false;
     finished_once = false;
+    max_iters = 1;
+    converge_window = 0;
+    converge_tol = 0.01;
+    done_action = DONE_KEEP;
+    iter_start = 0;
+    fluid = NULL;
+    fluid_min_bytes = 0;
+    fluid_task_types = 0;
+    persistent_ar = false;
 }
 
 FFApplication::~FFApplication() {
 
-    for (auto item: tasks) {
-        delete item.second;
+    for (FFTask * task: tasks) {
+        delete task;
     }
-    for (auto item: devices) {
-        delete item.second;
+    for (FFDevice * device: devices) {
+        delete device;
     }
 
 }
 
-std::vector<int> FFApplication::choose_gpus(std::unordered_set<int> & candidates, int n)
+FFConnection * FFApplication::path_connection(int src_node, int dst_node, simtime_picosec rto) {
+    FFConnection *& conn = connections[connection_key(src_node, dst_node, 0)];
+    if (conn) {
+        return conn;
+    }
+
+    vector<const Route*>* srcpaths = topology->get_paths(src_node, dst_node);
+    // keyed by the pair, so it doesn't matter which of the app's flows asks first
+    uint64_t key = connection_key(src_node, dst_node, 0);
+    Route * routeout = new Route(*(srcpaths->at(Rng::below(Rng::at(ctx.seed, RNG_FFAPP, id, key), srcpaths->size()))));
+    vector<const Route*>* dstpaths = topology->get_paths(dst_node, src_node);
+    Route * routein = new Route(*(dstpaths->at(Rng::below(Rng::at(ctx.seed, RNG_FFAPP, id, key | 1), dstpaths->size()))));
+    delete srcpaths;
+    delete dstpaths;
+
+    conn = new FFConnection(this, src_node, dst_node, routeout, routein, rto);
+    return conn;
+}
+
+std::vector<int> FFApplication::choose_gpus(std::unordered_set<int> & candidates, int n, int job)
 {
     std::vector<int> result;
     assert(n <= candidates.size());
-    std::sample(candidates.begin(), candidates.end(), std::back_inserter(result),
-        n, std::mt19937{std::random_device{}()});
+    // sampled from the ids in order, unordered_set iteration order isn't up to us
+    std::vector<int> sorted(candidates.begin(), candidates.end());
+    std::sort(sorted.begin(), sorted.end());
+    Rng rng(SimContext::current().seed, RNG_PLACEMENT, job);
+    std::sample(sorted.begin(), sorted.end(), std::back_inserter(result), n, rng);
     for (int i : result) {
         candidates.erase(candidates.find(i));
     }
     return result;
 }
 
-void FFApplication::load_taskgraph_json(std::string & taskgraph) {
-    // read the taskgraph and parse it
-    std::ifstream t(taskgraph);
-    std::string tg_str;
-
-    t.seekg(0, std::ios::end);   
-    tg_str.reserve(t.tellg());
-    t.seekg(0, std::ios::beg);
+namespace {
+
+// Builds a JSON task graph's devices and tasks while the parser streams over the file, without a
+// DOM: each record is created as its object closes. What a task refers to by id is fixed up at the
+// end, so next_tasks may point forward and the tasks may even come before the devices (tasks are
+// then held back as records until the devices are known, keeping them in file order).
+class TaskGraphJsonSax : public json::json_sax_t {
+public:
+    TaskGraphJsonSax(FFApplication * app) : app(app), depth(0), section(S_OTHER), field(F_OTHER), ntasks(0) {}
+
+    bool null() { return true; }
+    bool boolean(bool) { return true; }
+    bool number_integer(json::number_integer_t v) { return number(v, v); }
+    bool number_unsigned(json::number_unsigned_t v) { return number(v, v); }
+    bool number_float(json::number_float_t v, const json::string_t &) { return number(v, v); }
+    bool string(json::string_t & v) {
+        if (depth == 3 && field == F_TYPE)
+            rec.type = v;
+        return true;
+    }
+    bool binary(json::binary_t &) { return true; }
+    bool start_object(std::size_t) {
+        if (++depth == 3)
+            rec = record();
+        return true;
+    }
+    bool end_object() {
+        if (depth-- == 3) {
+            if (section == S_DEVICES)
+                add_device();
+            else if (section == S_TASKS)
+                add_task();
+        }
+        return true;
+    }
+    bool start_array(std::size_t) { depth++; return true; }
+    bool end_array() { depth--; return true; }
+    bool key(json::string_t & k) {
+        if (depth == 1)
+            section = k == "devices" ? S_DEVICES : k == "tasks" ? S_TASKS : S_OTHER;
+        else if (depth == 3)
+            field = field_of(k);
+        return true;
+    }
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+
+    // resolve what was referenced by id, in the same order the DOM loader built things
+    void finish() {
+        for (record & r: pending)
+            create_task(r);
+        pending.clear();
+        pending.shrink_to_fit();
+
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        edges.reserve(next_ids.size());
+        for (auto & next: next_ids) {
+            auto i = task_index.find(next.second);
+            if (i == task_index.end()) {
+                std::cerr << "next task " << next.second << " does not exist" << std::endl;
+                assert("Bad task graph!" && false);
+            }
+            edges.push_back(std::make_pair(next.first, i->second));
+        }
+        next_ids.clear();
+        next_ids.shrink_to_fit();
+        app->build_successors(edges);
+    }
+
+private:
+    enum section_t { S_OTHER, S_DEVICES, S_TASKS };
+    enum field_t {
+        F_OTHER, F_TYPE, F_DEVICEID, F_BANDWIDTH, F_NODEID, F_GPUID, F_FROMNODE, F_TONODE, F_FROMGPU, F_TOGPU,
+        F_TASKID, F_XFERSIZE, F_RUNTIME, F_NEXT_TASKS
+    };
+    struct record {
+        std::string type;
+        uint64_t deviceid, taskid, xfersize;
+        double bandwidth, runtime;
+        int nodeid, gpuid, fromnode, tonode, fromgpu, togpu;
+        record() : deviceid(0), taskid(0), xfersize(0), bandwidth(0), runtime(0),
+            nodeid(0), gpuid(0), fromnode(0), tonode(0), fromgpu(0), togpu(0) {}
+    };
+
+    static field_t field_of(const std::string & k) {
+        static const std::unordered_map<std::string, field_t> fields = {
+            {"type", F_TYPE}, {"deviceid", F_DEVICEID}, {"bandwidth", F_BANDWIDTH}, {"nodeid", F_NODEID},
+            {"gpuid", F_GPUID}, {"fromnode", F_FROMNODE}, {"tonode", F_TONODE}, {"fromgpu", F_FROMGPU},
+            {"togpu", F_TOGPU}, {"taskid", F_TASKID}, {"xfersize", F_XFERSIZE}, {"runtime", F_RUNTIME},
+            {"next_tasks", F_NEXT_TASKS},
+        };
+        auto i = fields.find(k);
+        return i == fields.end() ? F_OTHER : i->second;
+    }
+
+    bool number(uint64_t u, double d) {
+        if (depth == 4 && field == F_NEXT_TASKS && section == S_TASKS) {
+            next_ids.push_back(std::make_pair(ntasks, u)); // ntasks is this task's index-to-be
+            return true;
+        }
+        if (depth != 3)
+            return true;
+        switch (field) {
+        case F_DEVICEID: rec.deviceid = u; break;
+        case F_BANDWIDTH: rec.bandwidth = d; break;
+        case F_NODEID: rec.nodeid = u; break;
+        case F_GPUID: rec.gpuid = u; break;
+        case F_FROMNODE: rec.fromnode = u; break;
+        case F_TONODE: rec.tonode = u; break;
+        case F_FROMGPU: rec.fromgpu = u; break;
+        case F_TOGPU: rec.togpu = u; break;
+        case F_TASKID: rec.taskid = u; break;
+        case F_XFERSIZE: rec.xfersize = u; break;
+        case F_RUNTIME: rec.runtime = d; break;
+        default: break;
+        }
+        return true;
+    }
 
-    tg_str.assign((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());    
+    void add_device() {
+        app->devices.push_back(new FFDevice(app, rec.type, rec.bandwidth, rec.nodeid, rec.gpuid,
+            rec.fromnode, rec.tonode, rec.fromgpu, rec.togpu));
+        device_ids[rec.deviceid] = app->devices.back();
+    }
 
-    auto tg_json = json::parse(tg_str);
+    void add_task() {
+        task_index[rec.taskid] = ntasks++;
+        if (pending.empty() && device_ids.count(rec.deviceid))
+            create_task(rec);
+        else
+            pending.push_back(rec);
+    }
 
-    for (auto & jsdev: tg_json["devices"]) {
-        devices[jsdev["deviceid"].get<uint64_t>()] = new FFDevice(
-            this,
-            jsdev["type"].get<std::string>(), 
-            jsdev["bandwidth"].get<float>(), 
-            jsdev["nodeid"].get<int>(), 
-            jsdev["gpuid"].get<int>(), 
-            jsdev["fromnode"].get<int>(), 
-            jsdev["tonode"].get<int>(), 
-            jsdev["fromgpu"].get<int>(), 
-            jsdev["togpu"].get<int>()
-        );
+    void create_task(record & r) {
+        auto i = device_ids.find(r.deviceid);
+        if (i == device_ids.end()) {
+            std::cerr << "task " << r.taskid << " is on device " << r.deviceid << ", which does not exist" << std::endl;
+            assert("Bad task graph!" && false);
+        }
+        app->tasks.push_back(new FFTask(app, r.type, i->second, r.xfersize, r.runtime));
     }
 
-    unordered_map<uint64_t, unsigned int> counters;
+    FFApplication * app;
+    int depth; // 1: top-level object, 2: a section's array, 3: a device or task, 4: next_tasks
+    section_t section;
+    field_t field;
+    record rec;
 
-    for (auto & jstask: tg_json["tasks"]) {
-        uint64_t this_task = jstask["taskid"].get<uint64_t>();
-        tasks[this_task] = new FFTask(
-            this,
-            jstask["type"].get<std::string>(), 
-            devices[jstask["deviceid"].get<uint64_t>()], 
-            jstask["xfersize"].get<uint64_t>(), 
-            jstask["runtime"].get<float>()
-        );
-              
-        for (auto & jsnext: jstask["next_tasks"]) {
-            uint64_t next_id = jsnext.get<uint64_t>();
-            tasks[this_task]->next_tasks.push_back(next_id);
-            if (counters.find(next_id) == counters.end()) {
-                counters[next_id] = 1;
-            }
-            else {
-                counters[next_id]++;
-            }
-        }
+    // ids -> dense indices, only needed while loading
+    unordered_map<uint64_t, FFDevice*> device_ids;
+    unordered_map<uint64_t, uint32_t> task_index;
+    uint32_t ntasks;
+    std::vector<record> pending; // tasks seen before their device
+    std::vector<std::pair<uint32_t, uint64_t>> next_ids; // (task index, next task id)
+};
+
+}
+
+void FFApplication::load_taskgraph_json(std::string & taskgraph) {
+    // streamed straight from the file; only the tasks and devices themselves are kept
+    std::ifstream t(taskgraph);
+    if (!t.is_open()) {
+        std::cerr << "Failed to read " << taskgraph << std::endl;
+        assert("Failed to read file!" && false);
     }
 
-    for (auto item: counters) {
-        tasks[item.first]->counter = item.second;
+    TaskGraphJsonSax sax(this);
+    if (!json::sax_parse(t, &sax)) {
+        std::cerr << taskgraph << " is not a valid task graph" << std::endl;
+        assert("Failed to parse file!" && false);
     }
+    sax.finish();
 }
 
 void FFApplication::load_taskgraph_flatbuf(std::string & taskgraph) {
-    string buffer;
-    bool success = FFApplication::LoadFileRaw(taskgraph.c_str(), &buffer);
-    if (!success) {
+    // read in place; everything we keep is copied into tasks and devices
+    MappedFile file;
+    if (!file.open(taskgraph.c_str())) {
+        std::cerr << "Failed to read " << taskgraph << std::endl;
         assert("Failed to read file!" && false);
     }
+    flatbuffers::Verifier verifier(file.data(), file.size(), 64, std::numeric_limits<flatbuffers::uoffset_t>::max());
+    if (!verifier.VerifyBuffer<FlatBufTaskGraph::TaskGraph>(nullptr)) {
+        std::cerr << taskgraph << " is not a valid task graph" << std::endl;
+        assert("Failed to verify file!" && false);
+    }
 
-    auto fbuf_tg = flatbuffers::GetRoot<FlatBufTaskGraph::TaskGraph>(buffer.c_str());
+    auto fbuf_tg = flatbuffers::GetRoot<FlatBufTaskGraph::TaskGraph>(file.data());
     ngpupernode = fbuf_tg->ngpupernode();
     nswitches = fbuf_tg->nswitch();
     nnodes = fbuf_tg->nnode();
@@ -139,30 +308,37 @@ void FFApplication::load_taskgraph_flatbuf(std::string & taskgraph) {
         std::iota(std::begin(gpus), std::end(gpus), 0);
     }
 
+    // ids -> dense indices, only needed while loading
+    unordered_map<uint64_t, FFDevice*> device_ids;
+    unordered_map<uint64_t, uint32_t> task_index;
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+
     // load device 
-    for (int i = 0; i < fbuf_tg->devices()->size(); i++) {
+    devices.reserve(fbuf_tg->devices()->size());
+    for (flatbuffers::uoffset_t i = 0; i < fbuf_tg->devices()->size(); i++) {
         auto dev = fbuf_tg->devices()->Get(i);
-        devices[dev->deviceid()] = new FFDevice(
+        devices.push_back(new FFDevice(
             this,
             dev->type(),
             dev->nodeid(),
             dev->deviceproperty(),
             dev->bandwidth()
-        );
+        ));
+        device_ids[dev->deviceid()] = devices.back();
     }
 
     // load rings if they exist
     if (fbuf_tg->rings() && fbuf_tg->rings()->size() > 0) {
         fancy_ring = true;
-        for (int i = 0; i < fbuf_tg->rings()->size(); i++) {
+        for (flatbuffers::uoffset_t i = 0; i < fbuf_tg->rings()->size(); i++) {
             auto& this_ring = *fbuf_tg->rings()->Get(i);
             uint64_t ring_sz = this_ring.ringsz();
             std::cerr << "fancy ring, ring_sz " << ring_sz << ", routes ";
             std::vector<std::vector<int>> routes{};
-            for (int j = 0; j < this_ring.ringpaths()->size(); j++) {
+            for (flatbuffers::uoffset_t j = 0; j < this_ring.ringpaths()->size(); j++) {
                 auto & this_path = *this_ring.ringpaths()->Get(j);
                 std::vector<int> ringdesc{};
-                for (int k = 0; k < this_path.jumps()->size(); k++) {
+                for (flatbuffers::uoffset_t k = 0; k < this_path.jumps()->size(); k++) {
                     ringdesc.push_back(this_path.jumps()->Get(k));
                     std::cerr << this_path.jumps()->Get(k) << ", ";
                 }
@@ -173,12 +349,15 @@ void FFApplication::load_taskgraph_flatbuf(std::string & taskgraph) {
         }
     }
     // load tasks
-    for (int i = 0; i < fbuf_tg->tasks()->size(); i++) {
+    tasks.reserve(fbuf_tg->tasks()->size());
+    task_index.reserve(fbuf_tg->tasks()->size());
+    for (flatbuffers::uoffset_t i = 0; i < fbuf_tg->tasks()->size(); i++) {
         auto &this_task = *fbuf_tg->tasks()->Get(i);
+        task_index[this_task.taskid()] = tasks.size();
 
         if (this_task.type() == FlatBufTaskGraph::SimTaskType_TASK_ALLREDUCE) {
             std::vector<uint64_t> node_group;
-            for (int j = 0; j < this_task.nexttasks()->size() ; j++) {
+            for (flatbuffers::uoffset_t j = 0; j < this_task.nexttasks()->size(); j++) {
                 node_group.push_back(reinterpret_cast<uint64_t>(this_task.nexttasks()->Get(j)));
             }
             std::cerr << "ar size: " << this_task.xfersize() << std::endl;
@@ -186,45 +365,16 @@ void FFApplication::load_taskgraph_flatbuf(std::string & taskgraph) {
             // if (artask.algo() == TaskGraphProtoBuf::AllReduceTask_AllReduceAlg_ALLREDUCE_RING) {
             if (fancy_ring) {
                 // cout << "fancy" << endl;
-                tasks[this_task.taskid()] = new FFNewRingAllreduce(
+                tasks.push_back(new FFNewRingAllreduce(
                     this, 
                     node_group, 
                     selected_jumps[node_group.size()],
                     this_task.xfersize(),
                     this_task.runtime()
-                );
+                ));
             }
             else {
-                if (allreduce_strategy == FFApplication::FF_RING_AR || 
-                    allreduce_strategy == FFApplication::FF_DEFAULT_AR) 
-                {
-                    // cout << "ring" << endl;
-                    tasks[this_task.taskid()] = new FFRingAllreduce(
-                        this,
-                        node_group, 
-                        this_task.xfersize(),
-                        this_task.runtime()
-                    );
-                }
-                else if (allreduce_strategy == FFApplication::FF_PS_AR)
-                {
-                    // cout << "ps" << endl;
-                    tasks[this_task.taskid()] = new FFPSAllreduce(
-                        this,
-                        node_group, 
-                        this_task.xfersize(),
-                        this_task.runtime()
-                    );
-                }
-                else if (allreduce_strategy == FFApplication::FF_DPS_AR) {
-                    // cout << "dps" << endl;
-                    tasks[this_task.taskid()] = new FFDPSAllreduce(
-                        this,
-                        node_group, 
-                        this_task.xfersize(),
-                        this_task.runtime()
-                    );
-                } 
+                tasks.push_back(new_allreduce(node_group, this_task.xfersize(), this_task.runtime()));
             }
             // }
             // else if (artask.algo() == TaskGraphProtoBuf::AllReduceTask_AllReduceAlg_ALLREDUCE_PSERVER) {
@@ -244,28 +394,109 @@ void FFApplication::load_taskgraph_flatbuf(std::string & taskgraph) {
         }
 
         else {
-            tasks[this_task.taskid()] = new FFTask(
+            tasks.push_back(new FFTask(
                 this, 
                 this_task.type(), 
-                devices[this_task.deviceid()], 
+                device_ids[this_task.deviceid()], 
                 this_task.xfersize(), 
                 this_task.runtime()
-            );
-                
-            for (int j = 0; j < this_task.nexttasks()->size(); j++) {
-                uint64_t next_id = this_task.nexttasks()->Get(j);
-                tasks[this_task.taskid()]->next_tasks.push_back(next_id);
-                if (counters.find(next_id) == counters.end()) {
-                    counters[next_id] = 1;
-                }
-                else {
-                    counters[next_id]++;
-                }
-            }
+            ));
         }
     }
-    for (auto item: counters) {
-        tasks[item.first]->counter = item.second;
+
+    // successors, now that every taskid has its index
+    // (an allreduce's nexttasks holds its node group, not successors)
+    for (flatbuffers::uoffset_t i = 0; i < fbuf_tg->tasks()->size(); i++) {
+        auto &this_task = *fbuf_tg->tasks()->Get(i);
+        if (this_task.type() == FlatBufTaskGraph::SimTaskType_TASK_ALLREDUCE)
+            continue;
+        for (flatbuffers::uoffset_t j = 0; j < this_task.nexttasks()->size(); j++) {
+            edges.push_back(std::make_pair(i, task_index.at(this_task.nexttasks()->Get(j))));
+        }
+    }
+    build_successors(edges);
+}
+
+FFTask * FFApplication::new_allreduce(std::vector<uint64_t> & node_group, uint64_t size, double runtime) {
+    if (allreduce_strategy == FFApplication::FF_PS_AR) {
+        return new FFPSAllreduce(this, node_group, size, runtime);
+    }
+    else if (allreduce_strategy == FFApplication::FF_DPS_AR) {
+        return new FFDPSAllreduce(this, node_group, size, runtime);
+    }
+    return new FFRingAllreduce(this, node_group, size, runtime);
+}
+
+void FFApplication::set_allreduce_strategy(FFAllReduceStrategy ars) {
+    allreduce_strategy = ars;
+    if (fancy_ring) {
+        return;
+    }
+    for (size_t i = 0; i < tasks.size(); i++) {
+        FFTask * t = tasks[i];
+        // one that is ready or running has its flows and events out there, leave it be
+        if (t->type != FFTask::TASK_ALLREDUCE || t->state != FFTask::TASK_NOT_READY) {
+            continue;
+        }
+        std::vector<uint64_t> node_group;
+        uint64_t size;
+        if (FFRingAllreduce * ar = dynamic_cast<FFRingAllreduce *>(t)) {
+            node_group = ar->node_group;
+            size = ar->operator_size;
+        }
+        else if (FFPSAllreduce * ar = dynamic_cast<FFPSAllreduce *>(t)) {
+            node_group = ar->node_group;
+            size = ar->operator_size;
+        }
+        else {
+            FFDPSAllreduce * dps = dynamic_cast<FFDPSAllreduce *>(t);
+            assert(dps);
+            node_group = dps->node_group;
+            size = dps->operator_size;
+        }
+        // successors and chains refer to tasks by index, so the new one just takes the old one's;
+        // the old one isn't freed, flows of its earlier iterations may still name it
+        FFTask * replacement = new_allreduce(node_group, size, (double)t->run_time / 1000000000ULL);
+        replacement->idx = t->idx;
+        replacement->ready_time = t->ready_time;
+        tasks[i] = replacement;
+    }
+}
+
+void FFApplication::build_successors(std::vector<std::pair<uint32_t, uint32_t>> & edges) {
+    size_t ntasks = tasks.size();
+    for (uint32_t i = 0; i < ntasks; i++) {
+        tasks[i]->idx = i;
+    }
+
+    succ_off.assign(ntasks + 1, 0);
+    indegree.assign(ntasks, 0);
+    for (auto & e: edges) {
+        succ_off[e.first + 1]++;
+        indegree[e.second]++;
+    }
+    for (size_t i = 0; i < ntasks; i++) {
+        succ_off[i + 1] += succ_off[i];
+    }
+    // stable fill keeps each task's successors in file order
+    succ.resize(edges.size());
+    std::vector<uint32_t> fill(succ_off.begin(), succ_off.end() - 1);
+    for (auto & e: edges) {
+        succ[fill[e.first]++] = e.second;
+    }
+    counters = indegree;
+
+    // only straight chains: a local task whose one successor is local on the same device and
+    // waits for nothing else
+    chain_next.assign(ntasks, NO_CHAIN);
+    for (uint32_t i = 0; i < ntasks; i++) {
+        if (succ_off[i + 1] - succ_off[i] != 1)
+            continue;
+        uint32_t j = succ[succ_off[i]];
+        if (indegree[j] == 1 && tasks[i]->is_local() && tasks[j]->is_local() 
+                && tasks[i]->device == tasks[j]->device) {
+            chain_next[i] = j;
+        }
     }
 }
 
@@ -357,10 +588,10 @@ void FFApplication::load_taskgraph_protobuf(std::string & taskgraph) {
 void FFApplication::start_init_tasks() {
     simtime_picosec delta = 0;
     int count = 0;
-    for (auto task: tasks) {
-        //std::cerr << "guid:" << task.second->guid << "size: " << task.second->preTasks.size() << std::endl;
-        FFTask * t = task.second;
-        if (t->counter == 0) {
+    iter_start = eventlist.now();
+    for (size_t i = 0; i < tasks.size(); i++) {
+        FFTask * t = tasks[i];
+        if (counters[i] == 0) {
             if (t->type == FFTask::TASK_COMM) 
                 std::cerr << "STARTING COMM TASK!" << std::endl;
             t->state = FFTask::TASK_READY;
@@ -371,14 +602,87 @@ void FFApplication::start_init_tasks() {
     // std::cerr << "added " << count << " init tasks." << std::endl;
 }
 
+bool FFApplication::converged() {
+    if (converge_window <= 0 || iter_times.size() <= (size_t)converge_window) {
+        return false;
+    }
+    for (size_t i = iter_times.size() - converge_window; i < iter_times.size(); i++) {
+        double prev = iter_times[i - 1], curr = iter_times[i];
+        if (fabs(curr - prev) > converge_tol * prev) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FFApplication::finish_iteration() {
+    iter_times.push_back(eventlist.now() - iter_start);
+    *fstream_out << "Iter " << id << " " << iter_times.size() << " " << timeAsMs(iter_times.back()) << std::endl;
+
+    std::cerr << this << " 0: finished one iter, nfin " << ctx.finished_apps << " ntot " << ctx.total_apps << std::endl;
+    if (!finished_once && (iter_times.size() >= max_iters || converged())) {
+        finished_once = true;
+        first_iter_time = final_finish_time;
+        ctx.finished_apps++;
+        if (converge_window > 0) {
+            std::cerr << this << " done after " << iter_times.size() << " iterations" <<
+                (converged() ? ", converged" : ", not converged") << std::endl;
+        }
+        if (done_action == DONE_FLUID) {
+            assert(fluid);
+            fluid_min_bytes = 0;
+        }
+    }
+    std::cerr << this << " finished one iter, nfin " << ctx.finished_apps << " ntot " << ctx.total_apps << " now " << eventlist.now() << std::endl;
+    if (ctx.finished_apps == ctx.total_apps) {
+        eventlist.setEndtime(eventlist.now());
+    }
+    else if (!finished_once || done_action != DONE_STOP) {
+        reset_and_restart();
+    }
+}
+
+void FFApplication::print_iterations(std::ostream & out) {
+    if (iter_times.empty()) {
+        out << "Iterations " << id << " 0" << std::endl;
+        return;
+    }
+    simtime_picosec sum = 0, lo = iter_times[0], hi = iter_times[0];
+    for (simtime_picosec t: iter_times) {
+        sum += t;
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    // count, mean/min/max/last iteration time in ms, converged
+    out << "Iterations " << id << " " << iter_times.size() << " " << timeAsMs(sum / iter_times.size()) << " " 
+        << timeAsMs(lo) << " " << timeAsMs(hi) << " " << timeAsMs(iter_times.back()) << " " << converged() << std::endl;
+}
+
+double FFApplication::done_fraction() {
+    if (finished_once) {
+        return 1;
+    }
+    if (max_iters == SIZE_MAX) { // until it converges, no telling
+        return 0;
+    }
+    double iter = tasks.empty() ? 0 : (double)n_finished_tasks / tasks.size();
+    return std::min(1.0, (iter_times.size() + iter) / std::max(max_iters, (size_t)1));
+}
+
+double ffapps_done(void * apps) {
+    double done = 1;
+    for (FFApplication * app: *static_cast<std::vector<FFApplication*>*>(apps)) {
+        done = std::min(done, app->done_fraction());
+    }
+    return done;
+}
+
 void FFApplication::reset_and_restart() {
     n_finished_tasks = 0;
-    for (auto task: tasks) {
-        task.second->reset();
-    }
-    for (auto item: counters) {
-        tasks[item.first]->counter = item.second;
+    for (FFTask * task: tasks) {
+        task->reset();
     }
+    counters = indegree;
     start_init_tasks();
 }
 
@@ -420,7 +724,7 @@ FFTask::FFTask(FFApplication * ffapp, std::string type, FFDevice * device, uint6
     ready_time = 0;
     start_time = 0;
     finish_time = 0;
-    counter = 0;
+    idx = 0;
 }
 
 FFTask::FFTask(FFApplication * ffapp, FlatBufTaskGraph::SimTaskType tasktype, FFDevice * device,
@@ -462,7 +766,7 @@ FFTask::FFTask(FFApplication * ffapp, FlatBufTaskGraph::SimTaskType tasktype, FF
     ready_time = 0;
     start_time = 0;
     finish_time = 0;
-    counter = 0;
+    idx = 0;
 }
 
 #if 0
@@ -512,11 +816,12 @@ FFTask::FFTask(FFApplication * ffapp, FFTask::FFTaskType type):
     ffapp(ffapp), EventSource(ffapp->eventlist, "FFTask") {
 
     this->type = type;
+    idx = 0;
 }
 
 void FFTask::taskstart() {
     // std::cerr << "Guid: " << guid << " try start at " << eventlist().now() << std::endl;
-    assert(counter == 0);
+    assert(ffapp->counters[idx] == 0);
 
     if (type == FFTask::TASK_COMM && device->type == FFDevice::DEVICE_NW_COMM) {
         start_flow();
@@ -539,66 +844,81 @@ void FFTask::execute_compute() {
     }
 
     // check if the device has running task. If not, schedule this task.
-    // Otherwise schedule it at the time the other task finishes. 
+    // Otherwise try again when it is done, or wait in the device's ready queue if that comes to the same.
     if (this->state == FFTask::TASK_READY) {
         if (device->state == FFDevice::DEVICE_IDLE) {
-            // std::cerr << "Task " << (uint64_t)this << " starts at " << eventlist().now() << std::endl;
-            this->state = FFTask::TASK_RUNNING;
-            device->state = FFDevice::DEVICE_BUSY;
-            start_time = eventlist().now();
-            finish_time = start_time + run_time;
-            eventlist().sourceIsPending(*this, finish_time);
-            device->busy_up_to = finish_time;
+            run_on_device();
         }
         else {
-            // std::cerr << "Task " << (uint64_t)this << " dev busy, reschedule at " << device->busy_up_to << std::endl;
-            eventlist().sourceIsPending(*this, device->busy_up_to);
+            // std::cerr << "Task " << (uint64_t)this << " dev busy, queued behind " << device->ready_queue.size() << std::endl;
+            if (eventlist().lastPendingSource(device->busy_up_to) == device->running) {
+                // our retry would land right behind the running task's finish and the waiters
+                // queued there, so the finish can start us in its place
+                device->ready_queue.push_back(this);
+            }
+            else {
+                // other events due at busy_up_to come before our retry, keep it so ties go as before
+                eventlist().sourceIsPending(*this, device->busy_up_to);
+            }
         }
     }
     // This means this task has finished
     else if (this->state == FFTask::TASK_RUNNING) {
         // std::cerr << "Task " << (uint64_t)this << " finishes at " << eventlist().now() << std::endl;
-        assert(device->state == FFDevice::DEVICE_BUSY);
+        assert(device->state == FFDevice::DEVICE_BUSY && device->running == this);
 
-        this->state = FFTask::TASK_FINISHED;
         device->state = FFDevice::DEVICE_IDLE;
-
         cleanup();
+
+        // the queued waiters would retry right after this event: the first one gets the device,
+        // the others retry behind it
+        if (!device->ready_queue.empty()) {
+            FFTask * next = device->ready_queue.front();
+            device->ready_queue.pop_front();
+            next->run_on_device();
+        }
     }
     
 }
 
+void FFTask::run_on_device() {
+    // std::cerr << "Task " << (uint64_t)this << " starts at " << eventlist().now() << std::endl;
+    assert(device->state == FFDevice::DEVICE_IDLE);
+    this->state = FFTask::TASK_RUNNING;
+    device->state = FFDevice::DEVICE_BUSY;
+    start_time = eventlist().now();
+    finish_time = start_time + run_time;
+    eventlist().sourceIsPending(*this, finish_time);
+    device->running = this;
+    device->busy_up_to = finish_time;
+}
+
 void FFTask::cleanup() {
     this->state = FFTask::TASK_FINISHED;
     ffapp->n_finished_tasks++;
-    std::cerr << ffapp << " finished one task, nfin " << ffapp->n_finished_tasks << " ntot " << ffapp->tasks.size() << " type " << this->type << " now " << eventlist().now() << std::endl;
+    // std::cerr << ffapp << " finished one task, nfin " << ffapp->n_finished_tasks << " ntot " << ffapp->tasks.size() << " type " << this->type << " now " << eventlist().now() << std::endl;
     if (ffapp->final_finish_time < finish_time) {
         ffapp->final_finish_time = finish_time;
     }
-    for (uint64_t next_id: next_tasks) {
-        FFTask * task = ffapp->tasks[next_id];
-        task->counter--;
-        // std::cerr << (uint64_t)this << " -> Task " << (uint64_t)task << " counter at " << task->counter << std::endl;
-        if (task->counter == 0) {
+    for (uint32_t e = ffapp->succ_off[idx]; e < ffapp->succ_off[idx + 1]; e++) {
+        uint32_t next = ffapp->succ[e];
+        // std::cerr << (uint64_t)this << " -> Task " << next << " counter at " << ffapp->counters[next] << std::endl;
+        if (--ffapp->counters[next] == 0) {
+            FFTask * task = ffapp->tasks[next];
             task->ready_time = finish_time;
             task->state = FFTask::TASK_READY;
-            eventlist().sourceIsPending(*task, task->ready_time);
+            if (next == ffapp->chain_next[idx] && device->ready_queue.empty()
+                    && eventlist().lastPendingSource(task->ready_time) == NULL) {
+                // nothing else is due now, so its ready event would run next: start it here
+                task->run_on_device();
+            }
+            else {
+                eventlist().sourceIsPending(*task, task->ready_time);
+            }
         }
     }
     if (ffapp->n_finished_tasks == ffapp->tasks.size()) {
-        std::cerr << ffapp << " 0: finished one iter, nfin " << FFApplication::finished_apps << " ntot " << FFApplication::total_apps << std::endl;
-        if (!ffapp->finished_once) {
-            ffapp->finished_once = true;
-            ffapp->first_iter_time = ffapp->final_finish_time;
-            FFApplication::finished_apps++;
-        }
-        std::cerr << ffapp << " finished one iter, nfin " << FFApplication::finished_apps << " ntot " << FFApplication::total_apps << " now " << eventlist().now() << std::endl;
-        if (FFApplication::finished_apps == FFApplication::total_apps) {
-            eventlist().setEndtime(eventlist().now());
-        }
-        else {
-            ffapp->reset_and_restart();
-        }
+        ffapp->finish_iteration();
     }
 }
 
@@ -606,10 +926,19 @@ void FFTask::doNextEvent() {
     taskstart();
 }
 
+uint32_t FFTask::choose_path(uint64_t key, size_t npaths) {
+    uint64_t iter = ffapp->iter_times.size();
+    return Rng::below(Rng::at(ffapp->ctx.seed, RNG_FFTASK, (uint64_t)ffapp->id << 32 | idx, iter << 40 ^ key), npaths);
+}
+
 void FFTask::start_flow() {
     
     // std::cerr << "task: " << (uint64_t)this << " start flow (" << src_node << ", " << dst_node << ")\n";
     start_time = ready_time;
+    if (ffapp->use_fluid(xfersize, type)) {
+        ffapp->fluid->start_flow(src_node, dst_node, xfersize, start_time, taskfinish, this);
+        return;
+    }
     // // from ndp main application: generate flow
 
     // NdpSrc* flowSrc = new NdpSrc(nullptr, nullptr, eventlist(), src_node, dst_node, taskfinish, (void*)this);
@@ -650,13 +979,13 @@ void FFTask::start_flow() {
 
     int choice = 0;
     vector<const Route*>* srcpaths = ffapp->topology->get_paths(src_node, dst_node);
-    choice = rand()%srcpaths->size(); // comment this out if we want to use the first path
+    choice = choose_path(0, srcpaths->size()); // comment this out if we want to use the first path
     routeout = new Route(*(srcpaths->at(choice)));
     routeout->push_back(flowSnk);
 
     choice = 0;
     vector<const Route*>* dstpaths = ffapp->topology->get_paths(dst_node, src_node);
-    choice = rand()%dstpaths->size(); // comment this out if we want to use the first path
+    choice = choose_path(1, dstpaths->size()); // comment this out if we want to use the first path
     routein = new Route(*(dstpaths->at(choice)));
     routein->push_back(flowSrc);
 
@@ -716,6 +1045,7 @@ FFDevice::FFDevice(FFApplication * ffapp, std::string type, float bandwidth, int
     this->to_gpu = from_gpu;
     
     this->busy_up_to = 0;
+    this->running = NULL;
 }
 
 FFDevice::FFDevice(FFApplication * ffapp, FlatBufTaskGraph::DeviceType devtype, uint64_t nodeid, 
@@ -781,6 +1111,7 @@ FFDevice::FFDevice(FFApplication * ffapp, FlatBufTaskGraph::DeviceType devtype,
     // this->to_gpu = from_gpu;
     
     this->busy_up_to = 0;
+    this->running = NULL;
 }
 
 #if 0
@@ -822,6 +1153,57 @@ FFDevice::FFDevice(TaskGraphProtoBuf::Device_DeviceType type,
 
 #endif
 
+// FFConnection
+FFConnection::FFConnection(FFApplication * ffapp, int src_node, int dst_node, Route * routeout, Route * routein,
+                           simtime_picosec rto)
+: EventSource(ffapp->eventlist, "ffconn"), routeout(routeout), routein(routein),
+  connected(false), pending(false), scheduled(0) {
+    src = new DCTCPSrc(NULL, NULL, ffapp->fstream_out, eventlist(), src_node, dst_node);
+    sink = new TcpSink();
+    src->set_ssthresh(ffapp->ssthresh*Packet::data_packet_size());
+    src->_rto = rto;
+    ffapp->tcpRtxScanner.registerTcp(*src);
+    routeout->push_back(sink);
+    routein->push_back(src);
+}
+
+void FFConnection::send(uint64_t bytes, simtime_picosec start, flow_callback_t cb, void * data) {
+    if (!connected) {
+        src->connect(*routeout, *routein, *sink, start);
+        connected = true;
+    }
+    else if (start > eventlist().now()) {
+        message_t m = {bytes, cb, data};
+        deferred.insert(std::make_pair(start, m));
+        if (!pending || start < scheduled) {
+            if (pending) {
+                eventlist().cancelPendingSource(*this, scheduled);
+            }
+            eventlist().sourceIsPending(*this, start);
+            pending = true;
+            scheduled = start;
+        }
+        return;
+    }
+    src->send_message(bytes, start, cb, data);
+}
+
+void FFConnection::doNextEvent() {
+    pending = false;
+    simtime_picosec now = eventlist().now();
+    while (!deferred.empty() && deferred.begin()->first <= now) {
+        simtime_picosec start = deferred.begin()->first;
+        message_t m = deferred.begin()->second;
+        deferred.erase(deferred.begin());
+        src->send_message(m.bytes, start, m.cb, m.data);
+    }
+    if (!deferred.empty()) {
+        scheduled = deferred.begin()->first;
+        eventlist().sourceIsPending(*this, scheduled);
+        pending = true;
+    }
+}
+
 // FFRingAllReduce
 FFRingAllreduce::FFRingAllreduce(FFApplication * ffapp, std::vector<uint64_t> ng, uint64_t sz, double local_runtime) :
     FFTask(ffapp, FFTask::TASK_ALLREDUCE), node_group(ng), 
@@ -930,6 +1312,18 @@ void FFRingAllreduce::start_flow(int src_idx, int id) {
     //     return;
     // }
 
+    if (ffapp->use_fluid(operator_size/node_group.size(), type)) {
+        ffapp->fluid->start_flow(src_node, dst_node, operator_size/node_group.size(), 
+            curr_round > 0 ? eventlist().now() : start_time + run_time, ar_finish_ring, f);
+        return;
+    }
+
+    if (ffapp->persistent_ar) {
+        ffapp->path_connection(src_node, dst_node, timeFromMs(1))->send(operator_size/node_group.size(), 
+            curr_round > 0 ? eventlist().now() : start_time + run_time, ar_finish_ring, f);
+        return;
+    }
+
     DCTCPSrc* flowSrc = new DCTCPSrc(NULL, NULL, ffapp->fstream_out, 
         eventlist(), src_node, dst_node, ar_finish_ring, f);
     TcpSink* flowSnk = new TcpSink();
@@ -943,13 +1337,13 @@ void FFRingAllreduce::start_flow(int src_idx, int id) {
 
     int choice = 0;
     vector<const Route*>* srcpaths = ffapp->topology->get_paths(src_node, dst_node);
-    choice = rand()%srcpaths->size(); // comment this out if we want to use the first path
+    choice = choose_path(((uint64_t)curr_round << 20 | src_idx) << 1, srcpaths->size()); // comment this out if we want to use the first path
     routeout = new Route(*(srcpaths->at(choice)));
     routeout->push_back(flowSnk);
 
     choice = 0;
     vector<const Route*>* dstpaths = ffapp->topology->get_paths(dst_node, src_node);
-    choice = rand()%dstpaths->size(); // comment this out if we want to use the first path
+    choice = choose_path(((uint64_t)curr_round << 20 | src_idx) << 1 | 1, dstpaths->size()); // comment this out if we want to use the first path
     routein = new Route(*(dstpaths->at(choice)));
     routein->push_back(flowSrc);
 
@@ -1020,7 +1414,7 @@ FFNewRingAllreduce::FFNewRingAllreduce(FFApplication * ffapp, std::vector<uint64
 void FFNewRingAllreduce::doNextEvent()
 {
 
-    std::cerr << "AR " << this << " size " <<  node_group.size() << " node starting " << jumps.size() << " rings, now " << eventlist().now() << std::endl;
+    // std::cerr << "AR " << this << " size " <<  node_group.size() << " node starting " << jumps.size() << " rings, now " << eventlist().now() << std::endl;
     if (node_group.size() == 1) {
         // finished_partitions = 1;
         finish_time = start_time = ready_time;
@@ -1053,35 +1447,73 @@ void FFNewRingAllreduce::start_flow(int src_idx, const std::vector<int>& jump, i
     f->ring_idx = ring_id;
     f->src_idx = src_idx;
 
-    DCTCPSrc* flowSrc = new DCTCPSrc(NULL, NULL, ffapp->fstream_out, 
-        eventlist(), src_node, dst_node, ar_finish_newring, f);
-    TcpSink* flowSnk = new TcpSink();
-    flowSrc->set_flowsize(operator_size/node_group.size()/jumps.size()); // bytes
-    flowSrc->set_ssthresh(ffapp->ssthresh*Packet::data_packet_size());
-    flowSrc->_rto = timeFromMs(10);
-    
-    ffapp->tcpRtxScanner.registerTcp(*flowSrc);
+    FlatTopology * top = static_cast<FlatTopology*>(ffapp->topology);
+    if (ffapp->use_fluid(operator_size/node_group.size()/jumps.size(), type)) {
+        Route route;
+        int curr = src_idx;
+        for (int j: jump) {
+            FlatTopology::link_t * l = top->get_link(ffapp->gpus[curr], ffapp->gpus[(curr+j)%ffapp->nnodes]);
+            route.push_back(l->queue);
+            route.push_back(l->pipe);
+            curr = (curr + j) % ffapp->nnodes;
+        }
+        ffapp->fluid->start_flow(src_node, dst_node, route, operator_size/node_group.size()/jumps.size(), 
+            curr_round[ring_id] > 0 ? eventlist().now() : start_time + run_time, ar_finish_newring, f);
+        return;
+    }
+
+    FFConnection ** conn = NULL;
+    if (ffapp->persistent_ar) {
+        // the jumps are picked per ring size
+        uint32_t tag = 1 + (node_group.size() << 8 | ring_id);
+        assert(ring_id < 256);
+        conn = &ffapp->connections[FFApplication::connection_key(src_node, dst_node, tag)];
+        if (*conn) {
+            (*conn)->send(operator_size/node_group.size()/jumps.size(), 
+                curr_round[ring_id] > 0 ? eventlist().now() : start_time + run_time, ar_finish_newring, f);
+            return;
+        }
+    }
 
     Route* routeout = new Route();
     int curr = src_idx;
     for (int j: jump) {
-        assert(static_cast<FlatTopology*>(ffapp->topology)->queues[ffapp->gpus[curr]][ffapp->gpus[(curr+j)%ffapp->nnodes]/*node_group.size()*/] != nullptr);
-        routeout->push_back(static_cast<FlatTopology*>(ffapp->topology)->queues[ffapp->gpus[curr]][ffapp->gpus[(curr+j)%ffapp->nnodes]/*%node_group.size()*/]);
-        routeout->push_back(static_cast<FlatTopology*>(ffapp->topology)->pipes[ffapp->gpus[curr]][ffapp->gpus[(curr+j)%ffapp->nnodes]/*%node_group.size()*/]);
+        FlatTopology::link_t * l = top->get_link(ffapp->gpus[curr], ffapp->gpus[(curr+j)%ffapp->nnodes]/*%node_group.size()*/);
+        assert(l != nullptr);
+        routeout->push_back(l->queue);
+        routeout->push_back(l->pipe);
         curr = (curr + j) % ffapp->nnodes /*% node_group.size()*/;
     }
     // assert(curr == (src_idx + total_jump[ring_id]) % ffapp->nnodes /*% node_group.size()*/);
     assert(ffapp->gpus[curr] == ffapp->gpus[(src_idx + total_jump[ring_id]) % ffapp->nnodes] /*% node_group.size()*/);
-    routeout->push_back(flowSnk);
 
     Route* routein = new Route();
     curr = src_idx;
     for (int j: jump) {
-        routein->push_front(static_cast<FlatTopology*>(ffapp->topology)->queues[ffapp->gpus[curr]][ffapp->gpus[(curr+j)%ffapp->nnodes]/*%node_group.size()*/]);
-        routein->push_front(static_cast<FlatTopology*>(ffapp->topology)->pipes[ffapp->gpus[curr]][ffapp->gpus[(curr+j)%ffapp->nnodes]/*%node_group.size()*/]);
+        FlatTopology::link_t * l = top->get_link(ffapp->gpus[curr], ffapp->gpus[(curr+j)%ffapp->nnodes]/*%node_group.size()*/);
+        routein->push_front(l->queue);
+        routein->push_front(l->pipe);
         curr = (curr + j) % ffapp->nnodes /*% node_group.size() */;
     }
     assert(ffapp->gpus[curr] == ffapp->gpus[(src_idx + total_jump[ring_id]) % ffapp->nnodes] /*% node_group.size()*/);
+
+    if (conn) {
+        *conn = new FFConnection(ffapp, src_node, dst_node, routeout, routein, timeFromMs(10));
+        (*conn)->send(operator_size/node_group.size()/jumps.size(), 
+            curr_round[ring_id] > 0 ? eventlist().now() : start_time + run_time, ar_finish_newring, f);
+        return;
+    }
+
+    DCTCPSrc* flowSrc = new DCTCPSrc(NULL, NULL, ffapp->fstream_out, 
+        eventlist(), src_node, dst_node, ar_finish_newring, f);
+    TcpSink* flowSnk = new TcpSink();
+    flowSrc->set_flowsize(operator_size/node_group.size()/jumps.size()); // bytes
+    flowSrc->set_ssthresh(ffapp->ssthresh*Packet::data_packet_size());
+    flowSrc->_rto = timeFromMs(10);
+    
+    ffapp->tcpRtxScanner.registerTcp(*flowSrc);
+
+    routeout->push_back(flowSnk);
     routein->push_back(flowSrc);
 
     flowSrc->connect(*routeout, *routein, *flowSnk, 
@@ -1128,7 +1560,7 @@ void ar_finish_newring(void * arinfo)
             ar->finish_time = ar->eventlist().now();
             ar->cleanup();
             // ar->state = FFTask::TASK_FINISHED;
-            std::cerr << "AR " << ar << " finished at " << ar->finish_time << std::endl;
+            // std::cerr << "AR " << ar << " finished at " << ar->finish_time << std::endl;
             // ar->ffapp->n_finished_tasks++;
             // if (ar->ffapp->final_finish_time < ar->finish_time) {
             //     ar->ffapp->final_finish_time = ar->finish_time;
@@ -1192,6 +1624,18 @@ void FFPSAllreduce::start_flow(int node_idx, int direction) {
     f->node_idx = node_idx;
     f->direction = direction;
 
+    if (ffapp->use_fluid(operator_size, type)) {
+        ffapp->fluid->start_flow(src_node, dst_node, operator_size, 
+            curr_round > 0 ? eventlist().now() : start_time, ar_finish_ps, f);
+        return;
+    }
+
+    if (ffapp->persistent_ar) {
+        ffapp->path_connection(src_node, dst_node, timeFromMs(1))->send(operator_size, 
+            curr_round > 0 ? eventlist().now() : start_time, ar_finish_ps, f);
+        return;
+    }
+
     DCTCPSrc* flowSrc = new DCTCPSrc(NULL, NULL, ffapp->fstream_out, 
         eventlist(), src_node, dst_node, ar_finish_ps, f);
     TcpSink* flowSnk = new TcpSink();
@@ -1205,13 +1649,13 @@ void FFPSAllreduce::start_flow(int node_idx, int direction) {
 
     int choice = 0;
     vector<const Route*>* srcpaths = ffapp->topology->get_paths(src_node, dst_node);
-    choice = rand()%srcpaths->size(); // comment this out if we want to use the first path
+    choice = choose_path(((uint64_t)curr_round << 20 | node_idx) << 1, srcpaths->size()); // comment this out if we want to use the first path
     routeout = new Route(*(srcpaths->at(choice)));
     routeout->push_back(flowSnk);
 
     choice = 0;
     vector<const Route*>* dstpaths = ffapp->topology->get_paths(dst_node, src_node);
-    choice = rand()%dstpaths->size(); // comment this out if we want to use the first path
+    choice = choose_path(((uint64_t)curr_round << 20 | node_idx) << 1 | 1, dstpaths->size()); // comment this out if we want to use the first path
     routein = new Route(*(dstpaths->at(choice)));
     routein->push_back(flowSrc);
 
@@ -1303,6 +1747,18 @@ void FFDPSAllreduce::start_flow(int src_node, int dst_node) {
     src_node = ffapp->gpus[node_group[src_node]];
     dst_node = ffapp->gpus[node_group[dst_node]];
 
+    if (ffapp->use_fluid(operator_size/node_group.size(), type)) {
+        ffapp->fluid->start_flow(src_node, dst_node, operator_size/node_group.size(), 
+            curr_round > 0 ? eventlist().now() : start_time, ar_finish_dps, this);
+        return;
+    }
+
+    if (ffapp->persistent_ar) {
+        ffapp->path_connection(src_node, dst_node, timeFromMs(1))->send(operator_size/node_group.size(), 
+            curr_round > 0 ? eventlist().now() : start_time, ar_finish_dps, this);
+        return;
+    }
+
     DCTCPSrc* flowSrc = new DCTCPSrc(NULL, NULL, ffapp->fstream_out, 
         eventlist(), src_node, dst_node, ar_finish_dps, this);
     TcpSink* flowSnk = new TcpSink();
@@ -1316,13 +1772,13 @@ void FFDPSAllreduce::start_flow(int src_node, int dst_node) {
 
     int choice = 0;
     vector<const Route*>* srcpaths = ffapp->topology->get_paths(src_node, dst_node);
-    choice = rand()%srcpaths->size(); // comment this out if we want to use the first path
+    choice = choose_path(((uint64_t)src_node << 20 | dst_node) << 1, srcpaths->size()); // comment this out if we want to use the first path
     routeout = new Route(*(srcpaths->at(choice)));
     routeout->push_back(flowSnk);
 
     choice = 0;
     vector<const Route*>* dstpaths = ffapp->topology->get_paths(dst_node, src_node);
-    choice = rand()%dstpaths->size(); // comment this out if we want to use the first path
+    choice = choose_path(((uint64_t)src_node << 20 | dst_node) << 1 | 1, dstpaths->size()); // comment this out if we want to use the first path
     routein = new Route(*(dstpaths->at(choice)));
     routein->push_back(flowSrc);
 
@@ -5,13 +5,16 @@
 // #undef max 
 
 #include <vector>
+#include <deque>
 #include <string>
 #include <unordered_set>
 #include <unordered_map>
+#include <map>
 #include "topology.h"
 #include "flat_topology.h"
 #include "eventlist.h"
 #include "ndp.h"
+#include "fluid.h"
 
 #include "taskgraph_generated.h"
 // #include "taskgraph.pb.h"
@@ -22,6 +25,8 @@
  */
 
 class FFApplication;
+class FFTask;
+class DCTCPSrc;
 
 class FFDevice {
 public:
@@ -48,6 +53,9 @@ public:
 
     simtime_picosec busy_up_to;
     // int nqueued_tasks;
+    std::deque<FFTask*> ready_queue; // ready tasks whose retry would directly follow the running task's finish, FIFO; that finish dispatches the next one
+
+    FFTask * running; // its finish is the event due at busy_up_to
 
     FFDevice(FFApplication * ffapp, std::string type, float bandwidth, int node_id, int gpu_id, 
              int from_node, int to_node, int from_gpu, int to_gpu);
@@ -82,9 +90,16 @@ public:
     void taskstart();
 	void cleanup();
 	void start_flow();
+    // one of npaths for the flow the caller names by key: the same for a given app, task,
+    // iteration and key whichever order flows start in
+    uint32_t choose_path(uint64_t key, size_t npaths);
     
     virtual void doNextEvent(); // call task event
     void execute_compute();
+    void run_on_device(); // device is idle: occupy it and schedule the finish of our segment
+    bool is_local() { // runs on its device for a fixed run_time, no network involved
+        return type != TASK_ALLREDUCE && !(type == TASK_COMM && device->type == FFDevice::DEVICE_NW_COMM);
+    }
 
     virtual void reset() {
         state = FFTask::TASK_NOT_READY;
@@ -96,9 +111,8 @@ public:
     FFTaskType type;
     FFTaskState state;
     FFDevice* device;
-    int counter;
+    uint32_t idx; // dense index into the FFApplication task arrays
     uint64_t xfersize = 0;
-    std::vector<uint64_t> next_tasks;
     int src_node, dst_node;
 	simtime_picosec ready_time, run_time;
 	simtime_picosec start_time, finish_time;
@@ -109,6 +123,35 @@ public:
     FFTask(FFApplication * ffapp, FFTaskType tasktype);
 };
 
+// A dctcp connection that lives as long as the application and carries one message per
+// all-reduce round (persistent_ar), so window and route survive from round to round.
+// Messages that start later are held here until then and sent in start order.
+class FFConnection : public EventSource {
+public:
+    // routeout/routein without the endpoints, owned by the connection from here on
+    FFConnection(FFApplication * ffapp, int src_node, int dst_node, Route * routeout, Route * routein,
+                 simtime_picosec rto);
+
+    void send(uint64_t bytes, simtime_picosec start, flow_callback_t cb, void * data);
+    virtual void doNextEvent();
+
+    DCTCPSrc * src;
+    TcpSink * sink;
+
+private:
+    struct message_t {
+        uint64_t bytes;
+        flow_callback_t cb;
+        void * data;
+    };
+
+    Route * routeout, * routein;
+    bool connected; // the first message opens the connection at its start time
+    std::multimap<simtime_picosec, message_t> deferred;
+    bool pending;
+    simtime_picosec scheduled;
+};
+
 class FFNewRingAllreduce;
 
 struct FFNewRingAllreduceFlow {
@@ -288,37 +331,41 @@ public:
     // void load_taskgraph_protobuf(std::string & taskgraph);
     void load_taskgraph_flatbuf(std::string & taskgraph);
     void start_init_tasks();
+    // tasks/devices are in place, build succ_off/succ/indegree from the (task index, successor index) edges
+    void build_successors(std::vector<std::pair<uint32_t, uint32_t>> & edges);
 
     void reset_and_restart();
+    // 0..1: iterations done and this one's finished tasks, out of max_iters (see Progress)
+    double done_fraction();
 
-    static std::vector<int> choose_gpus(std::unordered_set<int> & candidates, int n);
+    // the FFRingAllreduce, FFPSAllreduce or FFDPSAllreduce allreduce_strategy asks for
+    FFTask * new_allreduce(std::vector<uint64_t> & node_group, uint64_t size, double runtime);
+    // what-if runs (fork_sweep.h): all-reduces that haven't become ready yet use ars from now on,
+    // so between iterations all of them do; fancy ring all-reduces don't change
+    void set_allreduce_strategy(FFAllReduceStrategy ars);
 
-    static bool LoadFileRaw(const char *name, std::string *buf) {
-        std::ifstream ifs(name, std::ifstream::binary);
-        if (!ifs.is_open()) {
-            return false;
-        }
-        // The fastest way to read a file into a string.
-        ifs.seekg(0, std::ios::end);
-        auto size = ifs.tellg();
-        (*buf).resize(static_cast<size_t>(size));
-        ifs.seekg(0, std::ios::beg);
-        ifs.read(&(*buf)[0], (*buf).size());
-        if (ifs.bad()) return false;
-        ifs.close();
-        return true;
-    }
+    // n of the candidates, drawn from the current context's placement stream for this job
+    static std::vector<int> choose_gpus(std::unordered_set<int> & candidates, int n, int job);
 
     size_t nnodes, ngpupernode, nswitches;
     
 	int cwnd;
 	double pull_rate;
-    std::unordered_map<uint64_t, FFTask*> tasks;
-    std::unordered_map<uint64_t, FFDevice*> devices;
+    // tasks are remapped to dense indices (in file order) at load time
+    std::vector<FFTask*> tasks;
+    std::vector<FFDevice*> devices;
+    std::vector<uint32_t> succ_off; // CSR successors: task i -> succ[succ_off[i] .. succ_off[i+1])
+    std::vector<uint32_t> succ;
+    std::vector<int> indegree; // pristine, copied over counters on reset
+    std::vector<int> counters; // predecessors not finished yet, per task
+    // chain_next[i] = j when i and j are local tasks on the same device, j is i's only successor and i is
+    // j's only predecessor: j is then ready exactly when i finishes, and i's finish starts it directly
+    // when nothing else is due at that time
+    std::vector<uint32_t> chain_next;
+    static const uint32_t NO_CHAIN = UINT32_MAX;
 	Topology * topology; 
     int ssthresh;
     EventList & eventlist;
-    unordered_map<uint64_t, unsigned int> counters;
 	// NdpRtxTimerScanner & ndpRtxScanner;
 	// NdpSinkLoggerSampling & sinkLogger;
     // TcpSinkLoggerSampling & sinkLogger;
@@ -326,12 +373,48 @@ public:
     FFAllReduceStrategy allreduce_strategy;
     ofstream * fstream_out;
     TcpRtxTimerScanner & tcpRtxScanner;
+    FluidNetwork * fluid; // when set, transfers are fluid flows there instead of dctcp connections
+    // hybrid runs: only transfers of at least fluid_min_bytes, or of a task type in the
+    // fluid_task_types mask (1 << FFTask::FFTaskType), go fluid; the rest stay packet-level
+    uint64_t fluid_min_bytes;
+    uint32_t fluid_task_types;
+    bool use_fluid(uint64_t bytes, FFTask::FFTaskType type) {
+        return fluid && (bytes >= fluid_min_bytes || (fluid_task_types & (1 << type)));
+    }
+    // all-reduce rounds reuse one FFConnection per (src, dst, tag) instead of a new connection per
+    // flow; tag is 0 for a route out of get_paths, and names the jumps for a route along a fancy ring
+    bool persistent_ar;
+    std::unordered_map<uint64_t, FFConnection*> connections;
+    static uint64_t connection_key(int src_node, int dst_node, uint32_t tag) {
+        assert(tag < (1 << 24));
+        return (uint64_t)src_node << 44 | (uint64_t)dst_node << 24 | tag;
+    }
+    FFConnection * path_connection(int src_node, int dst_node, simtime_picosec rto);
     std::unordered_map<uint64_t, std::vector<std::vector<int>>> selected_jumps;
     bool fancy_ring;
-    bool finished_once;
-
-    static int total_apps;
-    static int finished_apps;
+    bool finished_once; // done: counted in ctx.finished_apps, first_iter_time is set
+
+    // an app is done after max_iters iterations, or earlier once each of the last converge_window
+    // iteration times is within converge_tol (relative) of the one before; the run ends when every
+    // app is done, and until then done apps keep iterating (DONE_KEEP), stop (DONE_STOP) or keep
+    // iterating with all their transfers as fluid background flows (DONE_FLUID, needs fluid)
+    enum FFDoneAction {
+        DONE_KEEP,
+        DONE_STOP,
+        DONE_FLUID,
+    };
+    size_t max_iters;
+    int converge_window;
+    double converge_tol;
+    FFDoneAction done_action;
+    int id; // in creation order, names the app in the Iter lines
+    simtime_picosec iter_start;
+    std::vector<simtime_picosec> iter_times;
+    bool converged();
+    void finish_iteration(); // the last task of the iteration finished
+    void print_iterations(std::ostream & out);
+
+    SimContext & ctx; // the simulation this app is in, counts apps and finished apps
 
     std::vector<int> gpus;
     simtime_picosec final_finish_time;
@@ -341,5 +424,7 @@ public:
 
 
 void taskfinish(void * task);
+// Progress::start's done: the least done_fraction of a std::vector<FFApplication*>
+double ffapps_done(void * apps);
 
 #endif // FF_APP_H
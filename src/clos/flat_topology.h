@@ -2,6 +2,7 @@
 #define FLAT_TOPO
 #include <ostream>
 #include <unordered_map>
+#include <algorithm>
 #include "main.h"
 #include "randomqueue.h"
 #include "pipe.h"
@@ -13,6 +14,7 @@
 #include "logfile.h"
 #include "eventlist.h"
 #include "switch.h"
+#include "mapped_file.h"
 
 #ifndef QT
 #define QT
@@ -25,40 +27,74 @@ public:
 
   vector<Switch*> switchs;
 
-  vector<vector<Pipe*>> pipes;
-  vector<vector<Queue*>> queues;
-  
+  // a directed link; node i's links are _links[_link_off[i] .. _link_off[i+1]), sorted by dst
+  struct link_t {
+    uint32_t src, dst;
+    Queue* queue;
+    Pipe* pipe;
+  };
+
   FirstFit* ff;
   Logfile* logfile;
   EventList* eventlist;
   int failed_links;
   int _no_of_nodes;
   queue_type qt;
+  bool fused_links; // a Link per direction instead of a queue and a pipe, link_t::pipe stays NULL
 
   FlatTopology(int no_of_nodes, const string& tgfile, mem_b queuesize, Logfile* log, EventList* ev, 
-               FirstFit* f, queue_type q);
-  FlatTopology(int no_of_nodes, mem_b queuesize, Logfile *lg, EventList *ev, FirstFit *fit, queue_type q);
+               FirstFit* f, queue_type q, bool fused = false);
+  FlatTopology(int no_of_nodes, mem_b queuesize, Logfile *lg, EventList *ev, FirstFit *fit, queue_type q,
+               bool fused = false);
 
   void init_network();
   // void load_topology_protobuf(const std::string & taskgraph);
   void load_topology_flatbuf(const std::string & taskgraph);
   virtual vector<const Route*>* get_paths(int src, int dest);
 
-  Pipe * get_pipe(int src, int dst) { return pipes[src][dst]; };
+  // NULL when src and dst aren't connected; a node has few links, and they are sorted
+  link_t* get_link(int src, int dst) {
+    link_t *first = links_begin(src), *last = links_end(src);
+    link_t *l = lower_bound(first, last, (uint32_t)dst, [](const link_t &a, uint32_t d) { return a.dst < d; });
+    return l != last && l->dst == (uint32_t)dst ? l : NULL;
+  }
+  Queue * get_queue(int src, int dst) { link_t* l = get_link(src, dst); return l ? l->queue : NULL; }
+  Pipe * get_pipe(int src, int dst) { link_t* l = get_link(src, dst); return l ? l->pipe : NULL; }
+  vector<link_t>& links() { return _links; }
+  link_t* links_begin(int src) { return _links.data() + _link_off[src]; }
+  link_t* links_end(int src) { return _links.data() + _link_off[src + 1]; }
   // Queue* alloc_src_queue(QueueLogger* q);
   // Queue* alloc_queue(QueueLogger* q, mem_b queuesize);
   Queue* alloc_queue(QueueLogger* q, uint64_t speed, mem_b queuesize);
+  Queue* alloc_link(QueueLogger* q, uint64_t speed, mem_b queuesize);
+  // what-if runs (fork_sweep.h) change a built ECN network: every link's marking threshold,
+  // and its queue size, in the units the constructor takes it
+  void set_ecn_threshold(mem_b K);
+  void set_queue_size(mem_b queuesize);
 
   void count_queue(Queue*);
   void print_path(std::ofstream& paths,int src,const Route* route);
-  vector<int>* get_neighbours(int src) { return NULL;};
+  vector<int>* get_neighbours(int src);
   int no_of_nodes() const {return _no_of_nodes;}
   int find_lp_switch(Queue* queue);
 
   uint32_t _link_speed;
   unordered_map<uint64_t, size_t> _conn_list;
-  unordered_map<uint64_t, vector<vector<size_t>*> > _routes;
+  // a path is its hop nodes, read in place from the mapped topology file (or from _own_hops)
+  struct path_t {
+    const uint32_t* hops;
+    uint32_t nhops;
+  };
+  // src * _no_of_nodes + dst -> its paths, _paths[first .. first + count)
+  unordered_map<uint64_t, pair<uint32_t, uint32_t> > _routes;
+  vector<path_t> _paths;
 private:
+  MappedFile _tgfile; // backs _paths, kept for as long as we are
+  vector<uint32_t> _own_hops;
+
+  vector<link_t> _links;
+  vector<uint32_t> _link_off; // _no_of_nodes + 1 entries
+
   map<Queue*,int> _link_usage;
 
   int find_destination(Queue* queue);
@@ -0,0 +1,398 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#include <math.h>
+#include <stdlib.h>
+#include <iostream>
+#include "fluid.h"
+#include "queue.h"
+#include "pipe.h"
+#include "link.h"
+#include "network.h"
+
+FluidNetwork::FluidNetwork(Topology* top, EventList& eventlist, std::ofstream* fct_out)
+    : EventSource(eventlist, "fluid"), _top(top), _fct_out(fct_out),
+      _rng(SimContext::current().seed, RNG_FLUID), _timer_seq(0), _pending(false), _scheduled(0), _mark(0),
+      _epoch(0), _min_share(0), _epoch_pending(false),
+      _nflows(0), _nupdates(0), _update_links(0), _update_flows(0), _nevents(0), _nepochs(0)
+{
+}
+
+void FluidNetwork::set_background(simtime_picosec epoch, double min_share) {
+    _epoch = epoch;
+    _min_share = min_share;
+}
+
+uint32_t FluidNetwork::link_for(Queue* q) {
+    std::unordered_map<Queue*, uint32_t>::iterator i = _link_ids.find(q);
+    if (i != _link_ids.end())
+	return i->second;
+
+    if (q->_bitrate == 0)
+	cerr << "fluid: link " << q->nodename() << " has no bandwidth, flows over it never finish" << endl;
+
+    link_t l;
+    l.queue = q;
+    l.full = (double)q->_bitrate / 8 / 1e12;
+    l.capacity = l.full;
+    l.served = q->_bytes_served;
+    l.in_epoch = false;
+    l.mark = 0;
+    l.residual = 0;
+    l.unfrozen = 0;
+    l.version = 0;
+    _links.push_back(l);
+    _link_ids[q] = _links.size() - 1;
+    return _links.size() - 1;
+}
+
+FluidNetwork::path_t* FluidNetwork::make_path(const Route& route) {
+    path_t* p = new path_t();
+    p->latency = 0;
+    simtime_picosec propagation = 0;
+    for (PacketSink* sink: route) {
+	if (Queue* q = dynamic_cast<Queue*>(sink)) {
+	    p->links.push_back(link_for(q));
+	    p->latency += (simtime_picosec)(Packet::data_packet_size() / _links[p->links.back()].full); // store and forward of the last packet
+	    if (Link* link = dynamic_cast<Link*>(q))
+		propagation += link->delay();
+	}
+	else if (Pipe* pipe = dynamic_cast<Pipe*>(sink)) {
+	    propagation += pipe->delay();
+	}
+    }
+    p->latency += propagation;
+
+    // the sender hears about it when the last ack gets back
+    if (route.reverse()) {
+	for (PacketSink* sink: *route.reverse()) {
+	    if (Pipe* pipe = dynamic_cast<Pipe*>(sink))
+		p->latency += pipe->delay();
+	    else if (Link* link = dynamic_cast<Link*>(sink))
+		p->latency += link->delay();
+	}
+    }
+    else {
+	p->latency += propagation;
+    }
+    return p;
+}
+
+void FluidNetwork::start_flow(int src, int dst, uint64_t bytes, simtime_picosec start,
+                              flow_callback_t cb, void* data) {
+    uint64_t key = ((uint64_t)src << 32) | (uint32_t)dst;
+    std::unordered_map<uint64_t, std::vector<const path_t*>>::iterator i = _paths.find(key);
+    if (i == _paths.end()) {
+	// convert once per pair, the routes stay with the topology like the packet sources leave them
+	vector<const Route*>* routes = _top->get_paths(src, dst);
+	std::vector<const path_t*>& paths = _paths[key];
+	for (const Route* r: *routes)
+	    paths.push_back(make_path(*r));
+	delete routes;
+	i = _paths.find(key);
+    }
+    const std::vector<const path_t*>& paths = i->second;
+    if (paths.empty()) {
+	cerr << "fluid: topology has no path from " << src << " to " << dst << endl;
+	abort();
+    }
+    add_flow(src, dst, paths[_rng.below(paths.size())], false, bytes, start, cb, data);
+}
+
+void FluidNetwork::start_flow(int src, int dst, const Route& route, uint64_t bytes, simtime_picosec start,
+                              flow_callback_t cb, void* data) {
+    add_flow(src, dst, make_path(route), true, bytes, start, cb, data);
+}
+
+void FluidNetwork::add_flow(int src, int dst, const path_t* path, bool own_path, uint64_t bytes,
+                            simtime_picosec start, flow_callback_t cb, void* data) {
+    uint32_t f;
+    if (!_free_flows.empty()) {
+	f = _free_flows.back();
+	_free_flows.pop_back();
+    }
+    else {
+	f = _flows.size();
+	_flows.push_back(flow_t());
+	_flows.back().version = 0;
+	_flows.back().mark = 0;
+    }
+
+    flow_t& fl = _flows[f];
+    fl.path = path;
+    fl.own_path = own_path;
+    fl.slot.assign(path->links.size(), 0);
+    fl.src = src;
+    fl.dst = dst;
+    fl.bytes = bytes;
+    fl.remaining = bytes;
+    fl.rate = 0;
+    fl.start = start > eventlist().now() ? start : eventlist().now();
+    fl.last = fl.start;
+    fl.version++; // a recycled slot must not match timers of its previous flow
+    fl.frozen = false;
+    fl.cb = cb;
+    fl.data = data;
+    _nflows++;
+
+    add_timer(fl.start, f, FLOW_ARRIVE);
+}
+
+void FluidNetwork::add_timer(simtime_picosec when, uint32_t flow, timer_kind kind) {
+    flow_timer t;
+    t.when = when;
+    t.seq = _timer_seq++;
+    t.flow = flow;
+    t.version = kind == EPOCH ? 0 : _flows[flow].version;
+    t.kind = kind;
+    _timers.push(t);
+
+    if (!_pending || when < _scheduled) {
+	if (_pending)
+	    eventlist().cancelPendingSource(*this, _scheduled);
+	_pending = true;
+	_scheduled = when;
+	eventlist().sourceIsPending(*this, when);
+    }
+}
+
+void FluidNetwork::activate(uint32_t f) {
+    flow_t& fl = _flows[f];
+    if (fl.path->links.empty()) {
+	// nothing to share, it only takes the latency
+	fl.version++;
+	add_timer(eventlist().now() + fl.path->latency, f, FLOW_DELIVER);
+	return;
+    }
+    for (size_t i = 0; i < fl.path->links.size(); i++) {
+	uint32_t l = fl.path->links[i];
+	fl.slot[i] = _links[l].flows.size();
+	_links[l].flows.push_back(f);
+	_dirty_links.push_back(l);
+	if (_epoch && !_links[l].in_epoch) {
+	    _links[l].in_epoch = true;
+	    _links[l].served = _links[l].queue->_bytes_served;
+	    _epoch_links.push_back(l);
+	}
+    }
+    if (_epoch && !_epoch_pending) {
+	_epoch_pending = true;
+	add_timer(eventlist().now() + _epoch, 0, EPOCH);
+    }
+}
+
+void FluidNetwork::drain(uint32_t f) {
+    flow_t& fl = _flows[f];
+    for (size_t i = 0; i < fl.path->links.size(); i++) {
+	uint32_t l = fl.path->links[i];
+	std::vector<uint32_t>& flows = _links[l].flows;
+	uint32_t moved = flows.back();
+	uint32_t last_slot = flows.size() - 1;
+	flows[fl.slot[i]] = moved;
+	flows.pop_back();
+	// the flow we moved down needs to know where it went
+	flow_t& m = _flows[moved];
+	for (size_t j = 0; j < m.path->links.size(); j++) {
+	    if (m.path->links[j] == l && m.slot[j] == last_slot) {
+		m.slot[j] = fl.slot[i];
+		break;
+	    }
+	}
+	_dirty_links.push_back(l);
+    }
+    fl.version++;
+    fl.rate = 0;
+    add_timer(eventlist().now() + fl.path->latency, f, FLOW_DELIVER);
+}
+
+void FluidNetwork::update_rates() {
+    simtime_picosec now = eventlist().now();
+    _nupdates++;
+    _mark++;
+
+    // everything connected to the links that changed, through shared flows
+    _comp_links.clear();
+    _comp_flows.clear();
+    for (uint32_t l: _dirty_links) {
+	if (_links[l].mark != _mark) {
+	    _links[l].mark = _mark;
+	    _comp_links.push_back(l);
+	}
+    }
+    _dirty_links.clear();
+    for (size_t i = 0; i < _comp_links.size(); i++) {
+	for (uint32_t f: _links[_comp_links[i]].flows) {
+	    flow_t& fl = _flows[f];
+	    if (fl.mark == _mark)
+		continue;
+	    fl.mark = _mark;
+	    _comp_flows.push_back(f);
+	    for (uint32_t l: fl.path->links) {
+		if (_links[l].mark != _mark) {
+		    _links[l].mark = _mark;
+		    _comp_links.push_back(l);
+		}
+	    }
+	}
+    }
+    _update_links += _comp_links.size();
+    _update_flows += _comp_flows.size();
+
+    for (uint32_t f: _comp_flows) {
+	flow_t& fl = _flows[f];
+	fl.remaining -= fl.rate * (double)(now - fl.last);
+	if (fl.remaining < 0)
+	    fl.remaining = 0;
+	fl.last = now;
+	fl.frozen = false;
+    }
+
+    // water-filling: the link with the smallest fair share fixes the rate of all its flows
+    std::priority_queue<share_t, std::vector<share_t>, std::greater<share_t>> shares;
+    for (uint32_t l: _comp_links) {
+	link_t& link = _links[l];
+	link.residual = link.capacity;
+	link.unfrozen = link.flows.size();
+	link.version++;
+	if (link.unfrozen > 0)
+	    shares.push(share_t(link.residual / link.unfrozen, std::make_pair(l, link.version)));
+    }
+    while (!shares.empty()) {
+	share_t s = shares.top();
+	shares.pop();
+	link_t& link = _links[s.second.first];
+	if (s.second.second != link.version || link.unfrozen == 0)
+	    continue;
+	double share = link.residual > 0 ? link.residual / link.unfrozen : 0;
+	for (uint32_t f: link.flows) {
+	    flow_t& fl = _flows[f];
+	    if (fl.frozen)
+		continue;
+	    fl.frozen = true;
+	    fl.rate = share;
+	    for (uint32_t l: fl.path->links) {
+		link_t& other = _links[l];
+		other.residual -= share;
+		other.unfrozen--;
+		other.version++;
+		if (other.unfrozen > 0 && l != s.second.first)
+		    shares.push(share_t(other.residual > 0 ? other.residual / other.unfrozen : 0,
+		                        std::make_pair(l, other.version)));
+	    }
+	}
+    }
+
+    for (uint32_t f: _comp_flows) {
+	flow_t& fl = _flows[f];
+	fl.version++;
+	if (fl.rate <= 0)
+	    continue; // starved, until something in its component changes
+	add_timer(now + (simtime_picosec)ceil(fl.remaining / fl.rate), f, FLOW_DRAIN);
+    }
+}
+
+void FluidNetwork::doNextEvent() {
+    simtime_picosec now = eventlist().now();
+    _nevents++;
+
+    // anything due now, including what the callbacks start, is handled in this pass
+    _pending = true;
+    _scheduled = now;
+    do {
+	while (!_timers.empty() && _timers.top().when <= now) {
+	    flow_timer t = _timers.top();
+	    _timers.pop();
+	    if (t.kind == EPOCH) {
+		epoch();
+		continue;
+	    }
+	    flow_t& fl = _flows[t.flow];
+	    switch (t.kind) {
+	    case FLOW_ARRIVE:
+		activate(t.flow);
+		break;
+	    case FLOW_DRAIN:
+		if (t.version == fl.version)
+		    drain(t.flow);
+		break;
+	    case EPOCH:
+		break;
+	    case FLOW_DELIVER: {
+		if (_fct_out) {
+		    // same line as the tcp sources print
+		    *_fct_out << "FCT " << fl.src << " " << fl.dst << " " << fl.bytes << " " << timeAsMs(now - fl.start)
+			      << " " << timeAsMs(fl.start) << " "
+			      << (double)fl.bytes / timeAsSec(now - fl.start) * 8 / 1000000000UL << endl;
+		}
+		flow_callback_t cb = fl.cb;
+		void* data = fl.data;
+		if (fl.own_path)
+		    delete fl.path;
+		fl.path = NULL;
+		_free_flows.push_back(t.flow);
+		if (cb)
+		    cb(data); // may start flows, _flows can move
+		break;
+	    }
+	    }
+	}
+	if (!_dirty_links.empty())
+	    update_rates();
+    } while (!_timers.empty() && _timers.top().when <= now);
+
+    _pending = false;
+    if (!_timers.empty()) {
+	_pending = true;
+	_scheduled = _timers.top().when;
+	eventlist().sourceIsPending(*this, _scheduled);
+    }
+}
+
+void FluidNetwork::epoch() {
+    _nepochs++;
+
+    // what the packets pushed through last epoch is not there for the fluid flows
+    for (uint32_t l: _epoch_links) {
+	link_t& link = _links[l];
+	double packets = (double)(link.queue->_bytes_served - link.served) / _epoch;
+	link.served = link.queue->_bytes_served;
+	double capacity = link.full - packets;
+	if (capacity < link.full * _min_share)
+	    capacity = link.full * _min_share;
+	if (!link.flows.empty() && fabs(capacity - link.capacity) > link.full * 1e-3)
+	    _dirty_links.push_back(l);
+	link.capacity = capacity;
+    }
+    if (!_dirty_links.empty())
+	update_rates();
+
+    // and the packets only get what the fluid flows leave
+    for (size_t i = 0; i < _epoch_links.size(); ) {
+	link_t& link = _links[_epoch_links[i]];
+	if (link.flows.empty()) {
+	    link.queue->_ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / link.queue->_bitrate);
+	    link.capacity = link.full;
+	    link.in_epoch = false;
+	    _epoch_links[i] = _epoch_links.back();
+	    _epoch_links.pop_back();
+	    continue;
+	}
+	double left = link.full;
+	for (uint32_t f: link.flows)
+	    left -= _flows[f].rate;
+	if (left < link.full * _min_share)
+	    left = link.full * _min_share;
+	link.queue->_ps_per_byte = (simtime_picosec)(1 / left);
+	i++;
+    }
+
+    // all queues are back at line rate when nothing is flowing, the next arrival restarts us
+    _epoch_pending = !_epoch_links.empty();
+    if (_epoch_pending)
+	add_timer(eventlist().now() + _epoch, 0, EPOCH);
+}
+
+void FluidNetwork::print_stats(std::ostream& out) {
+    out << "Fluid flows " << _nflows << " links " << _links.size() << " events " << _nevents
+        << " epochs " << _nepochs << " rate_updates " << _nupdates
+        << " avg_links_per_update " << (_nupdates ? (double)_update_links / _nupdates : 0)
+        << " avg_flows_per_update " << (_nupdates ? (double)_update_flows / _nupdates : 0) << endl;
+}
@@ -0,0 +1,135 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef FLUID_H
+#define FLUID_H
+
+/*
+ * A flow-level network: every transfer is a fluid flow over the queues of
+ * its route, and flows share link capacity max-min fairly. Rates are
+ * recomputed by water-filling whenever flows arrive or drain, but only over
+ * the links and flows connected to the ones that changed; everything else
+ * keeps its rate and its scheduled drain time.
+ *
+ * A flow is done one propagation delay (plus store-and-forward of its last
+ * packet, plus the ack's way back) after its last byte drains, and then the
+ * same void(*)(void*) completion callback the packet-level sources take is
+ * called. Queueing, loss and congestion control are not modelled.
+ *
+ * In background mode (hybrid runs, where small flows stay packet-level) the
+ * two share the links once per epoch: fluid flows get what the packets did
+ * not use in the last epoch (counted by Queue::_bytes_served), and each
+ * queue's _ps_per_byte is stretched to the capacity the fluid flows leave.
+ */
+
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <fstream>
+#include "config.h"
+#include "eventlist.h"
+#include "route.h"
+#include "topology.h"
+#include "rng.h"
+
+class Queue;
+
+typedef void (*flow_callback_t)(void* data);
+
+class FluidNetwork : public EventSource {
+ public:
+    FluidNetwork(Topology* top, EventList& eventlist, std::ofstream* fct_out = NULL);
+
+    // route picked among top->get_paths(src, dst) at random, like the packet sources do
+    void start_flow(int src, int dst, uint64_t bytes, simtime_picosec start, flow_callback_t cb, void* data);
+    // over a route built by the caller (queues and pipes; anything else on it is ignored)
+    void start_flow(int src, int dst, const Route& route, uint64_t bytes, simtime_picosec start,
+                    flow_callback_t cb, void* data);
+
+    // share links with packet-level traffic, re-balanced every epoch
+    void set_background(simtime_picosec epoch, double min_share = 0.05);
+
+    void doNextEvent();
+    void print_stats(std::ostream& out);
+
+ private:
+    struct path_t {
+	std::vector<uint32_t> links;
+	simtime_picosec latency;
+    };
+    struct link_t {
+	Queue* queue;
+	double full; // line rate, bytes per picosecond
+	double capacity; // what the fluid flows may use, bytes per picosecond
+	uint64_t served; // queue->_bytes_served at the last epoch
+	bool in_epoch; // on _epoch_links
+	std::vector<uint32_t> flows; // active flows crossing this link
+	// water-filling scratch
+	uint32_t mark;
+	double residual;
+	uint32_t unfrozen;
+	uint32_t version;
+    };
+    struct flow_t {
+	const path_t* path;
+	std::vector<uint32_t> slot; // our position in links[path->links[i]].flows
+	int src, dst;
+	uint64_t bytes;
+	double remaining, rate;
+	simtime_picosec start, last; // remaining was valid at last
+	uint32_t version; // bumped when the rate changes, stale drain timers are dropped
+	uint32_t mark;
+	bool frozen;
+	bool own_path;
+	flow_callback_t cb;
+	void* data;
+    };
+    enum timer_kind { FLOW_ARRIVE, FLOW_DRAIN, FLOW_DELIVER, EPOCH };
+    struct flow_timer {
+	simtime_picosec when;
+	uint64_t seq; // ties fire in insertion order, like the eventlist
+	uint32_t flow;
+	uint32_t version;
+	timer_kind kind;
+	bool operator>(const flow_timer& o) const { return when != o.when ? when > o.when : seq > o.seq; }
+    };
+
+    typedef std::pair<double, std::pair<uint32_t, uint32_t>> share_t; // fair share, (link, link version)
+
+    uint32_t link_for(Queue* q);
+    path_t* make_path(const Route& route);
+    void add_flow(int src, int dst, const path_t* path, bool own_path, uint64_t bytes,
+                  simtime_picosec start, flow_callback_t cb, void* data);
+    void add_timer(simtime_picosec when, uint32_t flow, timer_kind kind);
+    void activate(uint32_t f);
+    void drain(uint32_t f);
+    void update_rates();
+    void epoch();
+
+    Topology* _top;
+    std::ofstream* _fct_out;
+    Rng _rng; // picks among the paths of a pair, as the packet-level sources do
+
+    std::vector<link_t> _links;
+    std::unordered_map<Queue*, uint32_t> _link_ids;
+    std::unordered_map<uint64_t, std::vector<const path_t*>> _paths; // src << 32 | dst
+
+    std::vector<flow_t> _flows;
+    std::vector<uint32_t> _free_flows;
+
+    std::priority_queue<flow_timer, std::vector<flow_timer>, std::greater<flow_timer>> _timers;
+    uint64_t _timer_seq;
+    bool _pending;
+    simtime_picosec _scheduled; // when we're pending in the eventlist
+
+    std::vector<uint32_t> _dirty_links; // seeds for the next rate update
+    std::vector<uint32_t> _comp_links, _comp_flows;
+    uint32_t _mark;
+
+    simtime_picosec _epoch; // 0: fluid flows have the links to themselves
+    double _min_share; // of the line rate, never taken away from either side
+    bool _epoch_pending;
+    std::vector<uint32_t> _epoch_links; // links fluid flows have used since their queue was last at line rate
+
+    uint64_t _nflows, _nupdates, _update_links, _update_flows, _nevents, _nepochs;
+};
+
+#endif
@@ -0,0 +1,98 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#include "fork_sweep.h"
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+struct child_t {
+    pid_t pid;
+    int fd; // read end of the child's pipe
+    size_t point;
+};
+
+static void write_all(int fd, const string& s)
+{
+    size_t done = 0;
+    while (done < s.size()) {
+	ssize_t n = write(fd, s.data() + done, s.size() - done);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n < 0)
+	    return;
+	done += n;
+    }
+}
+
+vector<string> fork_points(size_t npoints, int procs, const std::function<string(size_t)>& point)
+{
+    vector<string> results(npoints);
+    vector<child_t> running;
+    size_t next = 0;
+    procs = max(procs, 1);
+
+    cout.flush();
+    cerr.flush();
+    fflush(NULL);
+    while (next < npoints || !running.empty()) {
+	while (next < npoints && running.size() < (size_t)procs) {
+	    int fds[2];
+	    if (pipe(fds) < 0) {
+		perror("pipe");
+		exit(1);
+	    }
+	    pid_t pid = fork();
+	    if (pid < 0) {
+		perror("fork");
+		exit(1);
+	    }
+	    if (pid == 0) {
+		close(fds[0]);
+		for (child_t& c: running)
+		    close(c.fd);
+		write_all(fds[1], point(next));
+		close(fds[1]);
+		_exit(0);
+	    }
+	    close(fds[1]);
+	    child_t c = {pid, fds[0], next++};
+	    running.push_back(c);
+	}
+
+	// children only write when they are done, and a pipe at EOF is a child that has exited
+	vector<struct pollfd> pfds(running.size());
+	for (size_t i = 0; i < running.size(); i++) {
+	    pfds[i].fd = running[i].fd;
+	    pfds[i].events = POLLIN;
+	}
+	if (poll(pfds.data(), pfds.size(), -1) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    perror("poll");
+	    exit(1);
+	}
+	for (size_t i = running.size(); i-- > 0; ) {
+	    if (!pfds[i].revents)
+		continue;
+	    char buf[4096];
+	    ssize_t n = read(running[i].fd, buf, sizeof(buf));
+	    if (n > 0 || (n < 0 && errno == EINTR)) {
+		if (n > 0)
+		    results[running[i].point].append(buf, n);
+		continue;
+	    }
+	    close(running[i].fd);
+	    int status;
+	    waitpid(running[i].pid, &status, 0);
+	    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		cerr << "sweep point " << running[i].point << " died" << endl;
+		results[running[i].point].clear();
+	    }
+	    running.erase(running.begin() + i);
+	}
+    }
+    return results;
+}
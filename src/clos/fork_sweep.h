@@ -0,0 +1,29 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef FORK_SWEEP_H
+#define FORK_SWEEP_H
+
+/*
+ * Warm-started what-if runs. A simulation runs the prefix its sweep points
+ * share (topology and task graph loaded, the first iterations done) once,
+ * then forks a child per point: the child starts from a copy-on-write image
+ * of the parent, applies its point's overrides (FlatTopology::set_ecn_threshold,
+ * FFApplication::set_allreduce_strategy, ssthresh, a scheduler's
+ * reconf_delay...), runs to the end and hands one line of results back
+ * through a pipe. The parent doesn't run past the fork itself.
+ *
+ * Nothing may be running on other threads when fork_points is called. It
+ * flushes cout, cerr and stdio first so the children don't repeat what the
+ * prefix printed, and children leave with _exit: a child should write its
+ * own output to streams it opens (and closes) itself.
+ */
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "config.h"
+
+// point(n) for every n < npoints, each in a child process, at most procs at a time; returns
+// their results in point order, "" for a child that died before it answered
+vector<string> fork_points(size_t npoints, int procs, const std::function<string(size_t)>& point);
+
+#endif
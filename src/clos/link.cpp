@@ -0,0 +1,84 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#include <sstream>
+#include "link.h"
+#include "ecn.h"
+
+Link::Link(linkspeed_bps bitrate, mem_b maxsize, simtime_picosec delay, EventList& eventlist,
+	   QueueLogger* logger, mem_b ecn_threshold)
+    : Queue(bitrate, maxsize, eventlist, logger),
+      _delay(delay), _K(ecn_threshold), _departed(0), _last_departure(0), _pending(false)
+{
+    stringstream ss;
+    ss << "link(" << bitrate / 1000000 << "Mb/s," << maxsize << "bytes," << delay / 1000000 << "us)";
+    _nodename = ss.str();
+}
+
+void Link::depart_until(simtime_picosec t)
+{
+    while (_departed < _pkts.size() && _pkts[_departed].departs <= t) {
+	Packet* pkt = _pkts[_departed].pkt;
+	// marked on dequeue, like ECNQueue
+	if (_K >= 0 && _queuesize > _K)
+	    pkt->set_flags(pkt->flags() | ECN_CE);
+	_queuesize -= pkt->size();
+	_bytes_served += pkt->size();
+	if (_logger)
+	    _logger->logQueue(*this, QueueLogger::PKT_SERVICE, *pkt);
+	_departed++;
+    }
+}
+
+void Link::receivePacket(Packet& pkt)
+{
+    simtime_picosec now = eventlist().now();
+    depart_until(now);
+
+    if (_queuesize + pkt.size() > _maxsize) {
+	/* if the packet doesn't fit in the queue, drop it */
+	if (_logger)
+	    _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
+	pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_DROP);
+	pkt.free();
+	_num_drops++;
+	return;
+    }
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_ARRIVE);
+
+    _last_departure = max(now, _last_departure) + drainTime(&pkt);
+    pktrecord_t rec = {&pkt, _last_departure};
+    _pkts.push_back(rec);
+    _queuesize += pkt.size();
+    if (_logger)
+	_logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
+
+    if (!_pending) {
+	_pending = true;
+	eventlist().sourceIsPending(*this, _pkts.front().departs + _delay);
+    }
+}
+
+void Link::doNextEvent()
+{
+    simtime_picosec now = eventlist().now();
+    depart_until(now);
+
+    // everyone that has got to the other end; whatever the sinks send us meanwhile
+    // waits for the reschedule below
+    while (!_pkts.empty() && _pkts.front().departs + _delay <= now) {
+	Packet* pkt = _pkts.front().pkt;
+	_pkts.pop_front();
+	_departed--;
+	pkt->flow().logTraffic(*pkt, *this, TrafficLogger::PKT_DEPART);
+	pkt->sendOn();
+    }
+
+    _pending = !_pkts.empty();
+    if (_pending)
+	eventlist().sourceIsPending(*this, _pkts.front().departs + _delay);
+}
+
+mem_b Link::queuesize()
+{
+    depart_until(eventlist().now());
+    return _queuesize;
+}
@@ -0,0 +1,57 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef LINK_H
+#define LINK_H
+
+/*
+ * A drop-tail FIFO queue and the pipe behind it in one: it takes the place
+ * of both in a route and hands each packet straight to the hop after the
+ * pipe, when it gets there.
+ *
+ * Service is deterministic, so a packet's departure time is known the moment
+ * it is queued: max(now, last departure) + its drain time. Departures are
+ * therefore only accounted for (queuesize, ECN marks, the PKT_SERVICE log)
+ * when something next looks at the queue, and the only event a packet costs
+ * is its arrival at the next hop, one per link at a time for the packet at
+ * the head. A Queue and a Pipe cost two, the pipe's again one per link.
+ *
+ * Marks are the ECNQueue's, on dequeue, when queuesize is over ecn_threshold.
+ * Arrivals at the very picosecond another packet departs see it gone.
+ * Changing _ps_per_byte only affects packets queued afterwards, and there is
+ * no PAUSE handling: topologies that reconfigure or pause their queues
+ * (DynFlatScheduler, lossless) keep separate Queues and Pipes.
+ */
+
+#include <deque>
+#include "config.h"
+#include "queue.h"
+
+class Link : public Queue {
+ public:
+    // ecn_threshold < 0: never mark
+    Link(linkspeed_bps bitrate, mem_b maxsize, simtime_picosec delay, EventList& eventlist,
+	 QueueLogger* logger, mem_b ecn_threshold = -1);
+
+    void receivePacket(Packet& pkt);
+    void doNextEvent();
+    mem_b queuesize();
+    simtime_picosec delay() const { return _delay; }
+    void set_ecn_threshold(mem_b ecn_threshold) { _K = ecn_threshold; }
+
+ private:
+    struct pktrecord_t {
+	Packet* pkt;
+	simtime_picosec departs;
+    };
+
+    void depart_until(simtime_picosec t); // account for everything that left by t
+
+    simtime_picosec _delay;
+    mem_b _K;
+    // not yet delivered, in order: [0, _departed) are on the wire, the rest still queued
+    std::deque<pktrecord_t> _pkts;
+    size_t _departed;
+    simtime_picosec _last_departure;
+    bool _pending;
+};
+
+#endif
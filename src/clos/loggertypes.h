@@ -16,14 +16,12 @@ class RawLogEvent;
 class Logged {
  public:
     typedef uint32_t id_t;
-    Logged(const string& name) {_name=name; id=LASTIDNUM; Logged::LASTIDNUM++; }
+    Logged(const string& name); // id is the next in the current SimContext
     virtual ~Logged() {}
     virtual void setName(const string& name) { _name=name; }
     virtual const string& str() { return _name; };
     id_t id;
     string _name;
- private:
-    static id_t LASTIDNUM;
 };
 
 class Logger {
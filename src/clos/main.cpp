@@ -101,6 +101,7 @@ int main(int argc, char **argv) {
     }
 
     srand(time(NULL));
+    SimContext::current().reseed(time(NULL));
 
     // prepare the loggers
     stringstream filename(ios_base::out);
@@ -207,7 +207,7 @@ MultipathTcpSrc::inflate_window(uint32_t cwnd, int newly_acked,uint32_t mss) {
       tmp = 0;
     }
 
-    if (rand() % A_SCALE < tmp2 % A_SCALE){
+    if (SimContext::current().rng.below(A_SCALE) < tmp2 % A_SCALE){
       tmp++;
       tmp_float++;
     }
@@ -47,6 +47,7 @@ NdpSrc::NdpSrc(NdpLogger* logger, TrafficLogger* pktlogger, EventList &eventlist
     : EventSource(eventlist,"ndp"),  _logger(logger), _flow(pktlogger), _flow_src(flow_src), _flow_dst(flow_dst), application_callback(acf), application_callback_data(acd)
 {
     _mss = Packet::data_packet_size();
+    _rng.seed(SimContext::current().seed, RNG_NDP_SRC, _flow.flow_id());
 
     _base_rtt = timeInf;
     _acked_packets = 0;
@@ -157,6 +158,7 @@ void NdpSrc::set_paths(vector<const Route*>* rt_list){
 }
 
 void NdpSrc::startflow(){
+    live_counts.flows_started++;
     _highest_sent = 0;
     _last_acked = 0;
     
@@ -441,6 +443,7 @@ void NdpSrc::processAck(const NdpAck& ack) {
         //cout << "flowID " << get_id() << " bytes " << get_flowsize() << " FCT_ms " << timeAsMs(eventlist().now() - get_start_time()) << endl;
     
         // FCT output for processing: (src dst bytes fct_ms timestarted_ms)
+        live_counts.flows_done++;
         cout << "FCT " << get_flow_src() << " " << get_flow_dst() << " " << get_flowsize() <<
             " " << timeAsMs(eventlist().now() - get_start_time()) << " " << timeAsMs(get_start_time()) << endl;
         if (application_callback != nullptr) {
@@ -562,7 +565,7 @@ const Route* NdpSrc::choose_route() {
     case SCATTER_RANDOM:
 	//ECMP
 	assert(_paths.size() > 0);
-	_crt_path = random()%_paths.size();
+	_crt_path = _rng.below(_paths.size());
 	break;
     case SCATTER_PERMUTE:
 	//Cycle through a permutation.  Generally gets better load balancing than SCATTER_RANDOM.
@@ -707,7 +710,7 @@ void NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
 void NdpSrc::permute_paths() {
     int len = _paths.size();
     for (int i = 0; i < len; i++) {
-	int ix = random() % (len - i);
+	int ix = _rng.below(len - i);
 	const Route* tmppath = _paths[ix];
 	_paths[ix] = _paths[len-1-i];
 	_paths[len-1-i] = tmppath;
@@ -787,7 +790,7 @@ NdpSrc::retransmit_packet() {
 	    p = NdpPacket::newpkt(_flow, *rt, seqno, 0, _pkt_size, true,
 				  _paths.size(), last_packet);
 	    if (_route_strategy == SCATTER_RANDOM) {
-		_crt_path = random() % _paths.size();
+		_crt_path = _rng.below(_paths.size());
 	    } else {
 		_crt_path++;
 		if (_crt_path==_paths.size()){ 
@@ -969,6 +972,7 @@ void NdpSink::log_me() {
 void NdpSink::connect(NdpSrc& src, Route& route)
 {
     _src = &src;
+    _rng.seed(SimContext::current().seed, RNG_NDP_SINK, src._flow.flow_id());
     switch (_route_strategy) {
     case SINGLE_PATH:
 	_route = &route;
@@ -1145,7 +1149,7 @@ void NdpSink::send_ack(simtime_picosec ts, NdpPacket::seq_t ackno, NdpPacket::se
 			     _cumulative_ack, _pull_no, 
 			     _path_history[_path_hist_index].path_id());
 	if (_route_strategy == SCATTER_RANDOM) {
-	    _crt_path = random()%_paths.size();
+	    _crt_path = _rng.below(_paths.size());
 	} else {
 	    _crt_path++;
 	    if (_crt_path == _paths.size()) {
@@ -1180,7 +1184,7 @@ void NdpSink::send_nack(simtime_picosec ts, NdpPacket::seq_t ackno, NdpPacket::s
 			       _cumulative_ack, _pull_no,
 			       _path_history[_path_hist_index].path_id());
 	if (_route_strategy == SCATTER_RANDOM) {
-	    _crt_path = random()%_paths.size();
+	    _crt_path = _rng.below(_paths.size());
 	} else {
 	    _crt_path++;
 	    if (_crt_path == _paths.size()) {
@@ -1205,7 +1209,7 @@ void NdpSink::send_nack(simtime_picosec ts, NdpPacket::seq_t ackno, NdpPacket::s
 void NdpSink::permute_paths() {
     int len = _paths.size();
     for (int i = 0; i < len; i++) {
-	int ix = random() % (len - i);
+	int ix = _rng.below(len - i);
 	const Route* tmppath = _paths[ix];
 	_paths[ix] = _paths[len-1-i];
 	_paths[len-1-i] = tmppath;
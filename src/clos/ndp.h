@@ -13,6 +13,7 @@
 #include "config.h"
 #include "network.h"
 #include "ndppacket.h"
+#include "rng.h"
 #include "fairpullqueue.h"
 #include "eventlist.h"
 
@@ -94,6 +95,7 @@ class NdpSrc : public PacketSink, public EventSource {
     uint16_t _crt_direction;
     vector<const Route*> _paths;
     vector<const Route*> _original_paths; //paths in original permutation order
+    Rng _rng; // this flow's own stream for path choices, see rng.h
     vector<int> _path_counts_new; // only used for debugging, can remove later.
     vector<int> _path_counts_rtx; // only used for debugging, can remove later.
     vector<int> _path_counts_rto; // only used for debugging, can remove later.
@@ -241,6 +243,7 @@ class NdpSink : public PacketSink, public DataReceiver, public Logged {
     uint16_t _crt_direction;
     vector<const Route*> _paths; //paths in current permutation order
     vector<const Route*> _original_paths; //paths in original permutation order
+    Rng _rng; // seeded from the source's flow on connect
     const Route* _route;
 
    string _nodename;
@@ -1,9 +1,10 @@
 // -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-    
 #include "network.h"
-
-#define DEFAULTDATASIZE 1500
-int Packet::_data_packet_size = DEFAULTDATASIZE;
-bool Packet::_packet_size_fixed = false;
+#include "pipe.h"
+#include "ecnqueue.h"
+#include "link.h"
+#include "compositequeue.h"
+#include "queue_lossless.h"
 
 // use set_attrs only when we want to do a late binding of the route -
 // otherwise use set_route or set_rg
@@ -37,25 +38,50 @@ Packet::set_route(const Route &route){
 
 PacketSink *
 Packet::sendOn() {
-    PacketSink* nextsink;
+    const Route::hop_t* next;
     if (_route) {
 	if (_bounced) {
 	    assert(_nexthop > 0);
 	    assert(_nexthop < _route->size());
 	    assert(_nexthop < _route->reverse()->size());
 	    //assert(_route->size() == _route->reverse()->size());
-	    nextsink = _route->reverse()->at(_nexthop);
+	    next = &_route->reverse()->hop(_nexthop);
 	    _nexthop++;
 	} else {
 	    assert(_nexthop<_route->size());
-	    nextsink = _route->at(_nexthop);
+	    next = &_route->hop(_nexthop);
 	    _nexthop++;
 	}
     } else {
 	assert(0);
     }
-    nextsink->receivePacket(*this);
-    return nextsink;
+    // direct calls for the sink types routes are mostly made of, see Route::hop_t
+    switch (next->kind) {
+    case Route::HOP_PIPE:
+	static_cast<Pipe*>(next->sink)->Pipe::receivePacket(*this);
+	break;
+    case Route::HOP_QUEUE:
+	static_cast<Queue*>(next->sink)->Queue::receivePacket(*this);
+	break;
+    case Route::HOP_ECN_QUEUE:
+	static_cast<ECNQueue*>(next->sink)->ECNQueue::receivePacket(*this);
+	break;
+    case Route::HOP_LINK:
+	static_cast<Link*>(next->sink)->Link::receivePacket(*this);
+	break;
+    case Route::HOP_PRIORITY_QUEUE:
+	static_cast<PriorityQueue*>(next->sink)->PriorityQueue::receivePacket(*this);
+	break;
+    case Route::HOP_COMPOSITE_QUEUE:
+	static_cast<CompositeQueue*>(next->sink)->CompositeQueue::receivePacket(*this);
+	break;
+    case Route::HOP_LOSSLESS_QUEUE:
+	static_cast<LosslessQueue*>(next->sink)->LosslessQueue::receivePacket(*this);
+	break;
+    default:
+	next->sink->receivePacket(*this);
+    }
+    return next->sink;
 }
 
 PacketSink *
@@ -67,11 +93,11 @@ Packet::sendOn2(VirtualQueue* crtSink) {
 	    assert(_nexthop < _route->size());
 	    assert(_nexthop < _route->reverse()->size());
 	    //assert(_route->size() == _route->reverse()->size());
-	    nextsink = _route->reverse()->at(_nexthop);
+	    nextsink = _route->reverse()->hop(_nexthop).sink;
 	    _nexthop++;
 	} else {
 	    assert(_nexthop<_route->size());
-	    nextsink = _route->at(_nexthop);
+	    nextsink = _route->hop(_nexthop).sink;
 	    _nexthop++;
 	}
     } else {
@@ -162,13 +188,11 @@ Packet::str() const {
     return s;
 }
 
-uint32_t PacketFlow::_max_flow_id = 0;
-
 PacketFlow::PacketFlow(TrafficLogger* logger)
     : Logged("PacketFlow"),
       _logger(logger)
 {
-    _flow_id = _max_flow_id++;
+    _flow_id = SimContext::current().next_flow_id++;
 }
 
 void PacketFlow::set_logger(TrafficLogger *logger) {
@@ -191,4 +215,7 @@ void print_route(const Route& route) {
     cout << endl;
 }
 
-Logged::id_t Logged::LASTIDNUM = 1;
+Logged::Logged(const string& name)
+    : id(SimContext::current().next_logged_id++), _name(name)
+{
+}
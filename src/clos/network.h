@@ -6,7 +6,9 @@
 #include <iostream>
 #include "config.h"
 #include "loggertypes.h"
+#include "run_stats.h"
 #include "route.h"
+#include "sim_context.h"
 
 class Packet;
 class PacketFlow;
@@ -33,7 +35,6 @@ class PacketFlow : public Logged {
     inline uint32_t flow_id() const {return _flow_id;}
     bool log_me() const {return _logger != NULL;}
  protected:
-    static uint32_t _max_flow_id;
     uint32_t _flow_id;
     TrafficLogger* _logger;
 };
@@ -68,13 +69,15 @@ class Packet {
 	// If someone has already read the value of packet size, no
 	// longer allow it to be changed, or all hell will break
 	// loose.
-	assert(_packet_size_fixed == false);
-	_data_packet_size = packet_size;
+	SimContext& ctx = SimContext::current();
+	assert(ctx.packet_size_fixed == false);
+	ctx.data_packet_size = packet_size;
     }
 
     static int data_packet_size() {
-	_packet_size_fixed = true;
-	return _data_packet_size;
+	SimContext& ctx = SimContext::current();
+	ctx.packet_size_fixed = true;
+	return ctx.data_packet_size;
     }
 
     virtual PacketSink* sendOn(); // "go on to the next hop along your route"
@@ -110,10 +113,6 @@ class Packet {
 	     int pkt_size, packetid_t id);
     void set_attrs(PacketFlow& flow, int pkt_size, packetid_t id);
 
-    static int _data_packet_size; // default size of a TCP or NDP data packet,
-				  // measured in bytes
-    static bool _packet_size_fixed; //prevent foot-shooting
-    
     packet_type _type;
     
     uint16_t _size;
@@ -149,9 +148,10 @@ class PacketSink {
 // method will need to be invoked properly for each new/reused packet
 
 template<class P>
-class PacketDB {
+class PacketDB { // one per thread in each packet class, see sim_context.h
  public:
     P* allocPacket() {
+	live_counts.packets++;
 	if (_freelist.empty()) {
 	    return new P();
 	} else {
@@ -161,6 +161,7 @@ class PacketDB {
 	}
     };
     void freePacket(P* pkt) {
+	live_counts.packets--;
 	_freelist.push_back(pkt);
     };
 
@@ -12,8 +12,8 @@ const linkspeed_bps QcnReactor::RATEINCREASE=500000; //0.5Mb/s
 const linkspeed_bps QcnReactor::MINRATE=1000000; //1Mb/s
 const double QcnQueue::GAMMA = 2;
 
-PacketDB<QcnPacket> QcnPacket::_packetdb;
-PacketDB<QcnAck> QcnAck::_packetdb;
+thread_local PacketDB<QcnPacket> QcnPacket::_packetdb;
+thread_local PacketDB<QcnAck> QcnAck::_packetdb;
 
 
 QcnReactor::QcnReactor(QcnLogger* logger, TrafficLogger* pktlogger, EventList &eventlist)
@@ -11,6 +11,7 @@ Queue::Queue(linkspeed_bps bitrate, mem_b maxsize, EventList &eventlist,
       _maxsize(maxsize), _logger(logger), _bitrate(bitrate), _num_drops(0)
 {
     _queuesize = 0;
+    _bytes_served = 0;
     _ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / _bitrate);
     stringstream ss;
     ss << "queue(" << bitrate / 1000000 << "Mb/s," << maxsize << "bytes)";
@@ -32,6 +33,7 @@ void Queue::completeService()
     Packet *pkt = _enqueued.back();
     _enqueued.pop_back();
     _queuesize -= pkt->size();
+    _bytes_served += pkt->size();
     pkt->flow().logTraffic(*pkt, *this, TrafficLogger::PKT_DEPART);
     if (_logger)
         _logger->logQueue(*this, QueueLogger::PKT_SERVICE, *pkt);
@@ -69,6 +69,7 @@ public:
 
     linkspeed_bps _bitrate;
     simtime_picosec _ps_per_byte;  // service time, in picoseconds per byte
+    uint64_t _bytes_served; // seen by the fluid background model
     mem_b _queuesize;
     list<Packet*> _enqueued;
     int _num_drops;
@@ -1,7 +1,7 @@
 #include "rcppacket.h"
 
-PacketDB<RcpPacket> RcpPacket::_packetdb;
-PacketDB<RcpAck> RcpAck::_packetdb;
+thread_local PacketDB<RcpPacket> RcpPacket::_packetdb;
+thread_local PacketDB<RcpAck> RcpAck::_packetdb;
 
 
 
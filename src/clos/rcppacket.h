@@ -29,7 +29,7 @@ protected:
 	seq_t _seqno;
 	double _rtt;
 	double _rateaccumulator;
-	static PacketDB<RcpPacket> _packetdb;
+	static thread_local PacketDB<RcpPacket> _packetdb;
 	};
 
 class RcpAck : public Packet {
@@ -55,7 +55,7 @@ protected:
 	seq_t _ackno;
 	double _rtt;
 	double _rateaccumulator;
-	static PacketDB<RcpAck> _packetdb;
+	static thread_local PacketDB<RcpAck> _packetdb;
 	};
 
 #endif
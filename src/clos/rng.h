@@ -0,0 +1,86 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef RNG_H
+#define RNG_H
+
+/*
+ * Random streams derived from the simulation's master seed (SimContext::seed).
+ *
+ * An Rng is a xoshiro256** generator seeded from (seed, component, id), so
+ * every flow, queue or app draws from a stream of its own and doesn't shift
+ * anyone else's numbers by drawing more or fewer of them. Where even the
+ * order of draws within a component depends on how events interleave (ECMP
+ * choices for tasks that start in any order), use Rng::at(), which is a pure
+ * function of (seed, stream, counter) and needs no state at all.
+ *
+ * below() maps a draw to [0, n) with a multiply and a shift instead of the
+ * division in rand() % n.
+ */
+
+#include <stdint.h>
+
+enum RngComponent {
+    RNG_CONTEXT = 1, // drand() and whatever has no stream of its own
+    RNG_FFAPP,       // an FFApplication's persistent connections
+    RNG_FFTASK,      // per task and iteration path choices
+    RNG_PLACEMENT,   // FFApplication::choose_gpus
+    RNG_TCP,         // per TcpSrc, RANDOM_PATH
+    RNG_NDP_SRC,     // per NdpSrc, path choice and permutation
+    RNG_NDP_SINK,
+    RNG_FLUID,
+    RNG_DYN_NET,     // DynFlatScheduler topologies and rounding
+};
+
+class Rng {
+ public:
+    typedef uint64_t result_type; // usable with <random> and <algorithm>
+
+    Rng() { seed(0, 0, 0); }
+    Rng(uint64_t seed, uint32_t component, uint64_t id = 0) { this->seed(seed, component, id); }
+
+    void seed(uint64_t seed, uint32_t component, uint64_t id = 0) {
+	uint64_t x = stream(seed, component, id);
+	for (int i = 0; i < 4; i++)
+	    _s[i] = splitmix(x);
+    }
+
+    uint64_t next() {
+	uint64_t r = rotl(_s[1] * 5, 7) * 9;
+	uint64_t t = _s[1] << 17;
+	_s[2] ^= _s[0];
+	_s[3] ^= _s[1];
+	_s[1] ^= _s[2];
+	_s[0] ^= _s[3];
+	_s[2] ^= t;
+	_s[3] = rotl(_s[3], 45);
+	return r;
+    }
+    uint32_t below(uint32_t n) { return below(next(), n); }
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); } // [0, 1)
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return ~(uint64_t)0; }
+    uint64_t operator()() { return next(); }
+
+    // counter-based draws: the counter'th number of a stream, in any order
+    static uint64_t at(uint64_t seed, uint32_t component, uint64_t id, uint64_t counter) {
+	uint64_t x = stream(seed, component, id) ^ mix(counter);
+	return splitmix(x);
+    }
+    static uint32_t below(uint64_t draw, uint32_t n) { return (uint32_t)(((draw >> 32) * n) >> 32); }
+
+ private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    static uint64_t mix(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+    }
+    static uint64_t splitmix(uint64_t& x) { return mix(x += 0x9E3779B97F4A7C15ULL); }
+    static uint64_t stream(uint64_t seed, uint32_t component, uint64_t id) {
+	return mix(mix(seed) ^ ((uint64_t)component << 56) ^ mix(id + 0x9E3779B97F4A7C15ULL));
+    }
+
+    uint64_t _s[4];
+};
+
+#endif
@@ -3,12 +3,37 @@
 #include "route.h"
 #include "network.h"
 #include "queue.h"
+#include "pipe.h"
+#include "ecnqueue.h"
+#include "link.h"
+#include "compositequeue.h"
+#include "queue_lossless.h"
+#include <typeinfo>
 
 
 #define MAXQUEUES 10
 
+Route::hop_kind_t Route::kind_of(PacketSink* sink) {
+    const std::type_info& t = typeid(*sink);
+    if (t == typeid(Pipe))
+	return HOP_PIPE;
+    if (t == typeid(ECNQueue))
+	return HOP_ECN_QUEUE;
+    if (t == typeid(Link))
+	return HOP_LINK;
+    if (t == typeid(Queue))
+	return HOP_QUEUE;
+    if (t == typeid(PriorityQueue))
+	return HOP_PRIORITY_QUEUE;
+    if (t == typeid(CompositeQueue))
+	return HOP_COMPOSITE_QUEUE;
+    if (t == typeid(LosslessQueue))
+	return HOP_LOSSLESS_QUEUE;
+    return HOP_SINK;
+}
+
 void Route::add_endpoints(PacketSink *src, PacketSink* dst) {
-    _sinklist.push_back(dst);
+    push_back(dst);
     if (_reverse) {
 	_reverse->push_back(src);
     }
@@ -13,16 +13,39 @@
 class PacketSink;
 class Route {
   public:
+    // A hop is stored with the concrete type of its sink, worked out once when the
+    // route is built, so that Packet::sendOn can call the common ones directly
+    // instead of through the vtable. Only exact types count: anything derived
+    // from them, and endpoints, are HOP_SINK and take the virtual call.
+    enum hop_kind_t {HOP_SINK, HOP_PIPE, HOP_QUEUE, HOP_ECN_QUEUE, HOP_LINK, HOP_PRIORITY_QUEUE,
+		     HOP_COMPOSITE_QUEUE, HOP_LOSSLESS_QUEUE};
+    struct hop_t {
+	PacketSink* sink;
+	hop_kind_t kind;
+    };
+    static hop_kind_t kind_of(PacketSink* sink);
+
     Route() : _reverse(NULL) {};
-    inline PacketSink* at(size_t n) const {return _sinklist.at(n);}
-    void push_back(PacketSink* sink) {_sinklist.push_back(sink);}
-    void push_front(PacketSink* sink) {_sinklist.insert(_sinklist.begin(), sink);}
+    inline PacketSink* at(size_t n) const {return _hops.at(n).sink;}
+    inline const hop_t& hop(size_t n) const {return _hops[n];} // unchecked, for the forwarding path
+    // NULL sinks are left out: a topology built with Links has no pipes to add
+    void push_back(PacketSink* sink) {if (sink) _hops.push_back(make_hop(sink));}
+    void push_front(PacketSink* sink) {if (sink) _hops.insert(_hops.begin(), make_hop(sink));}
     void add_endpoints(PacketSink *src, PacketSink* dst);
-    inline size_t size() const {return _sinklist.size();}
-    typedef vector<PacketSink*>::const_iterator const_iterator;
-    //typedef vector<PacketSink*>::iterator iterator;
-    inline const_iterator begin() const {return _sinklist.begin();}
-    inline const_iterator end() const {return _sinklist.end();}
+    inline size_t size() const {return _hops.size();}
+    // iterates over the sinks, as when this was a vector<PacketSink*>
+    class const_iterator {
+      public:
+	const_iterator(vector<hop_t>::const_iterator i) : _i(i) {}
+	PacketSink* operator*() const {return _i->sink;}
+	const_iterator& operator++() {++_i; return *this;}
+	bool operator==(const const_iterator& o) const {return _i == o._i;}
+	bool operator!=(const const_iterator& o) const {return _i != o._i;}
+      private:
+	vector<hop_t>::const_iterator _i;
+    };
+    inline const_iterator begin() const {return const_iterator(_hops.begin());}
+    inline const_iterator end() const {return const_iterator(_hops.end());}
     void set_reverse(Route* reverse) {_reverse = reverse;}
     inline const Route* reverse() const {return _reverse;}
     void set_path_id(int path_id, int no_of_paths) {
@@ -32,7 +55,9 @@ class Route {
     inline int path_id() const {return _path_id;}
     inline int no_of_paths() const {return _no_of_paths;}
  private:
-    vector<PacketSink*> _sinklist;
+    static hop_t make_hop(PacketSink* sink) {hop_t h = {sink, kind_of(sink)}; return h;}
+
+    vector<hop_t> _hops;
     Route* _reverse;
     int _path_id; //path identifier for this path
     int _no_of_paths; //total number of paths sender is using
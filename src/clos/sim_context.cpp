@@ -0,0 +1,24 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#include "sim_context.h"
+
+#define DEFAULTDATASIZE 1500
+
+thread_local SimContext* SimContext::_current = NULL;
+thread_local SimContext SimContext::_thread_default;
+
+SimContext::SimContext(uint64_t seed)
+    : next_logged_id(1),
+      next_flow_id(0),
+      data_packet_size(DEFAULTDATASIZE),
+      packet_size_fixed(false),
+      total_apps(0),
+      finished_apps(0),
+      demand_recorder(NULL)
+{
+    reseed(seed);
+}
+
+SimContext::SimContext()
+    : SimContext(0)
+{
+}
@@ -0,0 +1,67 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef SIM_CONTEXT_H
+#define SIM_CONTEXT_H
+
+/*
+ * What one simulation used to keep in globals and class statics: its
+ * eventlist, the Logged and PacketFlow id counters, the data packet size,
+ * the FFApplication tally, the demand recorder and the master seed that
+ * every random stream is derived from (see rng.h).
+ *
+ * A simulation runs with its context bound to the thread (SimContext::Scope);
+ * code that isn't handed the context finds it with SimContext::current(), so
+ * any number of threads can each run a simulation of their own. A thread
+ * that never binds one gets a default context of its own, seeded with 0
+ * until the main reseeds it.
+ *
+ * Packet pools are thread_local rather than per context: they only recycle
+ * memory, and can be shared by the simulations a thread runs in turn.
+ */
+
+#include <stdint.h>
+#include "eventlist.h"
+#include "rng.h"
+
+struct DemandRecorder;
+
+class SimContext {
+ public:
+    explicit SimContext(uint64_t seed);
+
+    EventList eventlist;
+
+    Logged::id_t next_logged_id;
+    uint32_t next_flow_id;
+    int data_packet_size; // see Packet::set_packet_size()
+    bool packet_size_fixed;
+    int total_apps; // FFApplications, and how many of them are done
+    int finished_apps;
+    DemandRecorder* demand_recorder;
+
+    uint64_t seed;
+    Rng rng; // the RNG_CONTEXT stream
+    void reseed(uint64_t s) { seed = s; rng.seed(s, RNG_CONTEXT); } // before anything draws
+
+    static SimContext& current() { return _current ? *_current : _thread_default; }
+
+    // binds ctx to this thread for the lifetime of the scope
+    class Scope {
+     public:
+	explicit Scope(SimContext& ctx) : _prev(_current) { _current = &ctx; }
+	~Scope() { _current = _prev; }
+     private:
+	Scope(const Scope&);
+	Scope& operator=(const Scope&);
+	SimContext* _prev;
+    };
+
+ private:
+    SimContext(); // the per-thread default
+    SimContext(const SimContext&);
+    SimContext& operator=(const SimContext&);
+
+    static thread_local SimContext* _current;
+    static thread_local SimContext _thread_default;
+};
+
+#endif
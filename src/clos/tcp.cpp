@@ -10,7 +10,6 @@
 ////////////////////////////////////////////////////////////////
 //  TCP SOURCE
 ////////////////////////////////////////////////////////////////
-DemandRecorder * TcpSrc::demand_recorder = nullptr;
 
 TcpSrc::TcpSrc(TcpLogger *logger, TrafficLogger *pktlogger, ofstream *_fstream_out,
 							 EventList &eventlist, int flow_src, int flow_dst, 
@@ -32,6 +31,7 @@ TcpSrc::TcpSrc(TcpLogger *logger, TrafficLogger *pktlogger, ofstream *_fstream_o
 	_established = false;
 	_effcwnd = 0;
 	_finished = false;
+	_message_mode = false;
 
 	fstream_out = _fstream_out;
 	//_ssthresh = 30000;
@@ -57,6 +57,9 @@ TcpSrc::TcpSrc(TcpLogger *logger, TrafficLogger *pktlogger, ofstream *_fstream_o
 	DUPACK_TH = 3;
 	_paths = NULL;
 #endif
+#ifdef RANDOM_PATH
+	_path_rng.seed(SimContext::current().seed, RNG_TCP, _flow.flow_id());
+#endif
 
 	_old_route = NULL;
 	_last_packet_with_old_route = 0;
@@ -123,8 +126,8 @@ void TcpSrc::set_flowsize(uint64_t flow_size_in_bytes)
 	if (_flow_size < _mss)
 		_flow_size = _mss;
 
-	// if (demand_recorder)
-	// 	demand_recorder->add_demand(_flow_src, _flow_dst, _flow_size);
+	// if (SimContext::current().demand_recorder)
+	// 	SimContext::current().demand_recorder->add_demand(_flow_src, _flow_dst, _flow_size);
 
 	// !!! Note: need to implement this for short flows:
 
@@ -134,6 +137,33 @@ void TcpSrc::set_flowsize(uint64_t flow_size_in_bytes)
 	//  _pkt_size = _mss;
 }
 
+void TcpSrc::send_message(uint64_t bytes, simtime_picosec start, void (*cb)(void *), void *data)
+{
+	if (!_message_mode)
+	{
+		_message_mode = true;
+		_flow_size = 1; // the SYN
+	}
+	if (bytes < _mss)
+		bytes = _mss;
+
+	// whole packets, so the next message starts on a packet boundary
+	message_t m;
+	m.end = _flow_size + (bytes + _mss - 1) / _mss * _mss;
+	m.bytes = bytes;
+	m.start = start;
+	m.cb = cb;
+	m.data = data;
+	_messages.push_back(m);
+	_flow_size = m.end;
+	live_counts.flows_started++;
+
+	// an idle connection has no acks coming back to clock this out; before the
+	// handshake, startflow (or the SYN/ACK) will
+	if (_established)
+		send_packets();
+}
+
 void TcpSrc::set_app_limit(int pktps)
 {
 	if (_app_limited == 0 && pktps)
@@ -147,6 +177,8 @@ void TcpSrc::set_app_limit(int pktps)
 
 void TcpSrc::startflow()
 {
+	if (!_message_mode)
+		live_counts.flows_started++; // a message counts when it's sent
 	_cwnd = 100 * _mss;
 	// _cwnd = 1 << 23;
 	_unacked = _cwnd;
@@ -266,10 +298,24 @@ void TcpSrc::receivePacket(Packet &pkt)
 	// debug:
 	// cout << (uint64_t)this << " seqno = " << seqno << ", _flow_size = " <<  _flow_size << ", _mss = " << _mss << ", packet size = " << pkt.size() << " cwnd " << _cwnd << " ssthresh " << _ssthresh << " time " << eventlist().now() << endl;
 
-	if (seqno >= _flow_size && !_finished)
+	if (_message_mode)
+	{
+		while (!_messages.empty() && seqno >= _messages.front().end)
+		{
+			message_t m = _messages.front();
+			_messages.pop_front();
+			live_counts.flows_done++;
+			*(fstream_out) << "FCT " << get_flow_src() << " " << get_flow_dst() << " " << m.bytes << " " << timeAsMs(eventlist().now() - m.start) << " " << timeAsMs(m.start) << " " << (double)m.bytes / timeAsSec(eventlist().now() - m.start) * 8 / 1000000000UL << endl;
+			// may send the next message right away
+			if (m.cb != nullptr)
+				m.cb(m.data);
+		}
+	}
+	else if (seqno >= _flow_size && !_finished)
 	{
 		_last_acked =
 		_finished = true;
+		live_counts.flows_done++;
 		// original:
 		//cout << "Flow " << nodename() << " finished at " << timeAsMs(eventlist().now()) << endl;
 
@@ -572,7 +618,7 @@ void TcpSrc::send_packets()
 		{
 
 #ifdef RANDOM_PATH
-			_crt_path = random() % _paths->size();
+			_crt_path = _path_rng.below(_paths->size());
 #endif
 
 			p = TcpPacket::newpkt(_flow, *(_paths->at(_crt_path)), _highest_sent + 1,
@@ -633,7 +679,7 @@ void TcpSrc::retransmit_packet()
 	{
 
 #ifdef RANDOM_PATH
-		_crt_path = random() % _paths->size();
+		_crt_path = _path_rng.below(_paths->size());
 #endif
 
 		p = TcpPacket::newpkt(_flow, *(_paths->at(_crt_path)), _last_acked + 1, data_seq, _mss);
@@ -814,16 +860,16 @@ void TcpSink::receivePacket(Packet &pkt)
 	if (seqno == _cumulative_ack + 1)
 	{ // it's the next expected seq no
 		_cumulative_ack = seqno + size - 1;
-		// if (_src->demand_recorder)
-		// 	_src->demand_recorder->satisfied(_src->_flow_src, _src->_flow_dst, size);
+		// if (SimContext::current().demand_recorder)
+		// 	SimContext::current().demand_recorder->satisfied(_src->_flow_src, _src->_flow_dst, size);
 		//cout << "New cumulative ack is " << _cumulative_ack << endl;
 		// are there any additional received packets we can now ack?
 		while (!_received.empty() && (_received.front() == _cumulative_ack + 1))
 		{
 			_received.pop_front();
 			_cumulative_ack += size;
-			// if (_src->demand_recorder)
-				// _src->demand_recorder->satisfied(_src->_flow_src, _src->_flow_dst, size);
+			// if (SimContext::current().demand_recorder)
+				// SimContext::current().demand_recorder->satisfied(_src->_flow_src, _src->_flow_dst, size);
 		}
 	}
 	else if (seqno < _cumulative_ack + 1)
@@ -871,7 +917,7 @@ void TcpSink::send_ack(simtime_picosec ts, bool marked)
 	if (_paths)
 	{
 #ifdef RANDOM_PATH
-		_crt_path = random() % _paths->size();
+		_crt_path = _path_rng.below(_paths->size());
 #endif
 
 		rt = _paths->at(_crt_path);
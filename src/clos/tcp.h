@@ -7,11 +7,13 @@
  */
 
 #include <list>
+#include <deque>
 #include "config.h"
 #include "network.h"
 #include "tcppacket.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "rng.h"
 // #include "dyn_net_sch.h"
 
 // #define MODEL_RECEIVE_WINDOW 1
@@ -22,7 +24,6 @@
 // #define RANDOM_PATH 1
 
 //#define MAX_SENT 10000
-struct DemandRecorder;
 
 class TcpSink;
 class MultipathTcpSrc;
@@ -47,8 +48,6 @@ class TcpSrc : public PacketSink, public EventSource {
     void (*application_callback)(void*);
     void * application_callback_data;
 
-    static DemandRecorder * demand_recorder;
-
     void doNextEvent();
     virtual void receivePacket(Packet& pkt);
 
@@ -56,6 +55,10 @@ class TcpSrc : public PacketSink, public EventSource {
 
     void set_flowsize(uint64_t flow_size_in_bytes);
 
+    // message mode, instead of set_flowsize: the connection carries messages back to back and
+    // never finishes; each one gets its FCT line and callback when its last byte is acked
+    void send_message(uint64_t bytes, simtime_picosec start, void (*cb)(void*), void* data);
+
     void set_ssthresh(uint64_t s){_ssthresh = s;}
 
     uint32_t effective_window();
@@ -78,9 +81,13 @@ class TcpSrc : public PacketSink, public EventSource {
     uint32_t _ssthresh;
     uint16_t _dupacks;
     bool _finished;
+    bool _message_mode;
 #ifdef PACKET_SCATTER
     uint16_t DUPACK_TH;
     uint16_t _crt_path;
+#endif
+#ifdef RANDOM_PATH
+    Rng _path_rng; // this flow's own stream, see rng.h
 #endif
     ofstream * fstream_out;
 
@@ -134,6 +141,15 @@ class TcpSrc : public PacketSink, public EventSource {
     int _flow_dst; // the receiver (sink) for this flow
 
  private:
+    struct message_t {
+	uint64_t end; // acked once the cumulative ack reaches this
+	uint64_t bytes;
+	simtime_picosec start;
+	void (*cb)(void*);
+	void* data;
+    };
+    std::deque<message_t> _messages;
+
     const Route* _old_route;
     uint64_t _last_packet_with_old_route;
 
@@ -0,0 +1,123 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#include <chrono>
+#include "event_profile.h"
+#include <algorithm>
+#include <iomanip>
+#include <cxxabi.h>
+#include <stdlib.h>
+#include "eventlist.h"
+
+static double wall_secs()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+EventProfiler::EventProfiler(simtime_picosec bucket, uint32_t sample_every)
+    : _bucket(bucket), _sample_every(max(sample_every, (uint32_t)1)), _countdown(1), _events(0),
+      _start(wall_secs())
+{
+}
+
+uint32_t EventProfiler::class_of(const std::type_info& type)
+{
+    auto i = _class_ids.find(std::type_index(type));
+    if (i != _class_ids.end())
+	return i->second;
+
+    int status;
+    char* demangled = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+    class_t c = {status == 0 ? demangled : type.name(), 0, 0, 0};
+    free(demangled);
+    _classes.push_back(c);
+    _class_ids[std::type_index(type)] = _classes.size() - 1;
+    return _classes.size() - 1;
+}
+
+void EventProfiler::run(EventSource& src, simtime_picosec now)
+{
+    const std::type_info& type = typeid(src);
+    auto s = _sources.find(&src);
+    if (s == _sources.end() || s->second.type != std::type_index(type)) {
+	source_t info = {std::type_index(type), class_of(type), src.str(), 0};
+	s = _sources.insert_or_assign(&src, info).first;
+    }
+    uint32_t cls = s->second.cls;
+    s->second.events++;
+    _classes[cls].events++;
+    _events++;
+
+    size_t b = now / _bucket;
+    if (b >= _buckets.size())
+	_buckets.resize(b + 1);
+    if (cls >= _buckets[b].size())
+	_buckets[b].resize(_classes.size());
+    _buckets[b][cls]++;
+
+    if (--_countdown > 0) {
+	src.doNextEvent();
+	return;
+    }
+    _countdown = _sample_every;
+    auto t0 = std::chrono::steady_clock::now();
+    src.doNextEvent();
+    _classes[cls].sampled_secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    _classes[cls].sampled++;
+}
+
+void EventProfiler::report(ostream& out, size_t top_sources)
+{
+    double wall = wall_secs() - _start;
+
+    // a class's time is its sampled events' times scaled up to all of its events
+    vector<double> est(_classes.size());
+    double est_total = 0;
+    for (size_t c = 0; c < _classes.size(); c++) {
+	const class_t& cl = _classes[c];
+	est[c] = cl.sampled ? cl.sampled_secs * cl.events / cl.sampled : 0;
+	est_total += est[c];
+    }
+    vector<uint32_t> order(_classes.size());
+    for (size_t c = 0; c < order.size(); c++)
+	order[c] = c;
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return _classes[a].events > _classes[b].events; });
+
+    out << "# event profile: " << _events << " events in " << wall << " s, 1 in " << _sample_every << " timed" << endl;
+    out << "# class events %events est_secs %time ns/event" << endl;
+    out << fixed;
+    for (uint32_t c: order) {
+	const class_t& cl = _classes[c];
+	out << "Class " << cl.name << " " << cl.events
+	    << " " << setprecision(1) << 100.0 * cl.events / max(_events, (uint64_t)1)
+	    << " " << setprecision(4) << est[c]
+	    << " " << setprecision(1) << (est_total > 0 ? 100.0 * est[c] / est_total : 0)
+	    << " " << setprecision(0) << (cl.sampled ? 1e9 * cl.sampled_secs / cl.sampled : 0) << endl;
+    }
+
+    vector<const source_t*> busiest;
+    for (auto& s: _sources)
+	busiest.push_back(&s.second);
+    size_t n = min(top_sources, busiest.size());
+    partial_sort(busiest.begin(), busiest.begin() + n, busiest.end(),
+		 [](const source_t* a, const source_t* b) { return a->events > b->events; });
+    out << "# source class events" << endl;
+    for (size_t i = 0; i < n; i++)
+	out << "Source " << busiest[i]->name << " " << _classes[busiest[i]->cls].name << " " << busiest[i]->events << endl;
+
+    out << "# bucket start_us events events_per_sim_sec busiest_class" << endl;
+    for (size_t b = 0; b < _buckets.size(); b++) {
+	const vector<uint64_t>& counts = _buckets[b];
+	uint64_t total = 0;
+	size_t top = 0;
+	for (size_t c = 0; c < counts.size(); c++) {
+	    total += counts[c];
+	    if (counts[c] > counts[top])
+		top = c;
+	}
+	if (total == 0)
+	    continue;
+	out << "Bucket " << setprecision(3) << timeAsUs(b * _bucket) << " " << total
+	    << " " << setprecision(0) << total / timeAsSec(_bucket) << " " << _classes[top].name << endl;
+    }
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+}
@@ -0,0 +1,62 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef EVENT_PROFILE_H
+#define EVENT_PROFILE_H
+
+/*
+ * Where a run's events go: how many each EventSource class and each named
+ * source handled, an estimate of the wall-clock time per class from timing
+ * one event in every sample_every, and events per bucket of simulated time.
+ *
+ * Only there when built with -DEVENT_PROFILE (make EVENT_PROFILE=1); without
+ * it EventList::doNextEvent has no hook at all. With it, an EventList that
+ * hasn't been given a profiler pays one branch per event.
+ */
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <map>
+#include <typeindex>
+#include "config.h"
+
+class EventSource;
+
+class EventProfiler {
+ public:
+    EventProfiler(simtime_picosec bucket, uint32_t sample_every = 64);
+
+    // EventList::doNextEvent hands every event here instead of calling src directly
+    void run(EventSource& src, simtime_picosec now);
+
+    // per class, the busiest sources, then per bucket
+    void report(ostream& out, size_t top_sources = 10);
+
+ private:
+    struct class_t {
+	string name;
+	uint64_t events;
+	uint64_t sampled;
+	double sampled_secs;
+    };
+    struct source_t {
+	std::type_index type; // a freed source's address may be reused by another type
+	uint32_t cls;
+	string name; // taken at its first event, the source may be gone by report()
+	uint64_t events;
+    };
+
+    uint32_t class_of(const std::type_info& type);
+
+    simtime_picosec _bucket;
+    uint32_t _sample_every;
+    uint32_t _countdown;
+    uint64_t _events;
+    double _start; // steady clock seconds; <chrono> and <unordered_map> stay out of here, config.h defines max and min
+
+    vector<class_t> _classes;
+    map<std::type_index, uint32_t> _class_ids;
+    map<EventSource*, source_t> _sources;
+    vector<vector<uint64_t> > _buckets; // [bucket][class] events
+};
+
+#endif
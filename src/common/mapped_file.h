@@ -0,0 +1,62 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+/*
+ * A file mapped read-only into memory. Flatbuffer inputs are read in place
+ * from the mapping instead of being copied into a string first, and pages
+ * that are never looked at are never read from disk.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+class MappedFile {
+ public:
+    MappedFile() : _data(NULL), _size(0) {}
+    ~MappedFile() { close(); }
+
+    // false if the file can't be opened, is empty or can't be mapped
+    bool open(const char* name) {
+	close();
+	int fd = ::open(name, O_RDONLY);
+	if (fd < 0)
+	    return false;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+	    ::close(fd);
+	    return false;
+	}
+	void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps the file
+	if (p == MAP_FAILED)
+	    return false;
+	madvise(p, st.st_size, MADV_WILLNEED);
+	_data = static_cast<const uint8_t*>(p);
+	_size = st.st_size;
+	return true;
+    }
+
+    void close() {
+	if (_data)
+	    munmap(const_cast<uint8_t*>(_data), _size);
+	_data = NULL;
+	_size = 0;
+    }
+
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+
+ private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const uint8_t* _data;
+    size_t _size;
+};
+
+#endif
@@ -0,0 +1,77 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include "run_stats.h"
+
+static double wall_secs()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const double process_start = wall_secs();
+
+thread_local LiveCounts live_counts;
+
+void RunStats::started()
+{
+    _start = wall_secs();
+}
+
+void RunStats::print(ostream& out, uint64_t events, simtime_picosec simtime)
+{
+    double run = wall_secs() - _start;
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru); // ru_maxrss is in kB on Linux
+
+    out << "Bench events " << events << " sim_s " << timeAsSec(simtime)
+	<< " setup_s " << _start - process_start << " run_s " << run
+	<< " events_per_s " << (run > 0 ? events / run : 0)
+	<< " sim_per_wall " << (run > 0 ? timeAsSec(simtime) / run : 0)
+	<< " maxrss_kb " << ru.ru_maxrss << endl;
+}
+
+void Progress::start(double interval, simtime_picosec now, simtime_picosec endtime, double (*done)(void*), void* data)
+{
+    _interval = interval;
+    _started = now;
+    _endtime = endtime;
+    _done = done;
+    _data = data;
+    _start = _last = wall_secs();
+    _last_events = 0;
+    _last_sim = now;
+}
+
+void Progress::check(uint64_t events, simtime_picosec now)
+{
+    double t = wall_secs();
+    if (t - _last < _interval)
+	return;
+
+    double span = t - _last, elapsed = t - _start;
+    double eta = -1;
+    double done = _done ? _done(_data) : 0;
+    if (done > 0 && done < 1) // all done and still running: down to the endtime then
+	eta = elapsed * (1 - done) / done;
+    else if (now > _started && _endtime > now)
+	eta = elapsed * (timeAsSec(_endtime) - timeAsSec(now)) / (timeAsSec(now) - timeAsSec(_started));
+
+    // one write, so lines from simulations on other threads don't interleave
+    stringstream line;
+    line << "Progress sim_ms " << timeAsMs(now) << " events " << events
+	 << " events_per_s " << (events - _last_events) / span
+	 << " sim_per_wall " << (timeAsSec(now) - timeAsSec(_last_sim)) / span
+	 << " flows " << live_counts.flows_started - live_counts.flows_done
+	 << " packets " << live_counts.packets << " eta_s ";
+    if (eta >= 0)
+	line << eta << "\n";
+    else
+	line << "-\n";
+    cerr << line.str() << flush;
+
+    _last = t;
+    _last_events = events;
+    _last_sim = now;
+}
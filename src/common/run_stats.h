@@ -0,0 +1,75 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+/*
+ * What a run cost, as the one line test/bench/run_bench.sh reads:
+ *
+ *   Bench events N sim_s S setup_s A run_s B events_per_s E sim_per_wall R maxrss_kb K
+ *
+ * setup_s is from process start (static initialisation, near enough) to
+ * started(), i.e. reading the topology and traffic and building the network;
+ * run_s is from started() to print(). Times are steady clock seconds kept as
+ * doubles, so <chrono> stays out of here (config.h may define max and min).
+ */
+
+#include <ostream>
+#include "config.h"
+
+class RunStats {
+ public:
+    RunStats() : _start(0) {}
+
+    void started(); // just before the event loop
+    void print(ostream& out, uint64_t events, simtime_picosec simtime);
+
+ private:
+    double _start;
+};
+
+/*
+ * -progress SECS: a line on stderr about every SECS of wall time while the
+ * event loop runs,
+ *
+ *   Progress sim_ms T events N events_per_s E sim_per_wall R flows F packets P eta_s S
+ *
+ * with the two rates over the last interval. The loop calls poll() for every
+ * event; it only looks at the clock once every 64k events, so leaving it in
+ * costs next to nothing when reporting is off. eta_s comes from the done()
+ * fraction if the main gave one (the task graph's tasks, say) and it is
+ * short of 1, else from the endtime at the run's average sim_per_wall, and
+ * is "-" before either has anything to go on.
+ */
+
+// on this thread: flows begun and done (the transports count them where they
+// print FCT lines) and packets out of a PacketDB pool and not freed yet
+struct LiveCounts {
+    uint64_t flows_started;
+    uint64_t flows_done;
+    int64_t packets;
+};
+extern thread_local LiveCounts live_counts;
+
+class Progress {
+ public:
+    Progress() : _interval(0) {}
+
+    void start(double interval, simtime_picosec now, simtime_picosec endtime, double (*done)(void*) = NULL, void* data = NULL);
+    void poll(uint64_t events, simtime_picosec now) {
+	if ((events & 0xffff) == 0 && _interval > 0)
+	    check(events, now);
+    }
+
+ private:
+    void check(uint64_t events, simtime_picosec now);
+
+    double _interval; // wall seconds, 0 is off
+    simtime_picosec _started, _endtime; // simulated
+    double (*_done)(void*);
+    void* _data;
+    double _start, _last;
+    uint64_t _last_events;
+    simtime_picosec _last_sim;
+};
+
+#endif
@@ -181,7 +181,7 @@ CompositeQueue::receivePacket(Packet& pkt)
 							//cout << "RTS" << endl;
 
 			    		} else {
-							cout << "Dropped\n";
+							eventlist().out() << "Dropped\n";
 							booted_pkt->flow().logTraffic(*booted_pkt,*this,TrafficLogger::PKT_DROP);
 							booted_pkt->free();
 							if (_logger) _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
@@ -260,7 +260,7 @@ CompositeQueue::receivePacket(Packet& pkt)
 		} else {
 		    if (_logger) _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
 		    pkt.flow().logTraffic(pkt,*this,TrafficLogger::PKT_DROP);
-		    cout << "B[ " << _enqueued_low.size() << " " << _enqueued_high.size() << " ] DROP " 
+		    eventlist().out() << "B[ " << _enqueued_low.size() << " " << _enqueued_high.size() << " ] DROP " 
 		    	 << pkt.flow().id << endl;
 		    pkt.free();
 		    _num_drops++;
@@ -3,13 +3,39 @@
 #include "config.h"
 #include "tcppacket.h"
 
+thread_local unsigned short* rand_stream = NULL;
+static uint32_t stream_seed = 0;
+
+void seed_streams(uint32_t seed) {
+    stream_seed = seed;
+}
+
+void init_stream(unsigned short* stream, uint32_t id) {
+    // splitmix64 of (seed, id), so neighbouring sources get unrelated streams
+    uint64_t z = ((uint64_t)stream_seed << 32) + (uint64_t)id * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    stream[0] = z;
+    stream[1] = z >> 16;
+    stream[2] = z >> 32;
+}
+
 double drand() {
+    if (rand_stream)
+	return erand48(rand_stream);
     int r=rand();
     int m=RAND_MAX;
     double d = (double)r/(double)m;
     return d;
 }
 
+long lrand() {
+    if (rand_stream)
+	return nrand48(rand_stream);
+    return random();
+}
+
 int pareto(int xm, int mean){
     double oneoveralpha = ((double)mean-xm)/mean;
     return (int)((double)xm/pow(drand(),oneoveralpha));
@@ -10,6 +10,15 @@
 #include <string>
 
 double drand();
+long lrand(); // random(), or the running event source's stream
+
+// erand48() state of the event source whose event is running on this thread. Every
+// source draws from its own stream, so a run draws the same numbers whatever thread
+// or order its sources run in. NULL before the first event (set-up), where drand()
+// and lrand() use the libc generators.
+extern thread_local unsigned short* rand_stream;
+void seed_streams(uint32_t seed); // before the event sources are built
+void init_stream(unsigned short* stream, uint32_t id); // from the seed and the source's id
 
 
 #ifdef _WIN32
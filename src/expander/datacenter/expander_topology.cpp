@@ -22,11 +22,13 @@ extern uint32_t RTT_net;
 string ntoa(double n);
 string itoa(uint64_t n);
 
-ExpanderTopology::ExpanderTopology(mem_b queuesize, Logfile* lg, EventList* ev,queue_type q, string topfile){
+ExpanderTopology::ExpanderTopology(mem_b queuesize, Logfile* lg, EventList* ev,queue_type q, string topfile,
+                                   ParallelSim* pdes){
     _queuesize = queuesize;
     logfile = lg;
     eventlist = ev;
     qt = q;
+    _pdes = pdes;
 
     read_params(topfile);
  
@@ -111,21 +113,30 @@ void ExpanderTopology::set_params() {
 
     pipes_tor_tor.resize(_ntor, vector<Pipe*>(_ntor)); // tors to tors
     queues_tor_tor.resize(_ntor, vector<Queue*>(_ntor));
+
+    _rack_eventlist.resize(_ntor, eventlist);
+    _rack_lp.resize(_ntor, -1);
+    if (_pdes) {
+      for (int j = 0; j < _ntor; j++) {
+        _rack_lp[j] = _pdes->add_lp();
+        _rack_eventlist[j] = &_pdes->lp_eventlist(_rack_lp[j]);
+      }
+    }
 }
 
-Queue* ExpanderTopology::alloc_src_queue(QueueLogger* queueLogger) {
-    return  new PriorityQueue(speedFromMbps((uint64_t)HOST_NIC), memFromPkt(FEEDER_BUFFER), *eventlist, queueLogger);
+Queue* ExpanderTopology::alloc_src_queue(EventList& ev, QueueLogger* queueLogger) {
+    return  new PriorityQueue(speedFromMbps((uint64_t)HOST_NIC), memFromPkt(FEEDER_BUFFER), ev, queueLogger);
 }
 
-Queue* ExpanderTopology::alloc_queue(QueueLogger* queueLogger, mem_b queuesize) {
-    return alloc_queue(queueLogger, HOST_NIC, queuesize);
+Queue* ExpanderTopology::alloc_queue(EventList& ev, QueueLogger* queueLogger, mem_b queuesize) {
+    return alloc_queue(ev, queueLogger, HOST_NIC, queuesize);
 }
 
-Queue* ExpanderTopology::alloc_queue(QueueLogger* queueLogger, uint64_t speed, mem_b queuesize) {
+Queue* ExpanderTopology::alloc_queue(EventList& ev, QueueLogger* queueLogger, uint64_t speed, mem_b queuesize) {
     if (qt==RANDOM)
-      return new RandomQueue(speedFromMbps(speed), memFromPkt(SWITCH_BUFFER + RANDOM_BUFFER), *eventlist, queueLogger, memFromPkt(RANDOM_BUFFER));
+      return new RandomQueue(speedFromMbps(speed), memFromPkt(SWITCH_BUFFER + RANDOM_BUFFER), ev, queueLogger, memFromPkt(RANDOM_BUFFER));
     else if (qt==COMPOSITE)
-      return new CompositeQueue(speedFromMbps(speed), queuesize, *eventlist, queueLogger);
+      return new CompositeQueue(speedFromMbps(speed), queuesize, ev, queueLogger);
     assert(0);
 }
 
@@ -149,12 +160,12 @@ void ExpanderTopology::init_network() {
       int k = j * _ndl + l;
 
       // Downlink: ToR to server
-      queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
+      queueLogger = new QueueLoggerSampling(timeFromMs(1000), rack_eventlist(j));
       logfile->addLogger(*queueLogger);
-      queues_tor_serv[j][k] = alloc_queue(queueLogger, _queuesize);
+      queues_tor_serv[j][k] = alloc_queue(rack_eventlist(j), queueLogger, _queuesize);
       //queues_tor_serv[j][k]->setName("TOR" + ntoa(j) + "->DST" +ntoa(k));
       //logfile->writeName(*(queues_tor_serv[j][k]));
-      pipes_tor_serv[j][k] = new Pipe(timeFromNs(RTT_rack), *eventlist);
+      pipes_tor_serv[j][k] = new Pipe(timeFromNs(RTT_rack), rack_eventlist(j));
       pipes_tor_serv[j][k]->setlongname("Pipe-TOR" + ntoa(j)  + "->DST" + ntoa(k));
       //pipes_tor_serv[j][k]->setName("Pipe-TOR" + ntoa(j)  + "->DST" + ntoa(k));
       //logfile->writeName(*(pipes_tor_serv[j][k]));
@@ -164,12 +175,12 @@ void ExpanderTopology::init_network() {
 
 	  
       // Uplink: server to ToR
-      queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
+      queueLogger = new QueueLoggerSampling(timeFromMs(1000), rack_eventlist(j));
       logfile->addLogger(*queueLogger);
-      queues_serv_tor[k][j] = alloc_src_queue(queueLogger);
+      queues_serv_tor[k][j] = alloc_src_queue(rack_eventlist(j), queueLogger);
       //queues_serv_tor[k][j]->setName("SRC" + ntoa(k) + "->TOR" +ntoa(j));
       //logfile->writeName(*(queues_serv_tor[k][j]));
-      pipes_serv_tor[k][j] = new Pipe(timeFromNs(RTT_rack), *eventlist);
+      pipes_serv_tor[k][j] = new Pipe(timeFromNs(RTT_rack), rack_eventlist(j));
       pipes_serv_tor[k][j]->setlongname("Pipe-SRC" + ntoa(k) + "->TOR" + ntoa(j));
       //pipes_serv_tor[k][j]->setName("Pipe-SRC" + ntoa(k) + "->TOR" + ntoa(j));
       //logfile->writeName(*(pipes_serv_tor[k][j]));
@@ -192,12 +203,18 @@ void ExpanderTopology::init_network() {
       if (_adjacency[j][k] == 1){
 
         // add pipe and queue
-        queueLogger = new QueueLoggerSampling(timeFromMs(1000), *eventlist);
+        queueLogger = new QueueLoggerSampling(timeFromMs(1000), rack_eventlist(j));
         logfile->addLogger(*queueLogger);
-        queues_tor_tor[j][k] = alloc_queue(queueLogger, _queuesize);
+        queues_tor_tor[j][k] = alloc_queue(rack_eventlist(j), queueLogger, _queuesize);
         //queues_tor_tor[j][k]->setName("TOR" + ntoa(j) + "->TOR" +ntoa(k));
         //logfile->writeName(*(queues_tor_tor[j][k]));
-        pipes_tor_tor[j][k] = new Pipe(timeFromNs(RTT_net), *eventlist);
+        if (_pdes) {
+          // the only links between racks: ToR j sends, ToR k's process receives
+          BoundaryPipe* pipe = new BoundaryPipe(timeFromNs(RTT_net), rack_eventlist(k), rack_eventlist(j));
+          _pdes->add_boundary(pipe, _rack_lp[k]);
+          pipes_tor_tor[j][k] = pipe;
+        } else
+          pipes_tor_tor[j][k] = new Pipe(timeFromNs(RTT_net), *eventlist);
         pipes_tor_tor[j][k]->setlongname("Pipe-TOR" + ntoa(j)  + "->ToR" + ntoa(k));
         //pipes_tor_tor[j][k]->setName("Pipe-TOR" + ntoa(j)  + "->ToR" + ntoa(k));
         //logfile->writeName(*(pipes_tor_tor[j][k]));
@@ -10,6 +10,7 @@
 #include "topology.h"
 #include "logfile.h"
 #include "eventlist.h"
+#include "pdes.h"
 //#include "switch.h" // don't need this unless we do lossless protocol
 #include <ostream>
 
@@ -40,16 +41,21 @@ class ExpanderTopology: public Topology{
   int failed_links;
   queue_type qt;
 
-  ExpanderTopology(mem_b queuesize, Logfile* log, EventList* ev, queue_type q, string topfile);
+  // with pdes, every rack (ToR and its hosts) is a logical process of its own
+  ExpanderTopology(mem_b queuesize, Logfile* log, EventList* ev, queue_type q, string topfile,
+                   ParallelSim* pdes = NULL);
+
+  EventList& rack_eventlist(int tor) {return *_rack_eventlist[tor];}
+  EventList& host_eventlist(int host) {return *_rack_eventlist[host / _ndl];}
 
   void init_network();
   virtual vector<const Route*>* get_paths(int src, int dest, bool vlb);
 
   int get_num_shortest_paths(int src, int dest);
 
-  Queue* alloc_src_queue(QueueLogger* q);
-  Queue* alloc_queue(QueueLogger* q, mem_b queuesize);
-  Queue* alloc_queue(QueueLogger* q, uint64_t speed, mem_b queuesize);
+  Queue* alloc_src_queue(EventList& ev, QueueLogger* q);
+  Queue* alloc_queue(EventList& ev, QueueLogger* q, mem_b queuesize);
+  Queue* alloc_queue(EventList& ev, QueueLogger* q, uint64_t speed, mem_b queuesize);
 
   void count_queue(Queue*);
   vector<int>* get_neighbours(int src) {return NULL;};
@@ -67,6 +73,9 @@ class ExpanderTopology: public Topology{
   void set_params();
   int _ndl, _nul, _ntor, _no_of_nodes; // number down links, number uplinks, number ToRs, number servers
   mem_b _queuesize; // queue sizes
+  ParallelSim* _pdes;
+  vector<EventList*> _rack_eventlist;
+  vector<int> _rack_lp;
 };
 
 
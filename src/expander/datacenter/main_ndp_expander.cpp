@@ -23,6 +23,8 @@
 
 // Choose the topology here:
 #include "expander_topology.h"
+#include "event_profile.h"
+#include "run_stats.h"
 
 #include <list>
 
@@ -79,6 +81,11 @@ int main(int argc, char **argv) {
     double simtime; // seconds
     double utiltime = .01; // seconds
     int VLB; // use VLB routing (for large flows) ? (input as a flag)
+    int threads = 0; // > 0: one logical process per rack, run on this many threads
+    double progress_secs = 0; // -progress: a Progress line on stderr this often, wall seconds
+#ifdef EVENT_PROFILE
+    double profile_bucket = 0; // us, -profile: events per EventSource class, and per bucket this long
+#endif
 
     int i = 1;
     filename << "logout.dat";
@@ -125,12 +132,37 @@ int main(int argc, char **argv) {
     } else if (!strcmp(argv[i],"-utiltime")) {
         utiltime = atof(argv[i+1]);
         i++;
+    } else if (!strcmp(argv[i],"-threads")) {
+        threads = atoi(argv[i+1]);
+        i++;
+    } else if (!strcmp(argv[i],"-progress")) {
+        progress_secs = atof(argv[i+1]);
+        i++;
+    } else if (!strcmp(argv[i],"-profile")) {
+#ifdef EVENT_PROFILE
+        profile_bucket = atof(argv[i+1]);
+#else
+        cerr << "-profile needs a build with EVENT_PROFILE=1" << endl;
+        exit(1);
+#endif
+        i++;
 	} else {
 	    exit_error(argv[0]);
 	}
 	i++;
     }
+    if (progress_secs > 0 && threads > 0) {
+        cerr << "-progress only reports on the sequential run" << endl;
+        exit(1);
+    }
+#ifdef EVENT_PROFILE
+    if (profile_bucket > 0 && threads > 0) {
+        cerr << "-profile only sees the sequential run, each logical process has its own eventlist" << endl;
+        exit(1);
+    }
+#endif
     srand(13);
+    seed_streams(13);
 
     eventlist.setEndtime(timeFromSec(simtime));
     Clock c(timeFromSec(5 / 100.), eventlist);
@@ -172,9 +204,14 @@ int main(int argc, char **argv) {
 
     NdpRtxTimerScanner ndpRtxScanner(timeFromMs(1), eventlist);
 
+    // the scanner, loggers and UtilMonitor stay on eventlist either way
+    ParallelSim* pdes = NULL;
+    if (threads > 0)
+        pdes = new ParallelSim(eventlist);
+
 // this creates the Expander topology
 #ifdef EXPANDER
-    ExpanderTopology* top = new ExpanderTopology(queuesize, &logfile, &eventlist, COMPOSITE, topfile);
+    ExpanderTopology* top = new ExpanderTopology(queuesize, &logfile, &eventlist, COMPOSITE, topfile, pdes);
 #endif
 
 	// initialize all sources/sinks
@@ -200,10 +237,10 @@ int main(int argc, char **argv) {
             int flow_src = vtemp[0];
             int flow_dst = vtemp[1];
 
-            NdpSrc* flowSrc = new NdpSrc(NULL, NULL, eventlist, flow_src, flow_dst);
+            NdpSrc* flowSrc = new NdpSrc(NULL, NULL, top->host_eventlist(flow_src), flow_src, flow_dst);
             flowSrc->setCwnd(cwnd*Packet::data_packet_size());
             flowSrc->set_flowsize(vtemp[2]); // bytes
-            NdpPullPacer* flowpacer = new NdpPullPacer(eventlist, pull_rate); // 1 = pull at line rate   
+            NdpPullPacer* flowpacer = new NdpPullPacer(top->host_eventlist(flow_dst), pull_rate); // 1 = pull at line rate   
             NdpSink* flowSnk = new NdpSink(flowpacer);
             ndpRtxScanner.registerNdp(*flowSrc);
             Route* routeout, *routein;
@@ -256,7 +293,35 @@ int main(int argc, char **argv) {
     logfile.write("# corelinkrate = " + ntoa(HOST_NIC*CORE_TO_HOST) + " pkt/sec");
 
     // GO!
-    while (eventlist.doNextEvent()) {}
+    if (pdes) {
+        RunStats runstats;
+        runstats.started();
+        pdes->run(threads);
+        pdes->print_stats(cerr);
+        runstats.print(cerr, pdes->events(), pdes->now());
+    } else {
+#ifdef EVENT_PROFILE
+        EventProfiler* profiler = NULL;
+        if (profile_bucket > 0) {
+            profiler = new EventProfiler(timeFromUs(profile_bucket));
+            eventlist.setProfiler(profiler);
+        }
+#endif
+        RunStats runstats;
+        runstats.started();
+        uint64_t nevents = 0;
+        Progress progress;
+        progress.start(progress_secs, eventlist.now(), timeFromSec(simtime));
+        while (eventlist.doNextEvent())
+            progress.poll(++nevents, eventlist.now());
+        runstats.print(cerr, nevents, eventlist.now());
+#ifdef EVENT_PROFILE
+        if (profiler)
+            profiler->report(cout);
+#endif
+    }
+    if (NdpSrc::_global_rto_count > 0)
+        cout << "Total RTOs: " << NdpSrc::_global_rto_count << endl;
 
 }
 
@@ -1,11 +1,18 @@
 // -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-        
 
 #include "eventlist.h"
+#ifdef EVENT_PROFILE
+#include "event_profile.h"
+#endif
 //#include <iostream>
 
 EventList::EventList()
     : _endtime(0),
-      _lasteventtime(0)
+      _lasteventtime(0),
+      _out(&cout)
+#ifdef EVENT_PROFILE
+      , _profiler(NULL)
+#endif
 {
 }
 
@@ -20,11 +27,18 @@ EventList::doNextEvent()
 {
     if (_pendingsources.empty())
 	return false;
-    simtime_picosec nexteventtime = _pendingsources.begin()->first;
+    simtime_picosec nexteventtime = _pendingsources.begin()->first.first;
     EventSource* nextsource = _pendingsources.begin()->second;
     _pendingsources.erase(_pendingsources.begin());
     assert(nexteventtime >= _lasteventtime);
     _lasteventtime = nexteventtime; // set this before calling doNextEvent, so that this::now() is accurate
+    rand_stream = nextsource->_rng;
+#ifdef EVENT_PROFILE
+    if (_profiler) {
+	_profiler->run(*nextsource, nexteventtime);
+	return true;
+    }
+#endif
     nextsource->doNextEvent();
     return true;
 }
@@ -44,7 +58,7 @@ EventList::sourceIsPending(EventSource &src, simtime_picosec when)
     
     assert(when>=now());
     if (_endtime==0 || when<_endtime)
-	_pendingsources.insert(make_pair(when,&src));
+	_pendingsources.insert(make_pair(eventkey_t(when, src.id),&src));
 }
 
 void 
@@ -2,20 +2,27 @@
 #define EVENTLIST_H
 
 #include <map>
+#include <iostream>
 #include <sys/time.h>
 #include "config.h"
 #include "loggertypes.h"
 
 class EventList;
+#ifdef EVENT_PROFILE
+class EventProfiler;
+#endif
 
 class EventSource : public Logged {
+	friend class EventList;
 	public:
-		EventSource(EventList& eventlist, const string& name) : Logged(name), _eventlist(eventlist) {};
+		EventSource(EventList& eventlist, const string& name) : Logged(name), _eventlist(eventlist) {init_stream(_rng, id);};
 		virtual ~EventSource() {};
 		virtual void doNextEvent() = 0;
 		inline EventList& eventlist() const {return _eventlist;}
 	protected:
 		EventList& _eventlist;
+	private:
+		unsigned short _rng[3]; // drand()/lrand() while this source's events run
 	};
 
 class EventList {
@@ -29,11 +36,34 @@ public:
     void cancelPendingSource(EventSource &src);
     void reschedulePendingSource(EventSource &src, simtime_picosec when);
     inline simtime_picosec now() const {return _lasteventtime;}
+#ifdef EVENT_PROFILE
+    void setProfiler(EventProfiler* profiler) {_profiler = profiler;} // NULL: don't profile
+#endif
+    simtime_picosec endtime() const {return _endtime;}
+
+    // Events at the same time run in source id (construction) order, not in the order
+    // they were scheduled. A parallel run schedules arrivals from other racks later than
+    // a serial run does, and must still run them in the same order.
+    typedef pair<simtime_picosec, Logged::id_t> eventkey_t;
+
+    // for the parallel engine (pdes.h), which runs many eventlists in windows
+    bool havePending() const {return !_pendingsources.empty();}
+    simtime_picosec nextEventTime() const {return _pendingsources.begin()->first.first;}
+    eventkey_t nextEventKey() const {return _pendingsources.begin()->first;}
+    void advanceTo(simtime_picosec when) {assert(when >= _lasteventtime); _lasteventtime = when;}
+
+    // where sources print results; a buffer per logical process in parallel runs
+    ostream& out() const {return *_out;}
+    void setOut(ostream* out) {_out = out;}
 private:
     simtime_picosec _endtime;
     simtime_picosec _lasteventtime;
-    typedef multimap <simtime_picosec, EventSource*> pendingsources_t;
+    typedef multimap <eventkey_t, EventSource*> pendingsources_t;
     pendingsources_t _pendingsources;
+#ifdef EVENT_PROFILE
+    EventProfiler* _profiler;
+#endif
+    ostream* _out;
 };
 
 #endif
@@ -160,6 +160,7 @@ void NdpSrc::set_paths(vector<const Route*>* rt_list){
 }
 
 void NdpSrc::startflow(){
+    live_counts.flows_started++;
     _highest_sent = 0;
     _last_acked = 0;
     
@@ -296,10 +297,10 @@ bool NdpSrc::is_bad_path() {
 
     
     if (ack_count > 0 && total/ack_count <= 3) {
-	   printf("total: %d ack: %d nack:%d rts: %d, BAD\n", total, ack_count, nack_count, bounce_count);
+	   eventlist().out() << "total: " << total << " ack: " << ack_count << " nack:" << nack_count << " rts: " << bounce_count << ", BAD\n";
 	   return true;
     }
-        printf("total: %d ack: %d nack:%d rts: %d, NOT BAD\n", total, ack_count, nack_count, bounce_count);
+        eventlist().out() << "total: " << total << " ack: " << ack_count << " nack:" << nack_count << " rts: " << bounce_count << ", NOT BAD\n";
     
 
     // NDP can get confused in an expander when there's congestion...
@@ -459,7 +460,8 @@ void NdpSrc::processAck(const NdpAck& ack) {
         //cout << "flowID " << get_id() << " bytes " << get_flowsize() << " FCT_ms " << timeAsMs(eventlist().now() - get_start_time()) << endl;
     
         // FCT output for processing: (src dst bytes fct_ms timestarted_ms)
-        cout << "FCT " << get_flow_src() << " " << get_flow_dst() << " " << get_flowsize() <<
+        live_counts.flows_done++;
+        eventlist().out() << "FCT " << get_flow_src() << " " << get_flow_dst() << " " << get_flowsize() <<
             " " << timeAsMs(eventlist().now() - get_start_time()) << " " << timeAsMs(get_start_time()) << endl;
 
     }
@@ -560,11 +562,11 @@ const Route* NdpSrc::choose_route() {
 	_avoid_score[path_id] = _avoid_ratio[path_id];
 	int ctr = 0;
 	while (_avoid_score[path_id] > 0 ) {
-	    printf("as[%d]: %d\n", path_id, _avoid_score[path_id]);
+	    eventlist().out() << "as[" << path_id << "]: " << _avoid_score[path_id] << "\n";
 	    _avoid_score[path_id]--;
 	    ctr++;
 	    //re-choosing path
-	    cout << "re-choosing path " << path_id << endl;
+	    eventlist().out() << "re-choosing path " << path_id << endl;
 	    _crt_path++;
 	    if (_crt_path == _paths.size()) {
 		//permute_paths();
@@ -581,7 +583,7 @@ const Route* NdpSrc::choose_route() {
     case SCATTER_RANDOM:
 		//ECMP + VLB if flow is larger than threshold
 		assert(_paths.size() > 0);
-        _crt_path = random()%_num_shortest_paths; // choose from amongst the shortest paths
+        _crt_path = lrand()%_num_shortest_paths; // choose from amongst the shortest paths
         if (_vlb) {
             
             while (_crt_path < _num_shortest_paths) {
@@ -592,7 +594,7 @@ const Route* NdpSrc::choose_route() {
                 //        ", _crt_path = " << _crt_path << ", _num_shortest_paths = " << _num_shortest_paths << endl;
                 //}
 
-                _crt_path = random()%_paths.size(); // randomly pick a path from the set of VLB paths
+                _crt_path = lrand()%_paths.size(); // randomly pick a path from the set of VLB paths
 
             }
         }
@@ -742,7 +744,7 @@ void NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
 void NdpSrc::permute_paths() {
     int len = _paths.size();
     for (int i = 0; i < len; i++) {
-	int ix = random() % (len - i);
+	int ix = lrand() % (len - i);
 	const Route* tmppath = _paths[ix];
 	_paths[ix] = _paths[len-1-i];
 	_paths[len-1-i] = tmppath;
@@ -825,10 +827,10 @@ NdpSrc::retransmit_packet() {
 
 	    if (_route_strategy == SCATTER_RANDOM) {
 
-            _crt_path = random()%_num_shortest_paths; // choose from amongst the shortest paths
+            _crt_path = lrand()%_num_shortest_paths; // choose from amongst the shortest paths
             if (_vlb) {
                 while (_crt_path < _num_shortest_paths)
-                    _crt_path = random()%_paths.size(); // randomly pick a path from the set of VLB paths
+                    _crt_path = lrand()%_paths.size(); // randomly pick a path from the set of VLB paths
             }
             break;
 
@@ -855,8 +857,9 @@ NdpSrc::retransmit_packet() {
 	// 	if (_log_me) {
 	//cout << "Sent " << seqno << " RTx" << " flow id " << p->flow().id << endl;
 	// 	}
-	_global_rto_count++;
-	cout << "Total RTOs: " << _global_rto_count << endl;
+	// shared by the logical processes of a parallel run, where a running count
+	// would depend on how they interleave: the total is printed at the end
+	__atomic_add_fetch(&_global_rto_count, 1, __ATOMIC_RELAXED);
 	_path_counts_rto[p->path_id()]++;
 	p->sendOn();
 	_packets_sent++;
@@ -904,9 +907,9 @@ void NdpSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
 void NdpSrc::log_rtt(simtime_picosec sent_time) {
     int64_t rtt = eventlist().now() - sent_time;
     if (rtt >= 0) 
-	_rtt_hist[(int)timeAsUs(rtt)]++;
+	__atomic_add_fetch(&_rtt_hist[(int)timeAsUs(rtt)], 1, __ATOMIC_RELAXED); // shared by the logical processes of a parallel run
     else
-	cout << "Negative RTT: " << rtt << endl;
+	eventlist().out() << "Negative RTT: " << rtt << endl;
 }
 
 void NdpSrc::doNextEvent() {
@@ -1191,11 +1194,11 @@ void NdpSink::send_ack(simtime_picosec ts, NdpPacket::seq_t ackno, NdpPacket::se
 
 	if (_route_strategy == SCATTER_RANDOM) {
 
-	    _crt_path = random()%_num_shortest_paths; // choose from amongst the shortest paths
+	    _crt_path = lrand()%_num_shortest_paths; // choose from amongst the shortest paths
         // always send ACKs / NACKs back on the short paths...
         //if (_src->isvlb()) {
         //    while (_crt_path < _num_shortest_paths)
-        //        _crt_path = random()%_paths.size(); // randomly pick a path from the set of VLB paths
+        //        _crt_path = lrand()%_paths.size(); // randomly pick a path from the set of VLB paths
         //}
 
 	} else {
@@ -1234,10 +1237,10 @@ void NdpSink::send_nack(simtime_picosec ts, NdpPacket::seq_t ackno, NdpPacket::s
 
 	if (_route_strategy == SCATTER_RANDOM) {
 
-		_crt_path = random()%_num_shortest_paths; // choose from amongst the shortest paths
+		_crt_path = lrand()%_num_shortest_paths; // choose from amongst the shortest paths
         //if (_src->isvlb()) {
         //    while (_crt_path < _num_shortest_paths)
-        //       _crt_path = random()%_paths.size(); // randomly pick a path from the set of VLB paths
+        //       _crt_path = lrand()%_paths.size(); // randomly pick a path from the set of VLB paths
         //}
         
 	} else {
@@ -1265,7 +1268,7 @@ void NdpSink::send_nack(simtime_picosec ts, NdpPacket::seq_t ackno, NdpPacket::s
 void NdpSink::permute_paths() {
     int len = _paths.size();
     for (int i = 0; i < len; i++) {
-	int ix = random() % (len - i);
+	int ix = lrand() % (len - i);
 	const Route* tmppath = _paths[ix];
 	_paths[ix] = _paths[len-1-i];
 	_paths[len-1-i] = tmppath;
@@ -1,6 +1,6 @@
 #include "ndppacket.h"
 
-PacketDB<NdpPacket> NdpPacket::_packetdb;
-PacketDB<NdpAck> NdpAck::_packetdb;
-PacketDB<NdpNack> NdpNack::_packetdb;
-PacketDB<NdpPull> NdpPull::_packetdb;
+thread_local PacketDB<NdpPacket> NdpPacket::_packetdb;
+thread_local PacketDB<NdpAck> NdpAck::_packetdb;
+thread_local PacketDB<NdpNack> NdpNack::_packetdb;
+thread_local PacketDB<NdpPull> NdpPull::_packetdb;
@@ -82,7 +82,7 @@ class NdpPacket : public Packet {
 			    // simulation, and this is easiest to
 			    // implement
     bool _last_packet;  // set to true in the last packet in a flow.
-    static PacketDB<NdpPacket> _packetdb;
+    static thread_local PacketDB<NdpPacket> _packetdb; // per thread in parallel runs
 };
 
 class NdpAck : public Packet {
@@ -129,7 +129,7 @@ class NdpAck : public Packet {
     bool _pull;
     seq_t _pullno;
     int32_t _path_id; //see comment in NdpPull
-    static PacketDB<NdpAck> _packetdb;
+    static thread_local PacketDB<NdpAck> _packetdb;
 };
 
 
@@ -178,7 +178,7 @@ class NdpNack : public Packet {
     bool _pull;
     seq_t _pullno;
     int32_t _path_id;
-    static PacketDB<NdpNack> _packetdb;
+    static thread_local PacketDB<NdpNack> _packetdb;
 };
 
 class NdpPull : public Packet {
@@ -233,7 +233,7 @@ class NdpPull : public Packet {
     seq_t _cumulative_ack;
     seq_t _pullno;
     int32_t _path_id; // indicates ??
-    static PacketDB<NdpPull> _packetdb;
+    static thread_local PacketDB<NdpPull> _packetdb;
 };
 
 #endif
@@ -6,6 +6,7 @@
 #include <iostream>
 #include "config.h"
 #include "loggertypes.h"
+#include "run_stats.h"
 #include "route.h"
 
 class Packet;
@@ -152,6 +153,7 @@ template<class P>
 class PacketDB {
  public:
     P* allocPacket() {
+	live_counts.packets++;
 	if (_freelist.empty()) {
 	    return new P();
 	} else {
@@ -161,6 +163,7 @@ class PacketDB {
 	}
     };
     void freePacket(P* pkt) {
+	live_counts.packets--;
 	_freelist.push_back(pkt);
     };
 
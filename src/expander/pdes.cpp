@@ -0,0 +1,202 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#include "pdes.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+BoundaryPipe::BoundaryPipe(simtime_picosec delay, EventList& eventlist, EventList& from)
+    : Pipe(delay, eventlist), _from(from)
+{
+}
+
+void BoundaryPipe::receivePacket(Packet& pkt)
+{
+    pkt.flow().logTraffic(pkt,*this,TrafficLogger::PKT_ARRIVE);
+    _outbox.push_back(make_pair(_from.now() + _delay, &pkt));
+}
+
+void BoundaryPipe::flush()
+{
+    for (size_t i = 0; i < _outbox.size(); i++) {
+	// same as Pipe::receivePacket, only later
+	if (_inflight.empty())
+	    eventlist().sourceIsPending(*this, _outbox[i].first);
+	_inflight.push_front(_outbox[i]);
+    }
+    _outbox.clear();
+}
+
+ParallelSim::ParallelSim(EventList& global)
+    : _global(global), _lookahead(~(simtime_picosec)0),
+      _nthreads(1), _window_end(0, 0), _done(false), _waiting(0), _generation(0),
+      _nwindows(0), _nglobal(0)
+{
+}
+
+ParallelSim::~ParallelSim()
+{
+    for (size_t i = 0; i < _lps.size(); i++)
+	delete _lps[i];
+}
+
+int ParallelSim::add_lp()
+{
+    lp_t* lp = new lp_t();
+    lp->events = 0;
+    int n = _lps.size();
+    lp->ev.setEndtime(_global.endtime());
+    lp->ev.setOut(&lp->out);
+    _lps.push_back(lp);
+    return n;
+}
+
+void ParallelSim::add_boundary(BoundaryPipe* pipe, int to_lp)
+{
+    assert(pipe->delay() > 0); // no lookahead, no parallelism
+    _lps[to_lp]->inbound.push_back(pipe);
+    _lookahead = min(_lookahead, pipe->delay());
+}
+
+void ParallelSim::run(int nthreads)
+{
+    _nthreads = max(1, min(nthreads, (int)_lps.size()));
+    _done = false;
+
+    vector<std::thread> threads;
+    for (int t = 1; t < _nthreads; t++)
+	threads.push_back(std::thread(&ParallelSim::worker, this, t));
+    worker(0);
+    for (size_t t = 0; t < threads.size(); t++)
+	threads[t].join();
+}
+
+void ParallelSim::worker(int t)
+{
+    // a contiguous block of LPs per thread
+    int first = t * _lps.size() / _nthreads;
+    int last = (t + 1) * _lps.size() / _nthreads;
+
+    while (true) {
+	if (t == 0)
+	    _done = !next_window();
+	barrier();
+	if (_done)
+	    return;
+
+	for (int i = first; i < last; i++)
+	    run_window(i);
+	barrier();
+
+	for (int i = first; i < last; i++) {
+	    vector<BoundaryPipe*>& in = _lps[i]->inbound;
+	    for (size_t p = 0; p < in.size(); p++)
+		in[p]->flush();
+	}
+	barrier();
+    }
+}
+
+void ParallelSim::run_window(int i)
+{
+    lp_t& lp = *_lps[i];
+    lp.out.flags(_global.out().flags()); // formatted as if it went straight to cout
+    lp.out.precision(_global.out().precision());
+    while (lp.ev.havePending() && lp.ev.nextEventKey() < _window_end) {
+	EventList::eventkey_t when = lp.ev.nextEventKey();
+	lp.ev.doNextEvent();
+	lp.events++;
+	if (lp.out.tellp() > 0) {
+	    line_t line = {when, lp.out.str()};
+	    lp.lines.push_back(line);
+	    lp.out.str("");
+	}
+    }
+}
+
+bool ParallelSim::next_window()
+{
+    // print what the LPs said in the last window, in time order
+    vector<line_t> lines;
+    for (size_t i = 0; i < _lps.size(); i++) {
+	lines.insert(lines.end(), _lps[i]->lines.begin(), _lps[i]->lines.end());
+	_lps[i]->lines.clear();
+    }
+    stable_sort(lines.begin(), lines.end());
+    for (size_t i = 0; i < lines.size(); i++)
+	_global.out() << lines[i].text;
+
+    while (true) {
+	bool pending = false;
+	EventList::eventkey_t next(0, 0);
+	for (size_t i = 0; i < _lps.size(); i++) {
+	    EventList& ev = _lps[i]->ev;
+	    if (ev.havePending() && (!pending || ev.nextEventKey() < next)) {
+		next = ev.nextEventKey();
+		pending = true;
+	    }
+	}
+
+	// every LP is done with everything before a global event when it runs
+	if (_global.havePending() && (!pending || _global.nextEventKey() < next)) {
+	    simtime_picosec when = _global.nextEventTime();
+	    for (size_t i = 0; i < _lps.size(); i++) {
+		_lps[i]->ev.advanceTo(when);
+		_lps[i]->ev.setOut(&_global.out()); // the LPs' sources it calls print in place
+	    }
+	    _global.doNextEvent();
+	    for (size_t i = 0; i < _lps.size(); i++)
+		_lps[i]->ev.setOut(&_lps[i]->out);
+	    _nglobal++;
+	    continue;
+	}
+	if (!pending)
+	    return false;
+
+	// ids start at 1: nothing at next + lookahead itself runs in this window
+	simtime_picosec end = next.first + _lookahead < next.first ? ~(simtime_picosec)0 : next.first + _lookahead;
+	_window_end = EventList::eventkey_t(end, 0);
+	if (_global.havePending())
+	    _window_end = min(_window_end, _global.nextEventKey());
+	_nwindows++;
+	return true;
+    }
+}
+
+void ParallelSim::barrier()
+{
+    if (_nthreads == 1)
+	return;
+    int gen = _generation.load(std::memory_order_acquire);
+    if (_waiting.fetch_add(1, std::memory_order_acq_rel) == _nthreads - 1) {
+	_waiting.store(0, std::memory_order_relaxed);
+	_generation.fetch_add(1, std::memory_order_release);
+	return;
+    }
+    // windows are short, so spin for a while before giving the core away
+    for (int spins = 0; _generation.load(std::memory_order_acquire) == gen; spins++)
+	if (spins > 1000)
+	    std::this_thread::yield();
+}
+
+uint64_t ParallelSim::events() const
+{
+    uint64_t n = _nglobal;
+    for (size_t i = 0; i < _lps.size(); i++)
+	n += _lps[i]->events;
+    return n;
+}
+
+simtime_picosec ParallelSim::now() const
+{
+    simtime_picosec t = _global.now();
+    for (size_t i = 0; i < _lps.size(); i++)
+	t = max(t, _lps[i]->ev.now());
+    return t;
+}
+
+void ParallelSim::print_stats(ostream& out)
+{
+    out << "PDES lps " << _lps.size() << " threads " << _nthreads
+	<< " lookahead_us " << timeAsUs(_lookahead) << " windows " << _nwindows
+	<< " global_events " << _nglobal << endl;
+}
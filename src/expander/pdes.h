@@ -0,0 +1,108 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef PDES_H
+#define PDES_H
+
+/*
+ * Conservative parallel simulation. The network is cut into logical
+ * processes (LPs), each with its own EventList, and the only things that
+ * cross between them are BoundaryPipes. A boundary pipe's delay is the
+ * lookahead: nothing an LP does at time t can reach another LP before
+ * t + lookahead, so all LPs can run [T, T + lookahead) independently, T
+ * being the earliest pending event anywhere (YAWNS-style windows).
+ *
+ * Packets entering a boundary pipe go into its outbox, which only the
+ * sending LP writes during a window and only the receiving LP reads after
+ * it, and are put in flight in a fixed order (pipe, then send order).
+ *
+ * Sources that look at the whole network (the rtx scanner, sink loggers,
+ * the UtilMonitor) stay on the global EventList and run between windows,
+ * when every LP has finished all events before them.
+ *
+ * The run is the same as a serial one, whatever the number of threads:
+ * - every EventList runs equal-time events in source id order, so it
+ *   doesn't matter that an outbox is put in flight later than a serial
+ *   run would schedule the packets (eventlist.h);
+ * - a global event runs between the LP events before and after it in that
+ *   (time, id) order, and what it prints goes straight out;
+ * - every event source draws from its own random stream (config.h);
+ * - each LP prints into its own buffer, and the buffers are merged in
+ *   (time, id) order after each window.
+ *
+ * Logfile records are not serialised: keep the logfile's start time after
+ * the end of a parallel run.
+ */
+
+#include <vector>
+#include <sstream>
+#include <atomic>
+#include "config.h"
+#include "eventlist.h"
+#include "pipe.h"
+
+class ParallelSim;
+
+class BoundaryPipe : public Pipe {
+ public:
+    // lives on the receiving LP's eventlist; from is the sender's
+    BoundaryPipe(simtime_picosec delay, EventList& eventlist, EventList& from);
+    void receivePacket(Packet& pkt);
+
+    // put what arrived during the last window in flight; receiving LP only
+    void flush();
+
+ private:
+    EventList& _from;
+    vector<pktrecord_t> _outbox;
+};
+
+class ParallelSim {
+ public:
+    // global holds the sources that see the whole network; LPs inherit its endtime
+    ParallelSim(EventList& global);
+    ~ParallelSim();
+
+    int add_lp(); // returns the LP's index
+    EventList& lp_eventlist(int lp) { return _lps[lp]->ev; }
+    void add_boundary(BoundaryPipe* pipe, int to_lp);
+
+    // run to the end, with LPs spread over nthreads threads
+    void run(int nthreads);
+    void print_stats(ostream& out);
+    uint64_t events() const; // run so far, LPs' and global
+    simtime_picosec now() const; // of the last event run anywhere
+
+ private:
+    struct line_t {
+	EventList::eventkey_t when; // of the event that printed it
+	string text;
+	bool operator<(const line_t& o) const { return when < o.when; }
+    };
+    struct lp_t {
+	EventList ev;
+	ostringstream out;
+	vector<line_t> lines;
+	vector<BoundaryPipe*> inbound;
+	uint64_t events; // written by its thread only, read between windows
+    };
+
+    void worker(int t);
+    void run_window(int lp);
+    bool next_window(); // thread 0 between windows; false when there's nothing left
+    void barrier();
+
+    EventList& _global;
+    vector<lp_t*> _lps;
+    simtime_picosec _lookahead;
+
+    int _nthreads;
+    vector<simtime_picosec> _thread_next; // earliest pending event on each thread's LPs
+    EventList::eventkey_t _window_end; // LPs run the events before this
+    bool _done;
+
+    std::atomic<int> _waiting;
+    std::atomic<int> _generation;
+
+    uint64_t _nwindows, _nglobal;
+};
+
+#endif
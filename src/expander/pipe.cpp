@@ -50,7 +50,7 @@ void Pipe::doNextEvent() {
         case NDP:
         {
             if (pkt->size() > 64) { // not a header
-                cout << _uplink_pipe_id << " " << timeAsUs(eventlist().now()) << endl;
+                eventlist().out() << _uplink_pipe_id << " " << timeAsUs(eventlist().now()) << endl;
             }
             break;
         }
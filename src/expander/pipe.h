@@ -33,10 +33,11 @@ class Pipe : public EventSource, public PacketSink {
     inline void setlongname(string name) {_longname = name;}
     string _longname;
 
- private:
+ protected:
     simtime_picosec _delay;
     typedef pair<simtime_picosec,Packet*> pktrecord_t;
     list<pktrecord_t> _inflight; // the packets in flight (or being serialized)
+ private:
     string _nodename;
 };
 
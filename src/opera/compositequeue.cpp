@@ -8,17 +8,21 @@
 #include "dynexp_topology.h"
 #include "rlbpacket.h" // added for debugging
 #include "rlbmodule.h"
+#include "sliceclock.h"
+#include "dropcounters.h"
 
 // !!! NOTE: this one does selective RLB packet dropping.
 
 // !!! NOTE: this has been modified to also include a lower priority RLB queue
 
-CompositeQueue::CompositeQueue(linkspeed_bps bitrate, mem_b maxsize, EventList& eventlist, 
+CompositeQueue::CompositeQueue(DynExpTopology* top, linkspeed_bps bitrate, mem_b maxsize, EventList& eventlist, 
 			       QueueLogger* logger, int tor, int port)
   : Queue(bitrate, maxsize, eventlist, logger)
 {
+  _top = top;
   _tor = tor;
   _port = port;
+  _parked = false;
   // original version:
   //_ratio_high = 10; // number of headers to send per data packet (originally 24 for Jan '18 version)
   //_ratio_low = 1; // number of full packets
@@ -41,6 +45,17 @@ CompositeQueue::CompositeQueue(linkspeed_bps bitrate, mem_b maxsize, EventList&
 }
 
 void CompositeQueue::beginService(){
+	if (_port >= _top->no_of_hpr() &&
+		_top->get_nextToR(_top->get_slice_clock()->slice(), _tor, _port) < 0) {
+		// it's a ToR uplink and the rotor switch is down:
+		// hold everything until the next slice boundary instead of sending into a dead link
+		if (!_parked) {
+			_parked = true;
+			_top->get_slice_clock()->wakeup(1, compositequeue_unpark, this);
+		}
+		return;
+	}
+
 	if ( !_enqueued_high.empty() && !_enqueued_low.empty() ){
 
 		if (_crt >= (_ratio_high+_ratio_low))
@@ -114,19 +129,7 @@ void CompositeQueue::completeService() {
 			// check if we're still connected to the right rack:
 
 			// get the current slice:
-			int64_t superslice = (eventlist().now() / top->get_slicetime(3)) %
-                top->get_nsuperslice();
-            // next, get the relative time from the beginning of that superslice
-            int64_t reltime = eventlist().now() - superslice*top->get_slicetime(3) -
-                (eventlist().now() / (top->get_nsuperslice()*top->get_slicetime(3))) * 
-                (top->get_nsuperslice()*top->get_slicetime(3));
-            int slice; // the current slice
-            if (reltime < top->get_slicetime(0))
-                slice = 0 + superslice*3;
-            else if (reltime < top->get_slicetime(0) + top->get_slicetime(1))
-                slice = 1 + superslice*3;
-            else
-                slice = 2 + superslice*3;
+			int slice = top->get_slice_clock()->slice(); // the current slice
 
             bool pktfound = false;
 
@@ -149,6 +152,7 @@ void CompositeQueue::completeService() {
             		// this is an old packet, "drop" it and move on to the next one
 
             		RlbPacket *p = (RlbPacket*)(pkt);
+            		count_drop(QUEUE_RETURN_RLB, pkt);
 
             		// debug:
             		//cout << "X dropped an RLB packet at port " << pkt->get_crtport() << ", seqno:" << p->seqno() << endl;
@@ -214,6 +218,54 @@ void CompositeQueue::doNextEvent() {
 	completeService();
 }
 
+void CompositeQueue::unpark() {
+	_parked = false;
+
+	int nextToR = _top->get_nextToR(_top->get_slice_clock()->slice(), _tor, _port);
+	if (nextToR >= 0) {
+		// the rotor is back, but possibly to another ToR than the one the held packets'
+		// paths were computed for. Before parking, these went into the dead link and
+		// were clipped at the end of the pipe; clip the stale ones here instead.
+		// (stale RLB packets are returned by completeService() already)
+		clip_stale(_enqueued_high, _queuesize_high, nextToR);
+		clip_stale(_enqueued_low, _queuesize_low, nextToR);
+	}
+
+	if (_serv == QUEUE_INVALID &&
+		(!_enqueued_high.empty() || !_enqueued_low.empty() || !_enqueued_rlb.empty()))
+		beginService();
+}
+
+void CompositeQueue::clip_stale(list<Packet*>& queue, mem_b& queuesize, int nextToR) {
+	list<Packet*>::iterator it = queue.begin();
+	while (it != queue.end()) {
+		Packet* pkt = *it;
+		if (_top->get_nextToR(pkt->get_slice_sent(), _tor, _port) == nextToR) {
+			++it;
+			continue;
+		}
+		drop_event_t ev = pkt->type() == NDP ? QUEUE_CLIP_NDP :
+			pkt->type() == NDPACK ? QUEUE_CLIP_NDPACK :
+			pkt->type() == NDPNACK ? QUEUE_CLIP_NDPNACK : QUEUE_CLIP_NDPPULL;
+		count_drop(ev, pkt);
+		queuesize -= pkt->size();
+		it = queue.erase(it);
+		pkt->free();
+	}
+}
+
+void CompositeQueue::count_drop(drop_event_t ev, Packet* pkt) {
+	int slice = _top->get_slice_clock()->slice();
+	DropCounters* drops = _top->get_drop_counters();
+	drops->count(ev, slice, _tor, _port);
+	if (DropCounters::trace_level > 0)
+		drops->trace(ev, slice, pkt, eventlist().now());
+}
+
+void compositequeue_unpark(void* queue, int slice) {
+	((CompositeQueue*)queue)->unpark();
+}
+
 void CompositeQueue::receivePacket(Packet& pkt) {
 
 	// debug:
@@ -294,6 +346,7 @@ void CompositeQueue::receivePacket(Packet& pkt) {
 
 						booted_pkt->strip_payload();
 						_num_stripped++;
+						count_drop(QUEUE_TRIM, booted_pkt);
 						booted_pkt->flow().logTraffic(*booted_pkt,*this,TrafficLogger::PKT_TRIM);
 						if (_logger)
 							_logger->logQueue(*this, QueueLogger::PKT_TRIM, pkt);
@@ -322,6 +375,7 @@ void CompositeQueue::receivePacket(Packet& pkt) {
 								DynExpTopology* top = booted_pkt->get_topology();
 								booted_pkt->bounce(); // indicate that the packet has been bounced
 								_num_bounced++;
+								count_drop(QUEUE_BOUNCE, booted_pkt);
 
 					            // flip the source and dst of the packet:
 					            int s = booted_pkt->get_src();
@@ -347,19 +401,7 @@ void CompositeQueue::receivePacket(Packet& pkt) {
 
 					            	// get paths
 					            	// get the current slice:
-									int64_t superslice = (eventlist().now() / top->get_slicetime(3)) %
-						                top->get_nsuperslice();
-						            // next, get the relative time from the beginning of that superslice
-						            int64_t reltime = eventlist().now() - superslice*top->get_slicetime(3) -
-						                (eventlist().now() / (top->get_nsuperslice()*top->get_slicetime(3))) * 
-						                (top->get_nsuperslice()*top->get_slicetime(3));
-						            int slice; // the current slice
-						            if (reltime < top->get_slicetime(0))
-						                slice = 0 + superslice*3;
-						            else if (reltime < top->get_slicetime(0) + top->get_slicetime(1))
-						                slice = 1 + superslice*3;
-						            else
-						                slice = 2 + superslice*3;
+									int slice = top->get_slice_clock()->slice(); // the current slice
 
 						            booted_pkt->set_slice_sent(slice); // "timestamp" the packet
 						            // get the number of available paths for this packet during this slice
@@ -391,8 +433,8 @@ void CompositeQueue::receivePacket(Packet& pkt) {
 
 
 						    } else {
-						    	// debug:
-								cout << "   ... this is an RTS packet. Dropped.\n";
+						    	// debug (trace level 1):
+								count_drop(QUEUE_DROP_RTS, booted_pkt);
 								//booted_pkt->flow().logTraffic(*booted_pkt,*this,TrafficLogger::PKT_DROP);
 								booted_pkt->free();
 								//if (_logger) _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
@@ -420,12 +462,14 @@ void CompositeQueue::receivePacket(Packet& pkt) {
 					// the packet wouldn't fit if we booted the existing packet
 					pkt.strip_payload();
 					_num_stripped++;
+					count_drop(QUEUE_TRIM, &pkt);
 				}
 
 			} else {
 				//strip payload on the arriving packet - low priority queue is full
 				pkt.strip_payload();
 				_num_stripped++;
+				count_drop(QUEUE_TRIM, &pkt);
 
 				// debug:
 				//if (_tor == 0 && _port == 6)
@@ -461,6 +505,7 @@ void CompositeQueue::receivePacket(Packet& pkt) {
 				DynExpTopology* top = pkt.get_topology();
 	    		pkt.bounce();
 	    		_num_bounced++;
+	    		count_drop(QUEUE_BOUNCE, &pkt);
 
 	            // flip the source and dst of the packet:
 	            int s = pkt.get_src();
@@ -486,19 +531,7 @@ void CompositeQueue::receivePacket(Packet& pkt) {
 
 	            	// get paths
 	            	// get the current slice:
-					int64_t superslice = (eventlist().now() / top->get_slicetime(3)) %
-		                top->get_nsuperslice();
-		            // next, get the relative time from the beginning of that superslice
-		            int64_t reltime = eventlist().now() - superslice*top->get_slicetime(3) -
-		                (eventlist().now() / (top->get_nsuperslice()*top->get_slicetime(3))) * 
-		                (top->get_nsuperslice()*top->get_slicetime(3));
-		            int slice; // the current slice
-		            if (reltime < top->get_slicetime(0))
-		                slice = 0 + superslice*3;
-		            else if (reltime < top->get_slicetime(0) + top->get_slicetime(1))
-		                slice = 1 + superslice*3;
-		            else
-		                slice = 2 + superslice*3;
+					int slice = top->get_slice_clock()->slice(); // the current slice
 
 		            pkt.set_slice_sent(slice); // "timestamp" the packet
 		            // get the number of available paths for this packet during this slice
@@ -531,8 +564,8 @@ void CompositeQueue::receivePacket(Packet& pkt) {
 	    		return;
 			} else {
 
-				// debug:
-				cout << "   ... this is an RTS packet. Dropped.\n";
+				// debug (trace level 1):
+				count_drop(QUEUE_DROP_RTS, &pkt);
 				//if (_logger) _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
 	    		//pkt.flow().logTraffic(pkt,*this,TrafficLogger::PKT_DROP);
 
@@ -23,10 +23,11 @@
 #include "eventlist.h"
 #include "network.h"
 #include "loggertypes.h"
+#include "dropcounters.h"
 
 class CompositeQueue : public Queue {
  public:
-    CompositeQueue(linkspeed_bps bitrate, mem_b maxsize, 
+    CompositeQueue(DynExpTopology* top, linkspeed_bps bitrate, mem_b maxsize, 
 		   EventList &eventlist, QueueLogger* logger, int tor, int port);
     virtual void receivePacket(Packet& pkt);
     virtual void doNextEvent();
@@ -46,8 +47,12 @@ class CompositeQueue : public Queue {
     }
     virtual const string& nodename() { return _nodename; }
 
+    DynExpTopology* _top;
     int _tor; // the ToR switch this queue belongs to
     int _port; // the port this queue belongs to
+    bool _parked; // rotor uplink waiting for its rotor to come back up
+
+    void unpark(); // called by the slice clock at the next slice boundary
 
     int _num_packets;
     int _num_headers; // only includes data packets stripped to headers, not acks or nacks
@@ -61,6 +66,8 @@ class CompositeQueue : public Queue {
     // Mechanism
     void beginService(); // start serving the item at the head of the queue
     void completeService(); // wrap up serving the item at the head of the queue
+    void count_drop(drop_event_t ev, Packet* pkt); // tally in the topology's DropCounters
+    void clip_stale(list<Packet*>& queue, mem_b& queuesize, int nextToR); // drop packets routed for another ToR
 
     int _serv;
     int _ratio_high, _ratio_low, _crt;
@@ -71,4 +78,6 @@ class CompositeQueue : public Queue {
     list<Packet*> _enqueued_rlb; // rlb queue
 };
 
+void compositequeue_unpark(void* queue, int slice); // SliceClock callback
+
 #endif
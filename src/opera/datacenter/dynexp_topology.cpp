@@ -13,6 +13,8 @@
 //#include "prioqueue.h"
 
 #include "rlbmodule.h"
+#include "sliceclock.h"
+#include "dropcounters.h"
 
 extern uint32_t delay_host2ToR; // nanoseconds, host-to-tor link
 extern uint32_t delay_ToR2ToR; // nanoseconds, tor-to-tor link
@@ -72,31 +74,38 @@ void DynExpTopology::read_params(string topfile) {
     //   |  |   (next ToR)
     //   V  |
     int temp;
-    _adjacency.resize(_nslice);
+    map<vector<int>, int> matching_ids; // distinct matchings seen so far
+    vector<int> row(_ntor*_nul);
+    vector<int> matching(_ntor);
+    _slice_matching.resize(_nslice*_nul);
     for (int i = 0; i < _nslice; i++) {
       getline(input, line);
       stringstream stream(line);
-      for (int j = 0; j < _no_of_nodes; j++) {
-        stream >> temp;
-        _adjacency[i].push_back(temp);
+      for (int j = 0; j < _ntor*_nul; j++)
+        stream >> row[j];
+      for (int ul = 0; ul < _nul; ul++) {
+        for (int tor = 0; tor < _ntor; tor++)
+          matching[tor] = row[tor*_nul + ul];
+        auto it = matching_ids.find(matching);
+        if (it == matching_ids.end()) {
+          it = matching_ids.insert(make_pair(matching, (int)matching_ids.size())).first;
+          _matchings.insert(_matchings.end(), matching.begin(), matching.end());
+        }
+        _slice_matching[i*_nul + ul] = it->second;
       }
     }
 
-
     // get label switched paths (rest of file)
-    _lbls.resize(_ntor);
-    for (int i = 0; i < _ntor; i++) {
-      _lbls[i].resize(_ntor);
-      for (int j = 0; j < _ntor; j++) {
-        _lbls[i][j].resize(_nslice);
-      }
-    }
+    // paths for one slice are gathered here, then folded into the shared tables
+    vector<vector<vector<int>>> paths(_ntor*_ntor);
+    _slice_lbls.resize(_nslice, -1);
+    _lbl_pair_off.push_back(0);
+    _lbl_path_off.push_back(0);
 
     // debug:
     //cout << "Loading topology..." << endl;
 
-    int sz = 0;
-    int slice; // which topology slice we're in
+    int slice = -1; // which topology slice we're in
     while(!input.eof()) {
       int s, d; // current source and destination tor
       vector<int> vtemp;
@@ -104,26 +113,89 @@ void DynExpTopology::read_params(string topfile) {
       stringstream stream(line);
       while (stream >> temp)
         vtemp.push_back(temp);
+      if (vtemp.size() == 0)
+        continue;
       if (vtemp.size() == 1) { // entering the next topology slice
+        if (slice >= 0)
+          add_lbl_table(slice, paths);
         slice = vtemp[0];
       }
       else {
         s = vtemp[0]; // current source
         d = vtemp[1]; // current dest
-        sz = _lbls[s][d][slice].size();
-        _lbls[s][d][slice].resize(sz + 1);
-        for (int i = 2; i < vtemp.size(); i++) {
-        	_lbls[s][d][slice][sz].push_back(vtemp[i]);
-        }
+        paths[s*_ntor + d].push_back(vector<int>(vtemp.begin() + 2, vtemp.end()));
       }
     }
+    if (slice >= 0)
+      add_lbl_table(slice, paths);
+    // slices without any paths listed all share one empty table
+    for (int i = 0; i < _nslice; i++)
+      if (_slice_lbls[i] < 0)
+        add_lbl_table(i, paths);
+    _lbl_table_hash.clear();
 
     // debug:
-    //cout << "Loaded topology." << endl;
+    //cout << "Loaded topology: " << matching_ids.size() << " matchings, " <<
+    //  (_lbl_pair_off.size() - 1) / (_ntor*_ntor) << " path tables for " << _nslice << " slices." << endl;
 
   }
 }
 
+// fold the paths gathered for one slice into the path tables (and clear them)
+// if an identical table already exists, the slice just points to it
+void DynExpTopology::add_lbl_table(int slice, vector<vector<vector<int>>>& paths) {
+  size_t h = 0;
+  for (size_t i = 0; i < paths.size(); i++) {
+    h = h * 31 + paths[i].size();
+    for (size_t j = 0; j < paths[i].size(); j++)
+      for (size_t k = 0; k < paths[i][j].size(); k++)
+        h = h * 31 + paths[i][j][k];
+  }
+
+  int table = -1;
+  auto range = _lbl_table_hash.equal_range(h);
+  for (auto it = range.first; it != range.second; it++) {
+    if (lbl_table_equal(it->second, paths)) {
+      table = it->second;
+      break;
+    }
+  }
+
+  if (table < 0) {
+    table = (_lbl_pair_off.size() - 1) / (_ntor*_ntor);
+    _lbl_table_hash.insert(make_pair(h, table));
+    for (size_t i = 0; i < paths.size(); i++) {
+      for (size_t j = 0; j < paths[i].size(); j++) {
+        _lbl_hops.insert(_lbl_hops.end(), paths[i][j].begin(), paths[i][j].end());
+        _lbl_path_off.push_back(_lbl_hops.size());
+      }
+      _lbl_pair_off.push_back(_lbl_path_off.size() - 1);
+    }
+  }
+  _slice_lbls[slice] = table;
+
+  for (size_t i = 0; i < paths.size(); i++)
+    paths[i].clear();
+}
+
+bool DynExpTopology::lbl_table_equal(int table, vector<vector<vector<int>>>& paths) {
+  int base = table*_ntor*_ntor;
+  for (size_t i = 0; i < paths.size(); i++) {
+    int first = _lbl_pair_off[base + i];
+    if ((size_t)(_lbl_pair_off[base + i + 1] - first) != paths[i].size())
+      return false;
+    for (size_t j = 0; j < paths[i].size(); j++) {
+      int hop = _lbl_path_off[first + j];
+      if ((size_t)(_lbl_path_off[first + j + 1] - hop) != paths[i][j].size())
+        return false;
+      for (size_t k = 0; k < paths[i][j].size(); k++)
+        if (_lbl_hops[hop + k] != paths[i][j][k])
+          return false;
+    }
+  }
+  return true;
+}
+
 // set number of possible pipes and queues
 void DynExpTopology::set_params() {
 
@@ -150,7 +222,7 @@ Queue* DynExpTopology::alloc_queue(QueueLogger* queueLogger, mem_b queuesize, in
 
 Queue* DynExpTopology::alloc_queue(QueueLogger* queueLogger, uint64_t speed, mem_b queuesize, int tor, int port) {
     if (qt==COMPOSITE)
-      return new CompositeQueue(speedFromMbps(speed), queuesize, *eventlist, queueLogger, tor, port);
+      return new CompositeQueue(this, speedFromMbps(speed), queuesize, *eventlist, queueLogger, tor, port);
     //else if (qt==CTRL_PRIO)
     //  return new CtrlPrioQueue(speedFromMbps(speed), queuesize, *eventlist, queueLogger);
     assert(0);
@@ -160,6 +232,9 @@ Queue* DynExpTopology::alloc_queue(QueueLogger* queueLogger, uint64_t speed, mem
 void DynExpTopology::init_network() {
   QueueLoggerSampling* queueLogger;
 
+  slice_clock = new SliceClock(this, *eventlist);
+  drop_counters = new DropCounters(_nslice, _ntor, _ndl + _nul);
+
   // initialize server to ToR pipes / queues
   for (int j = 0; j < _no_of_nodes; j++) { // sweep nodes
     rlb_modules[j] = NULL;
@@ -221,18 +296,19 @@ void DynExpTopology::init_network() {
 
 
 int DynExpTopology::get_nextToR(int slice, int crtToR, int crtport) {
-  int uplink = crtport - _ndl + crtToR*_nul;
+  int uplink = crtport - _ndl;
   //cout << "Getting next ToR..." << endl;
   //cout << "   uplink = " << uplink << endl;
-  //cout << "   next ToR = " << _adjacency[slice][uplink] << endl;
-  return _adjacency[slice][uplink];
+  //cout << "   next ToR = " << _matchings[_slice_matching[slice*_nul + uplink]*_ntor + crtToR] << endl;
+  return _matchings[_slice_matching[slice*_nul + uplink]*_ntor + crtToR];
 }
 
 int DynExpTopology::get_port(int srcToR, int dstToR, int slice, int path_ind, int hop) {
   //cout << "Getting port..." << endl;
   //cout << "   Inputs: srcToR = " << srcToR << ", dstToR = " << dstToR << ", slice = " << slice << ", path_ind = " << path_ind << ", hop = " << hop << endl;
-  //cout << "   Port = " << _lbls[srcToR][dstToR][slice][path_ind][hop] << endl;
-  return _lbls[srcToR][dstToR][slice][path_ind][hop];
+  int path = _lbl_pair_off[(_slice_lbls[slice]*_ntor + srcToR)*_ntor + dstToR] + path_ind;
+  //cout << "   Port = " << _lbl_hops[_lbl_path_off[path] + hop] << endl;
+  return _lbl_hops[_lbl_path_off[path] + hop];
 }
 
 bool DynExpTopology::is_last_hop(int port) {
@@ -252,12 +328,14 @@ bool DynExpTopology::port_dst_match(int port, int crtToR, int dst) {
 }
 
 int DynExpTopology::get_no_paths(int srcToR, int dstToR, int slice) {
-  int sz = _lbls[srcToR][dstToR][slice].size();
+  int pair = (_slice_lbls[slice]*_ntor + srcToR)*_ntor + dstToR;
+  int sz = _lbl_pair_off[pair + 1] - _lbl_pair_off[pair];
   return sz;
 }
 
 int DynExpTopology::get_no_hops(int srcToR, int dstToR, int slice, int path_ind) {
-  int sz = _lbls[srcToR][dstToR][slice][path_ind].size();
+  int path = _lbl_pair_off[(_slice_lbls[slice]*_ntor + srcToR)*_ntor + dstToR] + path_ind;
+  int sz = _lbl_path_off[path + 1] - _lbl_path_off[path];
   return sz;
 }
 
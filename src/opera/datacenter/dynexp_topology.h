@@ -21,6 +21,8 @@ class Queue;
 class Pipe;
 class Logfile;
 class RlbModule;
+class SliceClock;
+class DropCounters;
 
 class DynExpTopology: public Topology{
   public:
@@ -43,7 +45,14 @@ class DynExpTopology: public Topology{
 
   RlbModule* get_rlb_module(int host) {return rlb_modules[host];}
 
+  SliceClock* slice_clock; // fires at every slice boundary, and knows the current slice
+  SliceClock* get_slice_clock() {return slice_clock;}
+
+  DropCounters* drop_counters; // clipped / returned / dropped packets, by event, slice, ToR and port
+  DropCounters* get_drop_counters() {return drop_counters;}
+
   int64_t get_nsuperslice() {return _nsuperslice;}
+  int get_nslice() {return _nslice;}
   simtime_picosec get_slicetime(int ind) {return _slicetime[ind];} // picoseconds spent in each slice
   int get_firstToR(int node) {return node / _ndl;}
   int get_lastport(int dst) {return dst % _ndl;}
@@ -77,18 +86,32 @@ class DynExpTopology: public Topology{
   int no_of_nodes() const {return _no_of_nodes;} // number of servers
   int no_of_tors() const {return _ntor;} // number of racks
   int no_of_hpr() const {return _ndl;} // number of hosts per rack = number of downlinks
+  int no_of_uplinks() const {return _nul;} // number of rotor uplinks per rack
   
 
  private:
   map<Queue*,int> _link_usage;
   void read_params(string topfile);
   void set_params();
+  void add_lbl_table(int slice, vector<vector<vector<int>>>& paths);
+  bool lbl_table_equal(int table, vector<vector<vector<int>>>& paths);
   // Tor-to-Tor connections across time
-  // indexing: [slice][uplink (indexed from 0 to _ntor*_nul-1)]
-  vector<vector<int>> _adjacency;
+  // each rotor (uplink) only cycles through a few matchings, so every distinct
+  // matching is stored once and the schedule just indexes into them.
+  // indexing: [matching*_ntor + srcToR] -> dstToR (-1 = disconnected)
+  vector<int> _matchings;
+  // indexing: [slice*_nul + uplink (indexed from 0 to _nul-1)] -> matching
+  vector<int> _slice_matching;
   // label switched paths
-  // indexing: [src][dst][slice][path_ind][sequence of switch ports (queues)]
-  vector<vector<vector<vector<vector<int>>>>> _lbls;
+  // all slices in a superslice share their paths, so each distinct table is stored once.
+  // indexing: [slice] -> path table
+  vector<int> _slice_lbls;
+  // flattened tables: [table*_ntor*_ntor + src*_ntor + dst] -> first path (end = next entry),
+  // [path] -> first hop (end = next entry), [hop] -> switch port (queue)
+  vector<int> _lbl_pair_off;
+  vector<int> _lbl_path_off;
+  vector<int> _lbl_hops;
+  multimap<size_t,int> _lbl_table_hash; // only used while loading, to find duplicate tables
   int _ndl, _nul, _ntor, _no_of_nodes; // number down links, number uplinks, number ToRs, number servers
   int _nslice; // number of topologies
   int64_t _nsuperslice; // number of "superslices" (periodicity of topology)
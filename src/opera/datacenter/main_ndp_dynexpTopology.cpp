@@ -24,6 +24,10 @@
 #include "dynexp_topology.h"
 #include "rlb.h"
 #include "rlbmodule.h"
+#include "sliceclock.h"
+#include "dropcounters.h"
+#include "event_profile.h"
+#include "run_stats.h"
 
 // Simulation params
 
@@ -57,15 +61,21 @@ int main(int argc, char **argv) {
     mem_b queuesize = DEFAULT_QUEUE_SIZE * DEFAULT_PACKET_SIZE;
 
     // defined in flags:
-    int cwnd;
+    int cwnd = 30;
     stringstream filename(ios_base::out);
     string flowfile; // read the flows from a specified file
     string topfile; // read the topology from a specified file
-    double pull_rate; // set the pull rate from the command line
-    double simtime; // seconds
+    double pull_rate = 1; // set the pull rate from the command line
+    double simtime = .1; // seconds
     double utiltime = .01; // seconds
+    string utilfile; // per-link utilization samples (optional)
+    string droptrace; // clip/drop counters by event, slice, ToR and port (optional), with a summary on stdout
     int64_t rlbflow = 0; // flow size of "flagged" RLB flows
     int64_t cutoff = 0; // cutoff between NDP and RLB flow sizes. flows < cutoff == NDP.
+    double progress_secs = 0; // -progress: a Progress line on stderr this often, wall seconds
+#ifdef EVENT_PROFILE
+    double profile_bucket = 0; // us, -profile: events per EventSource class, and per bucket this long
+#endif
 
     int i = 1;
     filename << "logout.dat";
@@ -115,6 +125,26 @@ int main(int argc, char **argv) {
         } else if (!strcmp(argv[i],"-utiltime")) {
             utiltime = atof(argv[i+1]);
             i++;
+        } else if (!strcmp(argv[i],"-utilfile")) {
+            utilfile = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-droptrace")) {
+            droptrace = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-tracelevel")) {
+            DropCounters::trace_level = atoi(argv[i+1]); // 1 = print every clip/drop
+            i++;
+        } else if (!strcmp(argv[i],"-progress")) {
+            progress_secs = atof(argv[i+1]);
+            i++;
+        } else if (!strcmp(argv[i],"-profile")) {
+#ifdef EVENT_PROFILE
+            profile_bucket = atof(argv[i+1]);
+#else
+            cerr << "-profile needs a build with EVENT_PROFILE=1" << endl;
+            exit(1);
+#endif
+            i++;
         } else {
             exit_error(argv[0]);
         }
@@ -172,12 +202,40 @@ int main(int argc, char **argv) {
     RlbMaster* master = new RlbMaster(top, eventlist); // synchronizes the RLBmodules
     master->start();
 
+    // the slice clock drives every reconfiguration (RlbMaster, RlbModules, rotor uplinks)
+    top->get_slice_clock()->start();
+
     // NOTE: UtilMonitor defined in "pipe"
     UtilMonitor* UM = new UtilMonitor(top, eventlist);
     UM->start(timeFromSec(utiltime)); // print utilization every X milliseconds.
+    if (!utilfile.empty())
+        UM->record(utilfile); // binary per-link samples + utilfile.hist
  
     // GO!
+#ifdef EVENT_PROFILE
+    EventProfiler* profiler = NULL;
+    if (profile_bucket > 0) {
+        profiler = new EventProfiler(timeFromUs(profile_bucket));
+        eventlist.setProfiler(profiler);
+    }
+#endif
+    RunStats runstats;
+    runstats.started();
+    uint64_t nevents = 0;
+    Progress progress;
+    progress.start(progress_secs, eventlist.now(), timeFromSec(simtime), ffapp_done, &app);
     while (eventlist.doNextEvent()) {
+        progress.poll(++nevents, eventlist.now());
+    }
+    runstats.print(cerr, nevents, eventlist.now());
+#ifdef EVENT_PROFILE
+    if (profiler)
+        profiler->report(cout);
+#endif
+
+    if (!droptrace.empty()) {
+        top->get_drop_counters()->print_summary(cout); // silent if nothing was clipped or dropped
+        top->get_drop_counters()->write_trace(droptrace);
     }
     cerr << "Done" << endl;
     cerr << eventlist.now() << endl;
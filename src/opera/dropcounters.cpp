@@ -0,0 +1,126 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#include "dropcounters.h"
+#include <stdio.h>
+#include "network.h"
+
+int DropCounters::trace_level = 0;
+
+DropCounters::DropCounters(int nslice, int ntor, int nport)
+  : _nslice(nslice), _ntor(ntor), _nport(nport)
+{
+    _counts.resize((size_t)NUM_DROP_EVENTS * _nslice * _ntor, 0);
+    _port_counts.resize((size_t)NUM_DROP_EVENTS * _ntor * _nport, 0);
+}
+
+const char* drop_event_name(drop_event_t ev) {
+    switch (ev) {
+    case PIPE_CLIP_NDP: return "pipe_clip_ndp";
+    case PIPE_CLIP_NDPACK: return "pipe_clip_ndpack";
+    case PIPE_CLIP_NDPNACK: return "pipe_clip_ndpnack";
+    case PIPE_CLIP_NDPPULL: return "pipe_clip_ndppull";
+    case PIPE_RETURN_RLB: return "pipe_return_rlb";
+    case QUEUE_RETURN_RLB: return "queue_return_rlb";
+    case QUEUE_TRIM: return "queue_trim";
+    case QUEUE_BOUNCE: return "queue_bounce";
+    case QUEUE_DROP_RTS: return "queue_drop_rts";
+    case QUEUE_CLIP_NDP: return "queue_clip_ndp";
+    case QUEUE_CLIP_NDPACK: return "queue_clip_ndpack";
+    case QUEUE_CLIP_NDPNACK: return "queue_clip_ndpnack";
+    case QUEUE_CLIP_NDPPULL: return "queue_clip_ndppull";
+    default: return "unknown";
+    }
+}
+
+void DropCounters::trace(drop_event_t ev, int slice, Packet* pkt, simtime_picosec now) {
+    switch (ev) {
+    case PIPE_CLIP_NDP:
+    case PIPE_CLIP_NDPACK:
+    case PIPE_CLIP_NDPNACK:
+    case PIPE_CLIP_NDPPULL:
+    {
+        const char* what[] = {"NDP packet", "NDP ACK", "NDP NACK", "NDP PULL"};
+        cout << "!!! " << what[ev - PIPE_CLIP_NDP] << " clipped in pipe (rotor switch down)" << endl;
+        cout << "    time = " << timeAsUs(now) << " us";
+        cout << "    current slice = " << slice << endl;
+        cout << "    slice sent = " << pkt->get_slice_sent() << endl;
+        cout << "    src = " << pkt->get_src() << ", dst = " << pkt->get_dst() << endl;
+        break;
+    }
+    case QUEUE_CLIP_NDP:
+    case QUEUE_CLIP_NDPACK:
+    case QUEUE_CLIP_NDPNACK:
+    case QUEUE_CLIP_NDPPULL:
+    {
+        const char* what[] = {"NDP packet", "NDP ACK", "NDP NACK", "NDP PULL"};
+        cout << "!!! " << what[ev - QUEUE_CLIP_NDP] << " clipped at rotor uplink (path stale after the rotor came back)" << endl;
+        cout << "    time = " << timeAsUs(now) << " us";
+        cout << "    current slice = " << slice << endl;
+        cout << "    slice sent = " << pkt->get_slice_sent() << endl;
+        cout << "    src = " << pkt->get_src() << ", dst = " << pkt->get_dst() << endl;
+        break;
+    }
+    case QUEUE_DROP_RTS:
+        cout << "   ... this is an RTS packet. Dropped.\n";
+        break;
+    default:
+        cout << drop_event_name(ev) << " @ " << timeAsUs(now) << " us, slice " << slice
+             << ", src = " << pkt->get_src() << ", dst = " << pkt->get_dst() << endl;
+        break;
+    }
+}
+
+uint64_t DropCounters::total(drop_event_t ev) {
+    uint64_t sum = 0;
+    size_t n = (size_t)_nslice * _ntor;
+    for (size_t i = 0; i < n; i++)
+        sum += _counts[ev * n + i];
+    return sum;
+}
+
+void DropCounters::print_summary(std::ostream& os) {
+    for (int ev = 0; ev < NUM_DROP_EVENTS; ev++) {
+        uint64_t sum = total((drop_event_t)ev);
+        if (sum == 0)
+            continue;
+
+        // the slice, the ToR and the port (queue or pipe) that saw the most
+        vector<uint64_t> per_slice(_nslice, 0), per_tor(_ntor, 0);
+        for (int slice = 0; slice < _nslice; slice++)
+            for (int tor = 0; tor < _ntor; tor++) {
+                uint64_t c = _counts[((size_t)ev * _nslice + slice) * _ntor + tor];
+                per_slice[slice] += c;
+                per_tor[tor] += c;
+            }
+        int max_slice = 0, max_tor = 0;
+        for (int slice = 1; slice < _nslice; slice++)
+            if (per_slice[slice] > per_slice[max_slice])
+                max_slice = slice;
+        for (int tor = 1; tor < _ntor; tor++)
+            if (per_tor[tor] > per_tor[max_tor])
+                max_tor = tor;
+        const uint64_t* ports = &_port_counts[(size_t)ev * _ntor * _nport];
+        size_t max_port = 0;
+        for (size_t i = 1; i < (size_t)_ntor * _nport; i++)
+            if (ports[i] > ports[max_port])
+                max_port = i;
+
+        os << "Drops " << drop_event_name((drop_event_t)ev) << " " << sum
+           << " max_slice " << max_slice << " (" << per_slice[max_slice] << ")"
+           << " max_tor " << max_tor << " (" << per_tor[max_tor] << ")"
+           << " max_port " << max_port / _nport << ":" << max_port % _nport << " (" << ports[max_port] << ")" << endl;
+    }
+}
+
+void DropCounters::write_trace(const std::string& filename) {
+    FILE* f = fopen(filename.c_str(), "wb");
+    if (!f) {
+        cerr << "DropCounters: can't open " << filename << endl;
+        return;
+    }
+    // header: events, slices, ToRs, ports; then uint64 counts [event][slice][tor], then [event][tor][port]
+    uint64_t hdr[4] = {(uint64_t)NUM_DROP_EVENTS, (uint64_t)_nslice, (uint64_t)_ntor, (uint64_t)_nport};
+    fwrite(hdr, sizeof(uint64_t), 4, f);
+    fwrite(&_counts[0], sizeof(uint64_t), _counts.size(), f);
+    fwrite(&_port_counts[0], sizeof(uint64_t), _port_counts.size(), f);
+    fclose(f);
+}
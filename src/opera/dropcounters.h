@@ -0,0 +1,64 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef DROPCOUNTERS_H
+#define DROPCOUNTERS_H
+
+/*
+ * Counts the packets that pipes and ToR queues clip, return, bounce or drop,
+ * keyed by event and slice per ToR, and by event per queue / pipe (ToR and
+ * port, a pipe counts under the uplink port that feeds it). The packet path
+ * only increments integers; the per-packet printout is only produced at
+ * trace level >= 1 (-tracelevel).
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include "config.h"
+
+class DynExpTopology;
+class Packet;
+
+enum drop_event_t {
+    PIPE_CLIP_NDP = 0, // rotor switch down when an NDP data packet reached the end of the pipe
+    PIPE_CLIP_NDPACK,
+    PIPE_CLIP_NDPNACK,
+    PIPE_CLIP_NDPPULL,
+    PIPE_RETURN_RLB, // ditto for an RLB packet: returned to its RlbModule
+    QUEUE_RETURN_RLB, // stale RLB packet at a rotor uplink: returned to its RlbModule
+    QUEUE_TRIM, // NDP payload stripped
+    QUEUE_BOUNCE, // NDP header returned to sender
+    QUEUE_DROP_RTS, // already-bounced NDP header dropped
+    QUEUE_CLIP_NDP, // held at a parked rotor uplink, whose rotor came back to another ToR
+    QUEUE_CLIP_NDPACK,
+    QUEUE_CLIP_NDPNACK,
+    QUEUE_CLIP_NDPPULL,
+    NUM_DROP_EVENTS
+};
+
+class DropCounters {
+ public:
+
+    DropCounters(int nslice, int ntor, int nport);
+
+    void count(drop_event_t ev, int slice, int tor, int port) {
+        _counts[((size_t)ev * _nslice + slice) * _ntor + tor]++;
+        _port_counts[((size_t)ev * _ntor + tor) * _nport + port]++;
+    }
+    // the verbose printout that used to accompany a clip
+    void trace(drop_event_t ev, int slice, Packet* pkt, simtime_picosec now);
+
+    uint64_t total(drop_event_t ev);
+    void print_summary(std::ostream& os); // totals per event, plus the worst slice, ToR and port
+    void write_trace(const std::string& filename); // both arrays, binary
+
+    static int trace_level; // 0 = counters only, 1 = also print every event
+
+ private:
+    int _nslice, _ntor, _nport;
+    std::vector<uint64_t> _counts; // [event][slice][tor]
+    std::vector<uint64_t> _port_counts; // [event][tor][port]
+};
+
+const char* drop_event_name(drop_event_t ev);
+
+#endif
@@ -1,11 +1,17 @@
 // -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-        
 
 #include "eventlist.h"
+#ifdef EVENT_PROFILE
+#include "event_profile.h"
+#endif
 //#include <iostream>
 
 EventList::EventList()
     : _endtime(0),
       _lasteventtime(0)
+#ifdef EVENT_PROFILE
+      , _profiler(NULL)
+#endif
 {
 }
 
@@ -23,6 +29,12 @@ bool EventList::doNextEvent()
     _pendingsources.erase(_pendingsources.begin());
     assert(nexteventtime >= _lasteventtime);
     _lasteventtime = nexteventtime; // set this before calling doNextEvent, so that this::now() is accurate
+#ifdef EVENT_PROFILE
+    if (_profiler) {
+	_profiler->run(*nextsource, nexteventtime);
+	return true;
+    }
+#endif
     nextsource->doNextEvent();
     return true;
 }
@@ -7,6 +7,9 @@
 #include "loggertypes.h"
 
 class EventList;
+#ifdef EVENT_PROFILE
+class EventProfiler;
+#endif
 
 class EventSource : public Logged {
 	public:
@@ -30,11 +33,17 @@ public:
     void cancelPendingSource(EventSource &src);
     void reschedulePendingSource(EventSource &src, simtime_picosec when);
     inline simtime_picosec now() const {return _lasteventtime;}
+#ifdef EVENT_PROFILE
+    void setProfiler(EventProfiler* profiler) {_profiler = profiler;} // NULL: don't profile
+#endif
 private:
     simtime_picosec _endtime;
     simtime_picosec _lasteventtime;
     typedef multimap <simtime_picosec, EventSource*> pendingsources_t;
     pendingsources_t _pendingsources;
+#ifdef EVENT_PROFILE
+    EventProfiler* _profiler;
+#endif
 };
 
 #endif
@@ -2,8 +2,10 @@
 #include <streambuf>
 #include <iostream>
 #include <assert.h>
+#include <limits>
 
 #include "ffapp.h"
+#include "mapped_file.h"
 #include "json.hpp"
 #include "ndp.h"
 #include "rlb.h"
@@ -13,71 +15,281 @@ using json = nlohmann::json;
 FFApplication::FFApplication(DynExpTopology* top, int cwnd, double pull_rate, int rlb_cutoff, 
         NdpRtxTimerScanner & nrts, NdpSinkLoggerSampling & sl, EventList & eventlist, std::string taskgraph) 
     : topology(top), cwnd(cwnd), pull_rate(pull_rate), ndpRtxScanner(nrts), sinkLogger(sl), eventlist(eventlist), rlb_cutoff(rlb_cutoff) {
-    
-    // read the taskgraph and parse it
-    std::ifstream t(taskgraph);
-    std::string tg_str;
 
-    t.seekg(0, std::ios::end);   
-    tg_str.reserve(t.tellg());
-    t.seekg(0, std::ios::beg);
+    nnodes = nswitches = 0;
+    n_finished_tasks = 0;
+    if (taskgraph.size() >= 5 && taskgraph.compare(taskgraph.size() - 5, 5, ".json") == 0)
+        load_taskgraph_json(taskgraph);
+    else
+        load_taskgraph_flatbuf(taskgraph);
+}
 
-    tg_str.assign((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());    
+namespace {
+
+// Creates the tasks of a JSON task graph while the parser streams over the file, without a DOM;
+// edges are kept as guid pairs and wired up once every task exists, so they may come first.
+class TaskGraphJsonSax : public json::json_sax_t {
+public:
+    TaskGraphJsonSax(FFApplication * app) : app(app), depth(0), section(S_OTHER), field(F_OTHER), nedge(0) {}
+
+    bool null() { return true; }
+    bool boolean(bool) { return true; }
+    bool number_integer(json::number_integer_t v) { return number(v, v); }
+    bool number_unsigned(json::number_unsigned_t v) { return number(v, v); }
+    bool number_float(json::number_float_t v, const json::string_t &) { return number(v, v); }
+    bool string(json::string_t & v) {
+        if (depth == 3 && section == S_TASKS && field == F_TYPE)
+            rec.type = v;
+        return true;
+    }
+    bool binary(json::binary_t &) { return true; }
+    bool start_object(std::size_t) {
+        if (++depth == 3)
+            rec = record();
+        return true;
+    }
+    bool end_object() {
+        if (depth-- == 3 && section == S_TASKS)
+            add_task();
+        return true;
+    }
+    bool start_array(std::size_t) {
+        if (++depth == 3)
+            nedge = 0;
+        return true;
+    }
+    bool end_array() {
+        if (depth-- == 3 && section == S_EDGES)
+            edges.push_back(edge);
+        return true;
+    }
+    bool key(json::string_t & k) {
+        if (depth == 1)
+            section = k == "tasks" ? S_TASKS : k == "edges" ? S_EDGES : S_OTHER;
+        else if (depth == 3)
+            field = field_of(k);
+        return true;
+    }
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
 
-    auto tg_json = json::parse(tg_str);
+    void finish() {
+        for (auto & e: edges) {
+            auto from = index.find(e.first), to = index.find(e.second);
+            if (from == index.end() || to == index.end()) {
+                std::cerr << "Edge " << e.first << " -> " << e.second << " names a task that does not exist" << std::endl;
+                exit(1);
+            }
+            app->tasks[from->second]->add_nextask(app->tasks[to->second]);
+            app->tasks[to->second]->add_pretask(app->tasks[from->second]);
+        }
+    }
 
-    for (auto & jstask: tg_json["tasks"]) {
-        string task_type = jstask["type"].get<std::string>();
+private:
+    enum section_t { S_OTHER, S_TASKS, S_EDGES };
+    enum field_t {
+        F_OTHER, F_TYPE, F_FROMTASK, F_TOTASK, F_FROMWORKER, F_TOWORKER, F_FROMNODE, F_TONODE, F_XFERSIZE,
+        F_GUID, F_WORKERID, F_READYTIME, F_STARTTIME, F_COMPUTETIME
+    };
+    struct record {
+        std::string type;
+        int fromTask, toTask, fromWorker, toWorker, fromNode, toNode, guid, workerId;
+        double xferSize, readyTime, startTime, computeTime;
+        record() : fromTask(0), toTask(0), fromWorker(0), toWorker(0), fromNode(0), toNode(0), guid(0), workerId(0),
+            xferSize(0), readyTime(0), startTime(0), computeTime(0) {}
+    };
+
+    static field_t field_of(const std::string & k) {
+        static const std::unordered_map<std::string, field_t> fields = {
+            {"type", F_TYPE}, {"fromTask", F_FROMTASK}, {"toTask", F_TOTASK}, {"fromWorker", F_FROMWORKER},
+            {"toWorker", F_TOWORKER}, {"fromNode", F_FROMNODE}, {"toNode", F_TONODE}, {"xferSize", F_XFERSIZE},
+            {"guid", F_GUID}, {"workerId", F_WORKERID}, {"readyTime", F_READYTIME}, {"startTime", F_STARTTIME},
+            {"computeTime", F_COMPUTETIME},
+        };
+        auto i = fields.find(k);
+        return i == fields.end() ? F_OTHER : i->second;
+    }
+
+    bool number(int64_t i, double d) {
+        if (depth != 3)
+            return true;
+        if (section == S_EDGES) {
+            if (nedge == 0)
+                edge.first = i;
+            else if (nedge == 1)
+                edge.second = i;
+            nedge++;
+            return true;
+        }
+        switch (field) {
+        case F_FROMTASK: rec.fromTask = i; break;
+        case F_TOTASK: rec.toTask = i; break;
+        case F_FROMWORKER: rec.fromWorker = i; break;
+        case F_TOWORKER: rec.toWorker = i; break;
+        case F_FROMNODE: rec.fromNode = i; break;
+        case F_TONODE: rec.toNode = i; break;
+        case F_XFERSIZE: rec.xferSize = d; break;
+        case F_GUID: rec.guid = i; break;
+        case F_WORKERID: rec.workerId = i; break;
+        case F_READYTIME: rec.readyTime = d; break;
+        case F_STARTTIME: rec.startTime = d; break;
+        case F_COMPUTETIME: rec.computeTime = d; break;
+        default: break;
+        }
+        return true;
+    }
+
+    void add_task() {
         FFTask * task;
-        if (task_type == "inter-communication") {            
-            task = new FFTask(this, FFTask::FF_COMM, eventlist);
-            task->fromGuid = jstask["fromTask"].get<int>();
-            task->toGuid = jstask["toTask"].get<int>();
-            task->fromWorker = jstask["fromWorker"].get<int>();
-            task->toWorker = jstask["toWorker"].get<int>();
-            task->fromNode = jstask["fromNode"].get<int>();
-            task->toNode = jstask["toNode"].get<int>();
-            task->xferSize = jstask["xferSize"].get<float>();
-        } else if (task_type == "intra-communication") { 
-            task = new FFTask(this, FFTask::FF_INTRA_COMM, eventlist);
-            task->fromGuid = jstask["fromTask"].get<int>();
-            task->toGuid = jstask["toTask"].get<int>();
-            task->fromWorker = jstask["fromWorker"].get<int>();
-            task->toWorker = jstask["toWorker"].get<int>();
-            task->xferSize = jstask["xferSize"].get<float>();
+        if (rec.type == "inter-communication") {
+            task = new FFTask(app, FFTask::FF_COMM, app->eventlist);
+            task->fromGuid = rec.fromTask;
+            task->toGuid = rec.toTask;
+            task->fromWorker = rec.fromWorker;
+            task->toWorker = rec.toWorker;
+            task->fromNode = rec.fromNode;
+            task->toNode = rec.toNode;
+            task->xferSize = rec.xferSize;
+        } else if (rec.type == "intra-communication") {
+            task = new FFTask(app, FFTask::FF_INTRA_COMM, app->eventlist);
+            task->fromGuid = rec.fromTask;
+            task->toGuid = rec.toTask;
+            task->fromWorker = rec.fromWorker;
+            task->toWorker = rec.toWorker;
+            task->xferSize = rec.xferSize;
         } else {
+            task = new FFTask(app, FFTask::FF_COMP, app->eventlist);
+        }
+        task->guid = rec.guid;
+        task->workerId = rec.workerId;
+        task->readyTime = rec.readyTime;
+        task->startTime = rec.startTime;
+        task->computeTime = rec.computeTime;
+
+        index[rec.guid] = app->tasks.size();
+        app->tasks.push_back(task);
+    }
+
+    FFApplication * app;
+    int depth; // 1: top-level object, 2: a section's array, 3: a task or an edge
+    section_t section;
+    field_t field;
+    record rec;
+    std::pair<int, int> edge;
+    int nedge; // numbers seen in the current edge
+
+    std::unordered_map<int, int> index; // guid -> index in tasks
+    std::vector<std::pair<int, int>> edges; // (from guid, to guid)
+};
+
+}
+
+void FFApplication::load_taskgraph_json(std::string & taskgraph) {
+    // streamed straight from the file; only the tasks themselves are kept
+    std::ifstream t(taskgraph);
+    if (!t.is_open()) {
+        std::cerr << "Failed to read " << taskgraph << std::endl;
+        exit(1);
+    }
+
+    TaskGraphJsonSax sax(this);
+    if (!json::sax_parse(t, &sax)) {
+        std::cerr << taskgraph << " is not a valid task graph" << std::endl;
+        exit(1);
+    }
+    sax.finish();
+}
+
+void FFApplication::load_taskgraph_flatbuf(std::string & taskgraph) {
+    // read in place; everything we keep is copied into tasks
+    MappedFile file;
+    if (!file.open(taskgraph.c_str())) {
+        std::cerr << "Failed to read " << taskgraph << std::endl;
+        exit(1);
+    }
+    flatbuffers::Verifier verifier(file.data(), file.size(), 64, std::numeric_limits<flatbuffers::uoffset_t>::max());
+    if (!verifier.VerifyBuffer<FlatBufTaskGraph::TaskGraph>(nullptr)) {
+        std::cerr << taskgraph << " is not a valid task graph" << std::endl;
+        exit(1);
+    }
+
+    auto fbuf_tg = flatbuffers::GetRoot<FlatBufTaskGraph::TaskGraph>(file.data());
+    nswitches = fbuf_tg->nswitch();
+    nnodes = fbuf_tg->nnode();
+
+    // devices: only the network ones matter here, they carry the (src, dst) host pair
+    std::unordered_map<uint64_t, const FlatBufTaskGraph::Device*> devices;
+    for (unsigned int i = 0; i < fbuf_tg->devices()->size(); i++) {
+        auto dev = fbuf_tg->devices()->Get(i);
+        devices[dev->deviceid()] = dev;
+    }
+
+    // taskid -> index in tasks
+    auto fbuf_tasks = fbuf_tg->tasks();
+    std::unordered_map<uint64_t, int> index;
+    index.reserve(fbuf_tasks->size());
+    tasks.reserve(fbuf_tasks->size());
+
+    for (unsigned int i = 0; i < fbuf_tasks->size(); i++) {
+        auto &this_task = *fbuf_tasks->Get(i);
+        auto dev = devices.at(this_task.deviceid());
+        bool nw_dev = dev->type() == FlatBufTaskGraph::DeviceType_DEVICE_COMM_NW_COMM
+            || dev->type() == FlatBufTaskGraph::DeviceType_DEVICE_COMM_NW_NOMINAL;
+        FFTask * task;
+
+        switch (this_task.type()) {
+        case FlatBufTaskGraph::SimTaskType_TASK_COMM:
+        case FlatBufTaskGraph::SimTaskType_TASK_NOMINAL_COMM:
+            if (nw_dev) {
+                task = new FFTask(this, FFTask::FF_COMM, eventlist);
+                task->fromNode = dev->deviceproperty() / (nnodes + nswitches);
+                task->toNode = dev->deviceproperty() % (nnodes + nswitches);
+            } else { // nvlink / pci, modelled by its runtime
+                task = new FFTask(this, FFTask::FF_INTRA_COMM, eventlist);
+            }
+            task->xferSize = this_task.xfersize();
+            break;
+        case FlatBufTaskGraph::SimTaskType_TASK_ALLREDUCE:
+            std::cerr << "Allreduce tasks are not supported on opera (task " << this_task.taskid() << ")" << std::endl;
+            exit(1);
+        default:
             task = new FFTask(this, FFTask::FF_COMP, eventlist);
+            break;
         }
-        task->guid = jstask["guid"].get<int>();
-        task->workerId = jstask["workerId"].get<int>();
-        task->readyTime = jstask["readyTime"].get<float>();
-        task->startTime = jstask["startTime"].get<float>();
-        task->computeTime = jstask["computeTime"].get<float>();
-        
-        tasks[task->guid] = task;
+        task->guid = this_task.taskid();
+        task->workerId = dev->nodeid();
+        task->computeTime = this_task.runtime();
+
+        index[task->guid] = tasks.size();
+        tasks.push_back(task);
     }
 
-    for (auto & jsedge: tg_json["edges"]) {
-        int from = jsedge[0].get<int>();
-        int to = jsedge[1].get<int>();
-        tasks[from]->add_nextask(tasks[to]);
-        tasks[to]->add_pretask(tasks[from]);
+    for (unsigned int i = 0; i < fbuf_tasks->size(); i++) {
+        auto next = fbuf_tasks->Get(i)->nexttasks();
+        if (!next)
+            continue;
+        for (unsigned int j = 0; j < next->size(); j++) {
+            FFTask * to = tasks[index.at(next->Get(j))];
+            tasks[i]->add_nextask(to);
+            to->add_pretask(tasks[i]);
+        }
     }
 }
 
 FFApplication::~FFApplication() {
-    for (auto task: tasks) {
-        delete task.second;
+    for (FFTask * task: tasks) {
+        delete task;
     }
 }
 
 void FFApplication::start_init_tasks() {
     simtime_picosec delta = 0;
     int count = 0;
-    for (auto task: tasks) {
-        //std::cerr << "guid:" << task.second->guid << "size: " << task.second->preTasks.size() << std::endl;
-        if (task.second->preTasks.size() == 0) {
-            task.second->eventlist().sourceIsPending(*(task.second), delta++);
+    for (FFTask * task: tasks) {
+        if (task->counter == 0) {
+            task->eventlist().sourceIsPending(*task, delta++);
             count++;
         }
     }
@@ -86,10 +298,12 @@ void FFApplication::start_init_tasks() {
 
 FFTask::FFTask(FFApplication * app, FFTaskType type, EventList & eventlist)
     : ffapp(app), type(type), EventSource(eventlist, "FFTask") {
-    if (type == FF_COMP) {
-        fromNode = toNode = fromWorker = toWorker = fromGuid = toGuid = xferSize = -1;
-    }
+    fromNode = toNode = fromWorker = toWorker = fromGuid = toGuid = xferSize = -1;
+    readyTime = startTime = computeTime = 0;
+    workerId = -1;
+    sim_start = sim_finish = sim_duration = sim_ready = 0;
     started = false;
+    counter = 0;
 }
 
 // FFTask::FFTask(FFTask::FFTaskType type, EventList & eventlist, //          float rTime, float sTime, float cTime, float xfsz, 
@@ -99,7 +313,7 @@ FFTask::FFTask(FFApplication * app, FFTaskType type, EventList & eventlist)
 // }
 
 void FFTask::add_pretask(FFTask * task) {
-    preTasks.insert(task);
+    counter++;
 }
 
 void FFTask::add_nextask(FFTask * task) {
@@ -107,14 +321,10 @@ void FFTask::add_nextask(FFTask * task) {
 }
 
 void FFTask::taskstart() {
-    std::cerr << "Guid: " << guid << " try start at " << eventlist().now() << std::endl;
-    if (preTasks.size() != 0 || started) {
-        std::cerr << "can't start, pre.size = " << preTasks.size() << std::endl;
-        return;
-    }
+    // only ever scheduled once, by the last predecessor to finish
+    assert(counter == 0 && !started);
     sim_start = eventlist().now() + 1;
     started = true;
-    std::cerr << "started" << std::endl;
 
     if (type == FFTask::FF_COMM) {
         start_flow();
@@ -127,11 +337,12 @@ void FFTask::taskstart() {
 
 void FFTask::cleanup() {
     sim_finish = sim_start + sim_duration;
-    std::cerr << "Finish " << guid << " at " << sim_finish << std::endl;
+    ffapp->n_finished_tasks++;
     for (FFTask * task: nextTasks) {
-        task->preTasks.erase(this);
-        std::cerr << "Finish " << guid << ", Guid: " << task->guid << " has " << task->preTasks.size() << "pres." << std::endl;
-        eventlist().sourceIsPending(*task, sim_finish);
+        if (task->sim_ready < sim_finish)
+            task->sim_ready = sim_finish;
+        if (--task->counter == 0)
+            eventlist().sourceIsPending(*task, task->sim_ready);
     }
 }
 
@@ -141,12 +352,9 @@ void FFTask::doNextEvent() {
 
 void FFTask::start_flow() {
     
-    std::cerr << "Guid: " << guid << " start flow ";
     // from ndp main application: generate flow
 
     if (xferSize < ffapp->rlb_cutoff) { // priority flow, sent it over NDP
-        std::cerr << "NDP" <<std::endl;
-
         // generate an NDP source/sink:
         NdpSrc* flowSrc = new NdpSrc(ffapp->topology, nullptr, nullptr, eventlist(), fromNode, toNode, taskfinish, this);
         flowSrc->setCwnd(ffapp->cwnd * Packet::data_packet_size()); // congestion window
@@ -168,7 +376,6 @@ void FFTask::start_flow() {
     }  else { // background flow, send it over RLB
 
         // generate an RLB source/sink:
-        std::cerr << "RLB " << fromNode << " to " << toNode << std::endl;
 
         RlbSrc* flowSrc = new RlbSrc(ffapp->topology, NULL, NULL, eventlist(), fromNode, toNode);
         // debug:
@@ -184,10 +391,13 @@ void FFTask::start_flow() {
 }
 
 // for comunication task
+double ffapp_done(void * app) {
+    return static_cast<FFApplication*>(app)->done_fraction();
+}
+
 void taskfinish(void * task) {
 
     FFTask * fftask = (FFTask*) task;
-    std::cerr << "Guid: " << fftask->guid << " finished, calling back " <<std::endl;
     assert(fftask->type == FFTask::FF_COMM);
 
     fftask->sim_finish = fftask->eventlist().now();
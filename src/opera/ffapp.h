@@ -3,10 +3,11 @@
 
 #include <vector>
 #include <string>
-#include <unordered_set>
 #include <unordered_map>
 #include "eventlist.h"
 #include "ndp.h"
+
+#include "taskgraph_generated.h"
 /*
  * An application that takes a Flex-flow generated task graph
  * and simulates it on top of the opera network
@@ -19,11 +20,17 @@ public:
 			NdpRtxTimerScanner & nrts, NdpSinkLoggerSampling & sl, EventList & eventlist, std::string taskgraph);
 	~FFApplication();
 
+    // taskgraph files ending in .json are parsed as JSON, anything else is a FlatBufTaskGraph
+    void load_taskgraph_json(std::string & taskgraph);
+    void load_taskgraph_flatbuf(std::string & taskgraph);
     void start_init_tasks();
+    double done_fraction() { return tasks.empty() ? 0 : (double)n_finished_tasks / tasks.size(); } // see Progress
 
 	int rlb_cutoff, cwnd;
 	double pull_rate;
-    std::unordered_map<int, FFTask*> tasks;
+    size_t nnodes, nswitches;
+    std::vector<FFTask*> tasks; // dense, in the order they were loaded
+    size_t n_finished_tasks;
 	DynExpTopology * topology; 
     EventList & eventlist;
 	NdpRtxTimerScanner & ndpRtxScanner;
@@ -51,13 +58,17 @@ public:
 	FFApplication * ffapp;
 	FFTaskType type;
     float readyTime, startTime, computeTime, xferSize;
-    int workerId, guid, fromWorker, toWorker, fromGuid, toGuid, fromNode, toNode;
+    int workerId, fromWorker, toWorker, fromGuid, toGuid, fromNode, toNode;
+    uint64_t guid;
 	simtime_picosec sim_start, sim_finish, sim_duration;
+	simtime_picosec sim_ready; // latest finish time among the predecessors
 	bool started;
-	std::unordered_set<FFTask*> preTasks; 
+	int counter; // predecessors that haven't finished yet
     std::vector<FFTask*> nextTasks;
 };
 
 void taskfinish(void * task);
+// Progress::start's done, for an FFApplication
+double ffapp_done(void * app);
 
 #endif // FF_APP_H
@@ -114,6 +114,7 @@ void NdpSrc::log_me() {
 }
 
 void NdpSrc::startflow() {
+    live_counts.flows_started++;
     _highest_sent = 0;
     _last_acked = 0;
     
@@ -353,6 +354,7 @@ void NdpSrc::processAck(const NdpAck& ack) {
         //    "    current_time = " << timeAsMs(eventlist().now()) << endl;
 
         // FCT output for processing: (src dst bytes fct_ms timestarted_ms)
+        live_counts.flows_done++;
         
         cout << "FCT " << get_flow_src() << " " << get_flow_dst() << " " << get_flowsize() <<
             " " << timeAsMs(eventlist().now() - get_start_time()) << " " << fixed << timeAsMs(get_start_time()) << endl;
@@ -2,6 +2,7 @@
 #include "pipe.h"
 #include <iostream>
 #include <sstream>
+#include <string.h>
 
 #include "queue.h"
 #include "ndp.h"
@@ -9,6 +10,8 @@
 #include "rlbmodule.h"
 #include "ndppacket.h"
 #include "rlbpacket.h" // added for debugging
+#include "sliceclock.h"
+#include "dropcounters.h"
 
 Pipe::Pipe(simtime_picosec delay, EventList& eventlist)
 : EventSource(eventlist,"pipe"), _delay(delay)
@@ -18,6 +21,7 @@ Pipe::Pipe(simtime_picosec delay, EventList& eventlist)
     //_nodename= ss.str();
 
     _bytes_delivered = 0;
+    _util_bytes = &_bytes_delivered;
 
 }
 
@@ -53,13 +57,6 @@ void Pipe::doNextEvent() {
     }
 }
 
-uint64_t Pipe::reportBytes() {
-    uint64_t temp;
-    temp = _bytes_delivered;
-    _bytes_delivered = 0; // reset the counter
-    return temp;
-}
-
 void Pipe::sendFromPipe(Packet *pkt) {
     //if (_bounced) {
     //    // !!!
@@ -87,7 +84,7 @@ void Pipe::sendFromPipe(Packet *pkt) {
                 // otherwise, it's getting indirected, and doesn't count.
                 if (pkt->get_dst() == pkt->get_real_dst()) {
 
-                    _bytes_delivered = _bytes_delivered + pkt->size(); // increment packet delivered
+                    *_util_bytes += pkt->size(); // increment packet delivered
 
                     // debug:
                     //cout << "!!! incremented packets delivered !!!" << endl;
@@ -107,7 +104,7 @@ void Pipe::sendFromPipe(Packet *pkt) {
                     //NdpPacket* ndp_pkt = dynamic_cast<NdpPacket*>(pkt);
                     //if (!ndp_pkt->retransmitted())
                     if (pkt->size() > 64) // not a header
-                        _bytes_delivered = _bytes_delivered + pkt->size(); // increment packet delivered
+                        *_util_bytes += pkt->size(); // increment packet delivered
 
                     // send it to the sink
                     NdpSink* sink = pkt->get_ndpsink();
@@ -147,29 +144,20 @@ void Pipe::sendFromPipe(Packet *pkt) {
                 // we compute the current slice at the end of the packet transmission
                 // !!! as a future optimization, we could have the "wrong" host NACK any packets
                 // that go through at the wrong time
-                int64_t superslice = (eventlist().now() / top->get_slicetime(3)) %
-                    top->get_nsuperslice();
-                // next, get the relative time from the beginning of that superslice
-                int64_t reltime = eventlist().now() - superslice*top->get_slicetime(3) -
-                    (eventlist().now() / (top->get_nsuperslice()*top->get_slicetime(3))) * 
-                    (top->get_nsuperslice()*top->get_slicetime(3));
-                int slice; // the current slice
-                if (reltime < top->get_slicetime(0))
-                    slice = 0 + superslice*3;
-                else if (reltime < top->get_slicetime(0) + top->get_slicetime(1))
-                    slice = 1 + superslice*3;
-                else
-                    slice = 2 + superslice*3;
+                int slice = top->get_slice_clock()->slice(); // the current slice
 
                 int nextToR = top->get_nextToR(slice, pkt->get_crtToR(), pkt->get_crtport());
                 if (nextToR >= 0) {// the rotor switch is up
                     pkt->set_crtToR(nextToR);
+                    *_util_bytes += pkt->size(); // crossed the rotor
 
                 } else { // the rotor switch is down, "drop" the packet
 
+                    DropCounters* drops = top->get_drop_counters();
                     switch (pkt->type()) {
                     case RLB:
                     {
+                        drops->count(PIPE_RETURN_RLB, slice, pkt->get_crtToR(), pkt->get_crtport());
                         // for now, let's just return the packet rather than implementing the RLB NACK mechanism
                         RlbPacket *p = (RlbPacket*)(pkt);
                         RlbModule* module = top->get_rlb_module(p->get_src()); // returns pointer to Rlb module that sent the packet
@@ -177,38 +165,22 @@ void Pipe::sendFromPipe(Packet *pkt) {
                         break;
                     }
                     case NDP:
-                        cout << "!!! NDP packet clipped in pipe (rotor switch down)" << endl;
-                        cout << "    time = " << timeAsUs(eventlist().now()) << " us";
-                        cout << "    current slice = " << slice << endl;
-                        cout << "    slice sent = " << pkt->get_slice_sent() << endl;
-                        cout << "    src = " << pkt->get_src() << ", dst = " << pkt->get_dst() << endl;
-                        pkt->free();
-                        break;
                     case NDPACK:
-                        cout << "!!! NDP ACK clipped in pipe (rotor switch down)" << endl;
-                        cout << "    time = " << timeAsUs(eventlist().now()) << " us";
-                        cout << "    current slice = " << slice << endl;
-                        cout << "    slice sent = " << pkt->get_slice_sent() << endl;
-                        cout << "    src = " << pkt->get_src() << ", dst = " << pkt->get_dst() << endl;
-                        pkt->free();
-                        break;
                     case NDPNACK:
-                        cout << "!!! NDP NACK clipped in pipe (rotor switch down)" << endl;
-                        cout << "    time = " << timeAsUs(eventlist().now()) << " us";
-                        cout << "    current slice = " << slice << endl;
-                        cout << "    slice sent = " << pkt->get_slice_sent() << endl;
-                        cout << "    src = " << pkt->get_src() << ", dst = " << pkt->get_dst() << endl;
-                        pkt->free();
-                        break;
                     case NDPPULL:
-                        cout << "!!! NDP PULL clipped in pipe (rotor switch down)" << endl;
-                        cout << "    time = " << timeAsUs(eventlist().now()) << " us";
-                        cout << "    current slice = " << slice << endl;
-                        cout << "    slice sent = " << pkt->get_slice_sent() << endl;
-                        cout << "    src = " << pkt->get_src() << ", dst = " << pkt->get_dst() << endl;
+                    {
+                        drop_event_t ev = pkt->type() == NDP ? PIPE_CLIP_NDP :
+                            pkt->type() == NDPACK ? PIPE_CLIP_NDPACK :
+                            pkt->type() == NDPNACK ? PIPE_CLIP_NDPNACK : PIPE_CLIP_NDPPULL;
+                        drops->count(ev, slice, pkt->get_crtToR(), pkt->get_crtport());
+                        if (DropCounters::trace_level > 0)
+                            drops->trace(ev, slice, pkt, eventlist().now());
                         pkt->free();
                         break;
                     }
+                    default:
+                        break;
+                    }
                     // debug:
                     //cout << " Packet got clipped! src = " << pkt->get_src() <<
                     //    ", dst = " << pkt->get_dst() << ", slice sent = " << pkt->get_slice_sent() <<
@@ -271,6 +243,8 @@ UtilMonitor::UtilMonitor(DynExpTopology* top, EventList &eventlist)
     _H = _top->no_of_nodes(); // number of hosts
     _N = _top->no_of_tors(); // number of racks
     _hpr = _top->no_of_hpr(); // number of hosts per rack
+    _ports = _hpr + _top->no_of_uplinks();
+    _nlinks = _N * _ports;
     uint64_t rate = 10000000000 / 8; // bytes / second
     rate = rate * _H;
     //rate = rate / 1500; // total packets per second
@@ -280,11 +254,20 @@ UtilMonitor::UtilMonitor(DynExpTopology* top, EventList &eventlist)
     // debug:
     //cout << "max bytes per second = " << rate << endl;
 
+    // hand every ToR pipe its counter
+    _bytes.resize(_nlinks, 0);
+    for (int tor = 0; tor < _N; tor++)
+        for (int port = 0; port < _ports; port++)
+            _top->get_pipe_tor(tor, port)->set_util_counter(&_bytes[tor * _ports + port]);
+
+    _file = NULL;
+    _ring_len = _ring_used = 0;
 }
 
 void UtilMonitor::start(simtime_picosec period) {
     _period = period;
     _max_B_in_period = _max_agg_Bps * timeAsSec(_period);
+    _max_link_B_in_period = (10000000000 / 8) * timeAsSec(_period);
 
     // debug:
     //cout << "_max_pkts_in_period = " << _max_pkts_in_period << endl;
@@ -292,19 +275,49 @@ void UtilMonitor::start(simtime_picosec period) {
     eventlist().sourceIsPending(*this, _period);
 }
 
+void UtilMonitor::record(const string& filename) {
+    _filename = filename;
+    _file = fopen(filename.c_str(), "wb");
+    if (!_file) {
+        cerr << "UtilMonitor: can't open " << filename << endl;
+        exit(1);
+    }
+    // header: racks, ports per rack, downlinks per rack, sample period (ps)
+    // then one row per sample: time (ps), bytes per link [tor * ports + port]
+    uint64_t hdr[4] = {(uint64_t)_N, (uint64_t)_ports, (uint64_t)_hpr, (uint64_t)_period};
+    fwrite(hdr, sizeof(uint64_t), 4, _file);
+
+    // ~8MB of samples between writes
+    _ring_len = max(1, (1 << 20) / (_nlinks + 1));
+    _ring.resize((size_t)_ring_len * (_nlinks + 1));
+    _ring_used = 0;
+
+    _link_hist.resize((size_t)_nlinks * UTIL_BINS, 0);
+    _rack_hist.resize((size_t)_N * UTIL_BINS, 0);
+}
+
 void UtilMonitor::doNextEvent() {
     printAggUtil();
 }
 
+static inline int util_bin(uint64_t bytes, uint64_t max_bytes) {
+    int bin = (int)(bytes * UTIL_BINS / max_bytes);
+    return bin < UTIL_BINS ? bin : UTIL_BINS - 1;
+}
+
 void UtilMonitor::printAggUtil() {
 
     uint64_t B_sum = 0;
 
     for (int tor = 0; tor < _N; tor++) {
-        for (int downlink = 0; downlink < _hpr; downlink++) {
-            Pipe* pipe = _top->get_pipe_tor(tor, downlink);
-            B_sum = B_sum + pipe->reportBytes();
-        }
+        uint64_t* downlinks = &_bytes[tor * _ports];
+        uint64_t B_rack = 0;
+        for (int downlink = 0; downlink < _hpr; downlink++)
+            B_rack += downlinks[downlink];
+        B_sum += B_rack;
+
+        if (_file)
+            _rack_hist[tor * UTIL_BINS + util_bin(B_rack, _max_link_B_in_period * _hpr)]++;
     }
 
     // debug:
@@ -315,7 +328,54 @@ void UtilMonitor::printAggUtil() {
 
     cout << "Util " << fixed << util << " " << timeAsMs(eventlist().now()) << endl;
 
+    if (_file) {
+        uint64_t* row = &_ring[(size_t)_ring_used * (_nlinks + 1)];
+        row[0] = eventlist().now();
+        memcpy(row + 1, &_bytes[0], _nlinks * sizeof(uint64_t));
+        for (int link = 0; link < _nlinks; link++)
+            _link_hist[link * UTIL_BINS + util_bin(_bytes[link], _max_link_B_in_period)]++;
+        if (++_ring_used == _ring_len)
+            flush();
+    }
+    memset(&_bytes[0], 0, _nlinks * sizeof(uint64_t)); // reset the counters
+
     if (eventlist().now() + _period < eventlist().getEndtime())
         eventlist().sourceIsPendingRel(*this, _period);
+    else if (_file) { // last sample
+        flush();
+        write_hist();
+        fclose(_file);
+        _file = NULL;
+    }
+
+}
+
+void UtilMonitor::flush() {
+    if (!_file || _ring_used == 0)
+        return;
+    fwrite(&_ring[0], sizeof(uint64_t), (size_t)_ring_used * (_nlinks + 1), _file);
+    _ring_used = 0;
+}
 
-}
\ No newline at end of file
+void UtilMonitor::write_hist() {
+    // text, one line per link and per rack: the number of samples in each utilization bin
+    string fn = _filename + ".hist";
+    FILE* f = fopen(fn.c_str(), "w");
+    if (!f) {
+        cerr << "UtilMonitor: can't open " << fn << endl;
+        return;
+    }
+    for (int tor = 0; tor < _N; tor++) {
+        fprintf(f, "rack %d", tor);
+        for (int bin = 0; bin < UTIL_BINS; bin++)
+            fprintf(f, " %llu", (unsigned long long)_rack_hist[tor * UTIL_BINS + bin]);
+        fprintf(f, "\n");
+    }
+    for (int link = 0; link < _nlinks; link++) {
+        fprintf(f, "link %d %d", link / _ports, link % _ports);
+        for (int bin = 0; bin < UTIL_BINS; bin++)
+            fprintf(f, " %llu", (unsigned long long)_link_hist[link * UTIL_BINS + bin]);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
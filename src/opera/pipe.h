@@ -8,6 +8,8 @@
 
 #include <list>
 #include <utility>
+#include <vector>
+#include <stdio.h>
 #include "config.h"
 #include "eventlist.h"
 #include "network.h"
@@ -23,8 +25,11 @@ class Pipe : public EventSource, public PacketSink {
 
     void sendFromPipe(Packet *pkt);
 
-    uint64_t reportBytes(); // reports to the UtilMonitor
-    uint64_t _bytes_delivered; // keep track of how many (non-hdr,ACK,NACK,PULL,RTX) packets were delivered to hosts
+    // the UtilMonitor hands each ToR pipe a slot in its counter array.
+    // downlinks count payload delivered to hosts (non-hdr,ACK,NACK,PULL,RTX), uplinks count every byte carried
+    void set_util_counter(uint64_t* counter) { _util_bytes = counter; }
+    uint64_t* _util_bytes; // points at _bytes_delivered unless monitored
+    uint64_t _bytes_delivered;
 
     simtime_picosec delay() { return _delay; }
     const string& nodename() { return _nodename; }
@@ -35,22 +40,43 @@ class Pipe : public EventSource, public PacketSink {
     string _nodename;
 };
 
+#define UTIL_BINS 10 // utilization histogram resolution
+
 class UtilMonitor : public EventSource {
  public:
 
     UtilMonitor(DynExpTopology* top, EventList &eventlist);
 
     void start(simtime_picosec period);
+    void record(const string& filename); // also keep per-link time series + histograms (call after start)
     void doNextEvent();
     void printAggUtil();
+    void flush(); // write out the buffered samples
 
     DynExpTopology* _top;
     simtime_picosec _period; // picoseconds between utilization reports
     uint64_t _max_agg_Bps; // delivered to endhosts, across the whole network
     uint64_t _max_B_in_period;
+    uint64_t _max_link_B_in_period; // one link
     int _H; // number of hosts
     int _N; // number of racks
     int _hpr; // number of hosts per rack
+    int _ports; // ports per rack (downlinks + uplinks)
+    int _nlinks; // _N * _ports
+
+    // byte counters, one per ToR output pipe: [tor * _ports + port]. The pipes increment them directly.
+    vector<uint64_t> _bytes;
+
+    // recording (only if record() was called):
+    FILE* _file;
+    string _filename;
+    // preallocated ring of samples, each row = [time, _bytes...]; flushed as one block when full
+    vector<uint64_t> _ring;
+    int _ring_len, _ring_used;
+    // utilization histograms, UTIL_BINS bins of 1/UTIL_BINS each (the last bin includes 100%)
+    vector<uint64_t> _link_hist; // [link * UTIL_BINS + bin]
+    vector<uint64_t> _rack_hist; // [tor * UTIL_BINS + bin], downlinks of the rack together
+    void write_hist();
 };
 
 
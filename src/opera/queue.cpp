@@ -10,6 +10,7 @@
 
 #include "rlb.h" // needed to make dummy packet
 #include "rlbmodule.h"
+#include "sliceclock.h"
 
 Queue::Queue(linkspeed_bps bitrate, mem_b maxsize, EventList& eventlist, QueueLogger* logger)
   : EventSource(eventlist,"queue"), _maxsize(maxsize), _logger(logger), _bitrate(bitrate), _num_drops(0)
@@ -475,20 +476,7 @@ void PriorityQueue::completeService() {
 	            // the packet is being sent between racks
 
 	            // we will choose the path based on the current slice
-	            // first, get the current "superslice"
-	            int64_t superslice = (eventlist().now() / _top->get_slicetime(3)) %
-	            _top->get_nsuperslice();
-	            // next, get the relative time from the beginning of that superslice
-	            int64_t reltime = eventlist().now() - superslice*_top->get_slicetime(3) -
-	                (eventlist().now() / (_top->get_nsuperslice()*_top->get_slicetime(3))) * 
-	                (_top->get_nsuperslice()*_top->get_slicetime(3));
-	            int slice; // the current slice
-	            if (reltime < _top->get_slicetime(0))
-	                slice = 0 + superslice*3;
-	            else if (reltime < _top->get_slicetime(0) + _top->get_slicetime(1))
-	                slice = 1 + superslice*3;
-	            else
-	                slice = 2 + superslice*3;
+	            int slice = _top->get_slice_clock()->slice(); // the current slice
 
 	            // get the number of available paths for this packet during this slice
 	            int npaths = _top->get_no_paths(pkt->get_src_ToR(),
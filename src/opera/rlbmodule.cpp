@@ -12,6 +12,7 @@
 #include "queue_lossless.h"
 
 #include "rlb.h"
+#include "sliceclock.h"
 
 //////////////////////////////////
 //          RLB Module          //
@@ -50,6 +51,10 @@ RlbModule::RlbModule(DynExpTopology* top, EventList &eventlist, int node)
     // test, to try to drop packets
     //_slot_time = 1.2 * _slot_time; // yes, packets were dropped!
 
+    // the same slot counted in slice boundaries: we commit at the start of a superslice,
+    // and clean up at the end of the epsilon slice (_Ncommit_queues - 1) superslices later
+    _slot_slices = 3 * (_Ncommit_queues - 1) + 1;
+
     _max_send_rate = (_F / _Ncommit_queues) * _good_rate;
     _max_pkts = _max_send_rate * _slot_time;
 
@@ -526,8 +531,12 @@ void RlbModule::enqueue_commit(int slice, int current_commit_queue, int Nsenders
     //        cout << " _node 0: commit_queue: " << i << ". Length = " << _commit_queues[i].size() << " packets" << endl;
     //}
 
-    // create a delayed event that cleans this queue after the slot ends
-    eventlist().sourceIsPendingRel(*this, timeFromSec(_slot_time));
+    // have the slice clock clean this queue after the slot ends
+    _top->get_slice_clock()->wakeup(_slot_slices, rlbmodule_clean_commit, this);
+}
+
+void rlbmodule_clean_commit(void* module, int slice) {
+    ((RlbModule*)module)->clean_commit();
 }
 
 void RlbModule::clean_commit()
@@ -636,31 +645,24 @@ RlbMaster::RlbMaster(DynExpTopology* top, EventList &eventlist)
 }
 
 void RlbMaster::start() {
-    // set it up to start "ticking" at time 0 (the first rotor reconfiguration)
-    eventlist().sourceIsPending(*this, timeFromSec(0));
+    // tick on every new matching (the start of each superslice), starting with the
+    // first rotor reconfiguration at time 0
+    _top->get_slice_clock()->subscribe(rlbmaster_slice, this);
 }
 
 void RlbMaster::doNextEvent() {
     newMatching();
 }
 
+void rlbmaster_slice(void* master, int slice) {
+    if (slice % 3 == 0)
+        ((RlbMaster*)master)->newMatching();
+}
+
 void RlbMaster::newMatching() {
 
     // get the current slice:
-    // first, get the current "superslice"
-    int64_t superslice = (eventlist().now() / _top->get_slicetime(3)) %
-    _top->get_nsuperslice();
-    // next, get the relative time from the beginning of that superslice
-    int64_t reltime = eventlist().now() - superslice*_top->get_slicetime(3) -
-        (eventlist().now() / (_top->get_nsuperslice()*_top->get_slicetime(3))) * 
-        (_top->get_nsuperslice()*_top->get_slicetime(3));
-    int slice; // the current slice
-    if (reltime < _top->get_slicetime(0))
-        slice = 0 + superslice*3;
-    else if (reltime < _top->get_slicetime(0) + _top->get_slicetime(1))
-        slice = 1 + superslice*3;
-    else
-        slice = 2 + superslice*3;
+    int slice = _top->get_slice_clock()->slice(); // the current slice
 
 
     // debug:
@@ -841,9 +843,6 @@ void RlbMaster::newMatching() {
 
     _current_commit_queue++;
     _current_commit_queue = _current_commit_queue % _hpr;
-
-    // set up the next reconfiguration event:
-    eventlist().sourceIsPendingRel(*this, _top->get_slicetime(3));
 }
 
 
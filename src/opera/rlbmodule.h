@@ -50,6 +50,7 @@ private:
     double _hdr; // header size, bytes
     double _link_rate; // link data rate in Bytes / second
     double _slot_time; // seconds
+    int _slot_slices; // slot time, in slice boundaries
 
     double _good_rate; // goodput rate, Bytes / second
     double _pkt_ser_time;
@@ -72,6 +73,8 @@ private:
 
 };
 
+void rlbmodule_clean_commit(void* module, int slice); // SliceClock callback
+
 
 
 class RlbMaster : public EventSource {
@@ -114,4 +117,6 @@ class RlbMaster : public EventSource {
 
 };
 
+void rlbmaster_slice(void* master, int slice); // SliceClock callback
+
 #endif
@@ -0,0 +1,88 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-        
+#include "sliceclock.h"
+#include "dynexp_topology.h"
+
+SliceClock::SliceClock(DynExpTopology* top, EventList &eventlist)
+  : EventSource(eventlist,"sliceclock"), _top(top)
+{
+    _slice = -1;
+    _slice_start = _slice_end = 0;
+    _next_tick = 0;
+}
+
+void SliceClock::start() {
+    set_slice(eventlist().now());
+    // tick right away if we're sitting on a boundary (e.g. time 0)
+    if (eventlist().now() == _slice_start)
+        _next_tick = _slice_start;
+    else
+        _next_tick = _slice_end;
+    eventlist().sourceIsPending(*this, _next_tick);
+}
+
+void SliceClock::doNextEvent() {
+    set_slice(eventlist().now());
+    // this boundary is handled from here on: a wakeup(n) from one of the callbacks
+    // below counts n boundaries from this one, not from the one at the front
+    _next_tick = _slice_end;
+
+    // one-shot wakeups first, in the order they were registered
+    if (!_wakeups.empty()) {
+        vector<callback_t> due;
+        due.swap(_wakeups.front());
+        _wakeups.pop_front();
+        for (size_t i = 0; i < due.size(); i++)
+            due[i].cb(due[i].data, _slice);
+    }
+
+    for (size_t i = 0; i < _subscribers.size(); i++)
+        _subscribers[i].cb(_subscribers[i].data, _slice);
+
+    eventlist().sourceIsPending(*this, _next_tick);
+}
+
+void SliceClock::subscribe(slice_callback_t cb, void* data) {
+    callback_t c = {cb, data};
+    _subscribers.push_back(c);
+}
+
+void SliceClock::wakeup(int nslices, slice_callback_t cb, void* data) {
+    assert(nslices > 0);
+    size_t ind = nslices - 1;
+    // if the boundary at now() hasn't been processed yet, it is still at the front
+    if (eventlist().now() >= _next_tick)
+        ind++;
+    if (_wakeups.size() <= ind)
+        _wakeups.resize(ind + 1);
+    callback_t c = {cb, data};
+    _wakeups[ind].push_back(c);
+}
+
+int SliceClock::slice() {
+    simtime_picosec now = eventlist().now();
+    if (now < _slice_start || now >= _slice_end)
+        set_slice(now);
+    return _slice;
+}
+
+void SliceClock::set_slice(simtime_picosec t) {
+    // first, get the current "superslice"
+    simtime_picosec sstime = _top->get_slicetime(3);
+    int64_t superslice = (t / sstime) % _top->get_nsuperslice();
+    // next, get the relative time from the beginning of that superslice
+    simtime_picosec ssstart = (t / sstime) * sstime;
+    simtime_picosec reltime = t - ssstart;
+    if (reltime < _top->get_slicetime(0)) {
+        _slice = 0 + superslice*3;
+        _slice_start = ssstart;
+        _slice_end = ssstart + _top->get_slicetime(0);
+    } else if (reltime < _top->get_slicetime(0) + _top->get_slicetime(1)) {
+        _slice = 1 + superslice*3;
+        _slice_start = ssstart + _top->get_slicetime(0);
+        _slice_end = _slice_start + _top->get_slicetime(1);
+    } else {
+        _slice = 2 + superslice*3;
+        _slice_start = ssstart + _top->get_slicetime(0) + _top->get_slicetime(1);
+        _slice_end = ssstart + sstime;
+    }
+}
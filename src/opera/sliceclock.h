@@ -0,0 +1,53 @@
+// -*- c-basic-offset: 4; tab-width: 8; indent-tabs-mode: t -*-
+#ifndef SLICECLOCK_H
+#define SLICECLOCK_H
+
+/*
+ * The slice clock drives the rotor schedule: it is the only event source that
+ * fires at slice boundaries. Everything that acts on a reconfiguration (RlbMaster,
+ * RlbModules, parked rotor uplink queues) registers a callback here instead of
+ * scheduling its own events, and everything that needs the current slice asks
+ * the clock instead of re-deriving it from now().
+ */
+
+#include <vector>
+#include <deque>
+#include "config.h"
+#include "eventlist.h"
+
+class DynExpTopology;
+
+typedef void (*slice_callback_t)(void* data, int slice);
+
+class SliceClock : public EventSource {
+ public:
+
+    SliceClock(DynExpTopology* top, EventList &eventlist);
+
+    void start(); // start ticking at the current (or next) slice boundary
+    void doNextEvent();
+
+    void subscribe(slice_callback_t cb, void* data); // called at every slice boundary
+    void wakeup(int nslices, slice_callback_t cb, void* data); // called once, nslices boundaries after the current slice began
+
+    int slice(); // the current slice, valid at any time (not only at boundaries)
+    simtime_picosec slice_end() { slice(); return _slice_end; }
+
+ private:
+    void set_slice(simtime_picosec t);
+
+    typedef struct {
+        slice_callback_t cb;
+        void* data;
+    } callback_t;
+
+    DynExpTopology* _top;
+    int _slice;
+    simtime_picosec _slice_start, _slice_end; // the current slice is [_slice_start, _slice_end)
+    simtime_picosec _next_tick; // the boundary we're scheduled for
+
+    vector<callback_t> _subscribers;
+    deque<vector<callback_t>> _wakeups; // [0] = due at the next boundary
+};
+
+#endif
@@ -0,0 +1,56 @@
+#!/bin/sh
+
+# compare_bench.sh BASELINE RESULTS [TOL]
+#
+# One line per configuration and metric:
+#
+#   <name> <metric> <baseline> <result> <change %> ok|better|REGRESSION|new
+#
+# events_per_s and sim_per_wall regress when they drop by more than TOL percent
+# (default 10), setup_s and maxrss_kb when they grow by more than that. A setup_s
+# change also has to be over 50 ms either way, short setups are mostly noise. A changed event
+# count is reported but isn't a regression: the simulation itself changed, re-record
+# the baseline with "make baseline". Exits 1 if anything regressed.
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 BASELINE RESULTS [TOL]" >&2
+    exit 2
+fi
+
+awk -v tol=${3:-10} '
+NR == FNR {
+    for (i = 2; i < NF; i += 2)
+        base[$1, $i] = $(i + 1)
+    known[$1] = 1
+    next
+}
+function check(name, metric, higher_is_better, min_abs,    b, r, change, gain, verdict) {
+    r = val[metric]
+    if (!known[name]) {
+        printf "%s %s - %s - new\n", name, metric, r
+        return
+    }
+    b = base[name, metric]
+    change = b > 0 ? 100 * (r - b) / b : 0
+    gain = higher_is_better ? r - b : b - r
+    if ((higher_is_better ? -change : change) > tol && -gain > min_abs) {
+        verdict = "REGRESSION"
+        failed = 1
+    } else if ((higher_is_better ? change : -change) > tol && gain > min_abs)
+        verdict = "better"
+    else
+        verdict = "ok"
+    printf "%s %s %s %s %+.1f %s\n", name, metric, b, r, change, verdict
+}
+{
+    for (i = 2; i < NF; i += 2)
+        val[$i] = $(i + 1)
+    if (known[$1] && base[$1, "events"] != val["events"])
+        printf "%s events %s %s - changed\n", $1, base[$1, "events"], val["events"]
+    check($1, "events_per_s", 1, 0)
+    check($1, "sim_per_wall", 1, 0)
+    check($1, "setup_s", 0, 0.05)
+    check($1, "maxrss_kb", 0, 0)
+}
+END { exit failed }
+' "$1" "$2"
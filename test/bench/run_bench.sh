@@ -0,0 +1,65 @@
+#!/bin/sh
+
+# Runs every benchmark configuration REPEAT times (default 3) and appends the fastest
+# run's "Bench" line (src/common/run_stats.h), prefixed with the configuration's name, to
+# the results file (default results.dat):
+#
+#   <name> events N sim_s S setup_s A run_s B events_per_s E sim_per_wall R maxrss_kb K
+#
+# The simulators must be built already; "make bench" here builds them first. Each run's
+# stdout and stderr are left in logs/.
+#
+#   fattree_k16_perm  htsim_tcp_fattree, k=16 (1024 hosts), every host sends 1 MB to
+#                     one partner of a random permutation (fattree_perm1024.fb)
+#   flat_ring64       htsim_tcp_flat, FlexFlow graph on a 64 node degree 4 ring-and-chord
+#                     topology: 8 layers of neighbour transfers and 4 allreduces
+#   dyn_flat_ring16   htsim_tcp_dyn_flat, the same kind of graph on 16 nodes; it is done in
+#                     44 us, the rest of the 1000 s are DynFlatScheduler reconfigurations
+#                     (pause every queue, set its new bandwidth) every 100 us
+#   expander_n130     htsim_ndp_expander, expander_N=130_u=7_ecmp, 650 hosts, a random
+#                     permutation of 100 kB flows starting in the first 100 us
+#   opera_n8          htsim_ndp_dynexpTopology, dynexp_1path_N=8_k=8_G=1, a 120 task
+#                     FlexFlow graph, 200 ms simulated
+#   opera_n8_a2a      the same topology, every host sends 50 kB to every host in another
+#                     rack at time 0, 10 ms simulated. Enough backlog at the rotor uplinks
+#                     that packets get clipped, in the pipes and at parked uplinks
+
+results=${1:-results.dat}
+REPEAT=${REPEAT:-3}
+src=../../../src
+top=../../../topologies
+
+case $results in
+    /*) ;;
+    *) results=`pwd`/$results ;;
+esac
+mkdir -p logs && cd logs || exit 1
+: > $results
+
+bench() {
+    name=$1
+    shift
+    best=
+    r=0
+    while [ $r -lt $REPEAT ]; do
+        if ! "$@" > $name.out 2> $name.err; then
+            echo "$name failed, see logs/$name.err" >&2
+            exit 1
+        fi
+        line=`grep '^Bench ' $name.err | tail -1`
+        if [ -z "$line" ]; then
+            echo "$name printed no Bench line, see logs/$name.err" >&2
+            exit 1
+        fi
+        best=`printf '%s\n%s\n' "$best" "$line" | awk '/^Bench / && (b == "" || $9 < t) { b = $0; t = $9 } END { print b }'`
+        r=$((r + 1))
+    done
+    echo "$name ${best#Bench }" | tee -a $results
+}
+
+bench fattree_k16_perm $src/clos/datacenter/htsim_tcp_fattree -nodes 1024 -flowfile ../fattree_perm1024.fb -simtime 1000 -ofile fattree_k16_perm.fct
+bench flat_ring64 $src/clos/datacenter/htsim_tcp_flat -speed 100000 -nodes 64 -flowfile ../flat_ring64.fb -simtime 1000 -ofile flat_ring64.fct
+bench dyn_flat_ring16 $src/clos/datacenter/htsim_tcp_dyn_flat -speed 100000 -nodes 16 -deg 4 -rdelay 10 -flowfile ../dyn_flat_ring16.fb -simtime 1000 -ofile dyn_flat_ring16.fct
+bench expander_n130 $src/expander/datacenter/htsim_ndp_expander -cwnd 30 -q 46 -simtime .005 -pullrate 1 -VLB 0 -topfile $top/expander_N=130_u=7_ecmp.txt -flowfile ../expander_perm650.htsim
+bench opera_n8 $src/opera/datacenter/htsim_ndp_dynexpTopology -cutoff 1000000 -rlbflow 0 -cwnd 30 -q 8 -simtime 0.2 -pullrate 1 -topfile $top/dynexp_1path_N=8_k=8_G=1.txt -flowfile ../opera_n8.json
+bench opera_n8_a2a $src/opera/datacenter/htsim_ndp_dynexpTopology -cutoff 1000000 -rlbflow 0 -cwnd 30 -q 8 -simtime 0.01 -pullrate 1 -topfile $top/dynexp_1path_N=8_k=8_G=1.txt -flowfile ../opera_n8_a2a.json
@@ -0,0 +1,58 @@
+#!/bin/sh
+
+# Strong scaling of the parallel expander simulator (src/expander/pdes.h): runs the
+# expander_n130 configuration of run_bench.sh serially, then with -threads T for each T in
+# THREADS (default 1 2 4 8 16 32), REPEAT times each (default 3), and prints the fastest
+# run of each:
+#
+#   <threads> run_s S speedup X same_output yes|NO
+#
+# threads 0 is the serial run, speedup is against it. A parallel run has to print exactly
+# what the serial one does; any difference is reported as NO and makes the script exit 1.
+# Logs are left in logs/scale_*.
+#
+# Not done yet: multi-core scaling numbers. The script has only been run on a one-core
+# machine, where every thread count gives the same output but no speedup (the runs only
+# show the cost of the windows). The 1 to 32 thread strong-scaling results still have to
+# be measured on a machine with at least 32 cores.
+
+THREADS=${THREADS:-1 2 4 8 16 32}
+REPEAT=${REPEAT:-3}
+src=../../../src
+top=../../../topologies
+sim=$src/expander/datacenter/htsim_ndp_expander
+args="-cwnd 30 -q 46 -simtime .005 -pullrate 1 -VLB 0 -topfile $top/expander_N=130_u=7_ecmp.txt -flowfile ../expander_perm650.htsim"
+
+mkdir -p logs && cd logs || exit 1
+
+# run <name> <extra args>: fastest run_s of REPEAT runs, stdout left in <name>.out
+run() {
+    name=$1
+    shift
+    best=
+    r=0
+    while [ $r -lt $REPEAT ]; do
+        if ! $sim $args "$@" > $name.out 2> $name.err; then
+            echo "$name failed, see logs/$name.err" >&2
+            exit 1
+        fi
+        t=`awk '/^Bench / { print $9 }' $name.err`
+        best=`awk -v b="$best" -v t="$t" 'BEGIN { print (b == "" || t + 0 < b + 0) ? t : b }'`
+        r=$((r + 1))
+    done
+    echo $best
+}
+
+failed=0
+serial=`run scale_0` || exit 1
+echo "0 run_s $serial speedup 1 same_output yes"
+for t in $THREADS; do
+    s=`run scale_$t -threads $t` || exit 1
+    same=yes
+    if ! cmp -s scale_0.out scale_$t.out; then
+        same=NO
+        failed=1
+    fi
+    echo "$t run_s $s speedup `echo $serial $s | awk '{ printf "%.3g", $1 / $2 }'` same_output $same"
+done
+exit $failed